@@ -1,36 +1,374 @@
 #include "planet.h"
+#include "barnes_hut.h"
+#include "block_timestep.h"
+#include "collision.h"
+#include "kepler.h"
+#include "nbody.h"
+#include "particle_mesh.h"
+#include "thread_pool.h"
+#include "trajectory.h"
 #include <benchmark/benchmark.h>
 
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
 constexpr long fromRange = 8;
 
 constexpr long toRange = 1 << 15;
 
-static void BM_Update1(benchmark::State& state)
+template<int Width, typename Backend, int Unroll>
+static void BM_Update(benchmark::State& state)
 {
-    planets::PlanetSystem planetSystem(state.range(0));
+    planets::BasicPlanetSystem<Width, Backend, Unroll> planetSystem(state.range(0));
     for (auto _ : state)
     {
         planetSystem.Update(0.166f);
     }
 }
-BENCHMARK(BM_Update1)->Range(fromRange, toRange);
+#define PLANETS_BENCHMARK_UNROLLS(width, backend) \
+    BENCHMARK_TEMPLATE(BM_Update, width, planets::backend, 1)->Range(fromRange, toRange); \
+    BENCHMARK_TEMPLATE(BM_Update, width, planets::backend, 2)->Range(fromRange, toRange); \
+    BENCHMARK_TEMPLATE(BM_Update, width, planets::backend, 4)->Range(fromRange, toRange)
+PLANETS_BENCHMARK_UNROLLS(1, ScalarBackend);
+PLANETS_BENCHMARK_UNROLLS(4, SimdBackend);
+PLANETS_BENCHMARK_UNROLLS(8, SimdBackend);
+PLANETS_BENCHMARK_UNROLLS(16, SimdBackend);
+#undef PLANETS_BENCHMARK_UNROLLS
+BENCHMARK_TEMPLATE(BM_Update, 4, planets::SimdDoubleBackend, 1)->Range(fromRange, toRange);
+BENCHMARK_TEMPLATE(BM_Update, 4, planets::SimdDoubleBackend, 2)->Range(fromRange, toRange);
+BENCHMARK_TEMPLATE(BM_Update, 8, planets::SimdDoubleBackend, 1)->Range(fromRange, toRange);
+BENCHMARK_TEMPLATE(BM_Update, 8, planets::SimdDoubleBackend, 2)->Range(fromRange, toRange);
+
+//Planet steps per second of Update(dt, steps), steps = 1 streams the state through memory on every step
+template<typename T>
+static void BM_UpdateSteps(benchmark::State& state)
+{
+    T planetSystem(state.range(0));
+    const auto steps = static_cast<int>(state.range(1));
+    for (auto _ : state)
+    {
+        planetSystem.Update(0.166f / static_cast<float>(steps), steps);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * steps);
+}
+BENCHMARK_TEMPLATE(BM_UpdateSteps, planets::PlanetSystem8)->ArgsProduct({ benchmark::CreateRange(1 << 12, 1 << 22, 32), { 1, 4, 16 } });
+BENCHMARK_TEMPLATE(BM_UpdateSteps, planets::PlanetSystem16)->ArgsProduct({ benchmark::CreateRange(1 << 12, 1 << 22, 32), { 1, 4, 16 } });
 
-static void BM_Update4(benchmark::State& state)
+//Update with attractorCount stars on a ring around worldCenter, the time per planet should grow linearly with the count
+template<typename T>
+static void BM_Attractors(benchmark::State& state)
 {
-    planets::PlanetSystem4 planetSystem(state.range(0));
+    T planetSystem(state.range(0));
+    const auto attractorCount = static_cast<int>(state.range(1));
+    std::vector<planets::Attractor> attractors;
+    for (int i = 0; i < attractorCount; i++)
+    {
+        const auto angle = 2.0f * 3.14159265f * static_cast<float>(i) / static_cast<float>(attractorCount);
+        const auto position = planets::worldCenter + planets::Vec2f::up().Rotate(angle) * (attractorCount == 1 ? 0.0f : 0.1f);
+        attractors.push_back({ { position.x, position.y }, {}, 1.0f / static_cast<float>(attractorCount) });
+    }
+    planetSystem.SetAttractors(attractors);
     for (auto _ : state)
     {
         planetSystem.Update(0.166f);
     }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Attractors, planets::PlanetSystem)->ArgsProduct({ { 1 << 15 }, { 1, 2, 3, 8 } });
+BENCHMARK_TEMPLATE(BM_Attractors, planets::PlanetSystem8)->ArgsProduct({ { 1 << 15, 1 << 20 }, { 1, 2, 3, 8 } });
+BENCHMARK_TEMPLATE(BM_Attractors, planets::PlanetSystem16)->ArgsProduct({ { 1 << 15, 1 << 20 }, { 1, 2, 3, 8 } });
+
+//Startup cost, the planets are generated on the pool straight into the blocks
+template<typename T>
+static void BM_Construct(benchmark::State& state)
+{
+    planets::ThreadPool threadPool(static_cast<std::size_t>(state.range(1)));
+    for (auto _ : state)
+    {
+        T planetSystem(static_cast<std::size_t>(state.range(0)), &threadPool, 1);
+        benchmark::DoNotOptimize(planetSystem.GetPosition(0));
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Construct, planets::PlanetSystem8)->ArgsProduct({ { 1 << 20, 10'000'000 }, { 1, 4 } })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Construct, planets::PlanetSystem16)->ArgsProduct({ { 1 << 20, 10'000'000 }, { 1, 4 } })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+//Resuming from a checkpoint against generating the planets again, the first Update pays for reading the pages
+template<typename T>
+static void BM_LoadCheckpoint(benchmark::State& state)
+{
+    const auto path = std::filesystem::temp_directory_path() / "planets_bench_checkpoint.bin";
+    T(static_cast<std::size_t>(state.range(0)), nullptr, 1).SaveCheckpoint(path);
+    for (auto _ : state)
+    {
+        auto planetSystem = T::LoadCheckpoint(path);
+        benchmark::DoNotOptimize(planetSystem->GetPosition(0));
+    }
+    std::filesystem::remove(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_LoadCheckpoint, planets::PlanetSystem16)->Arg(10'000'000)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+//What recording a frame costs the simulation thread, against the encoding left to the writer thread
+static void BM_RecordSnapshot(benchmark::State& state)
+{
+    planets::PlanetSystem16 planetSystem(static_cast<std::size_t>(state.range(0)), nullptr, 1);
+    planets::PositionSnapshot snapshot;
+    for (auto _ : state)
+    {
+        snapshot.Assign(planetSystem.GetPositions());
+        benchmark::DoNotOptimize(snapshot.data.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_RecordSnapshot)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+
+static void BM_TrajectoryEncode(benchmark::State& state)
+{
+    planets::PlanetSystem16 planetSystem(static_cast<std::size_t>(state.range(0)), nullptr, 1);
+    planets::TrajectoryEncoder encoder(1.0e-4);
+    std::size_t bytes = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        planetSystem.Update(1.0f / 60.0f);
+        state.ResumeTiming();
+        bytes += encoder.Encode(planetSystem.GetPositions()).size();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["bytes_per_planet"] = static_cast<double>(bytes) / static_cast<double>(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TrajectoryEncode)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+//Broadphase and narrowphase at the contact distance of the drawn circles (6 cm) and at a tenth of it
+static void BM_FindNearest(benchmark::State& state)
+{
+    const planets::PlanetSystem16 planetSystem(static_cast<std::size_t>(state.range(0)), nullptr, 1);
+    planets::ThreadPool threadPool(static_cast<std::size_t>(state.range(2)));
+    planets::CollisionGrid grid;
+    const auto distance = static_cast<float>(state.range(1)) * 1.0e-3f;
+    std::size_t contactCount = 0;
+    for (auto _ : state)
+    {
+        contactCount = grid.FindNearest(planetSystem.GetPositions(), distance, &threadPool);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.counters["contacts"] = static_cast<double>(contactCount);
+}
+BENCHMARK(BM_FindNearest)->ArgsProduct({ { 100'000, 1 << 20 }, { 6, 60 }, { 1, 4 } })->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_GetPosition8(benchmark::State& state)
+{
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    std::vector<sf::Vector2f> positions(state.range(0));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < state.range(0); i++)
+        {
+            positions[i] = static_cast<sf::Vector2f>(planetSystem.GetPosition(i) * planets::pixelToMeter);
+        }
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GetPosition8)->Range(fromRange, toRange);
+
+static void BM_WritePositions8(benchmark::State& state)
+{
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    std::vector<sf::Vector2f> positions(state.range(0));
+    for (auto _ : state)
+    {
+        planetSystem.WritePositions(positions, planets::pixelToMeter);
+        benchmark::DoNotOptimize(positions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WritePositions8)->Range(fromRange, toRange);
+
+//Throughput of one CalculateGravity tier on lanes that stay in L1
+template<typename Vec, planets::GravityAccuracy Accuracy>
+static void BM_Gravity(benchmark::State& state)
+{
+    std::vector<Vec> deltas;
+    for (int i = 0; i < 256; i++)
+    {
+        deltas.emplace_back(planets::Vec2f{ 0.5f + 0.01f * static_cast<float>(i), 1.0f });
+    }
+    const decltype(deltas[0].SquareMagnitude()) step{ 1e-9f };
+    for (auto _ : state)
+    {
+        for (auto& delta : deltas)
+        {
+            delta += planets::CalculateGravity<Accuracy>(delta) * step;
+        }
+        benchmark::DoNotOptimize(deltas.data());
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<std::int64_t>(deltas.size()) * static_cast<std::int64_t>(sizeof(Vec) / sizeof(planets::Vec2f)));
+}
+#define PLANETS_BENCHMARK_GRAVITY(vec) \
+    BENCHMARK_TEMPLATE(BM_Gravity, vec, planets::GravityAccuracy::Estimate); \
+    BENCHMARK_TEMPLATE(BM_Gravity, vec, planets::GravityAccuracy::Refined); \
+    BENCHMARK_TEMPLATE(BM_Gravity, vec, planets::GravityAccuracy::Exact)
+PLANETS_BENCHMARK_GRAVITY(planets::Vec2f);
+PLANETS_BENCHMARK_GRAVITY(planets::FourVec2f);
+PLANETS_BENCHMARK_GRAVITY(planets::EightVec2f);
+PLANETS_BENCHMARK_GRAVITY(planets::SixteenVec2f);
+#undef PLANETS_BENCHMARK_GRAVITY
+
+template<int N>
+static void BM_DirectSum(benchmark::State& state)
+{
+    planets::DirectSumSystem<N> planetSystem(state.range(0));
+    for (auto _ : state)
+    {
+        planetSystem.Update(0.0166f);
+    }
+    state.counters["interactions"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) * static_cast<double>(state.range(0) * state.range(0)), benchmark::Counter::kIsRate);
+}
+BENCHMARK_TEMPLATE(BM_DirectSum, 4)->Range(1 << 8, 1 << 14);
+BENCHMARK_TEMPLATE(BM_DirectSum, 8)->Range(1 << 8, 1 << 14);
+BENCHMARK_TEMPLATE(BM_DirectSum, 16)->Range(1 << 8, 1 << 14);
+
+//Cost of one simulated second against the energy error it leaves, per integrator and step count
+template<typename T>
+static void BM_Integrator(benchmark::State& state)
+{
+    const auto integrator = static_cast<planets::Integrator>(state.range(0));
+    const auto steps = static_cast<int>(state.range(1));
+    const auto dt = 1.0f / static_cast<float>(steps);
+    T initial(1 << 12);
+    initial.SetIntegrator(integrator);
+    const auto initialEnergy = initial.GetEnergy();
+    double energyError = 0.0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        auto planetSystem = initial;
+        state.ResumeTiming();
+        for (int i = 0; i < steps; i++)
+        {
+            planetSystem.Update(dt);
+        }
+        state.PauseTiming();
+        energyError = std::abs(planetSystem.GetEnergy() - initialEnergy) / std::abs(initialEnergy);
+        state.ResumeTiming();
+    }
+    state.SetLabel(std::string(planets::GetIntegratorName(integrator)));
+    state.counters["energy_error"] = energyError;
+}
+BENCHMARK_TEMPLATE(BM_Integrator, planets::PlanetSystem4)->ArgsProduct({ { 0, 1, 2, 3 }, { 25, 50, 100, 200, 400 } })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Integrator, planets::PlanetSystem8)->ArgsProduct({ { 0, 1, 2, 3 }, { 25, 50, 100, 200, 400 } })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Integrator, planets::PlanetSystem16)->ArgsProduct({ { 1, 3 }, { 25, 100, 400, 1600 } })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_Integrator, planets::DoublePlanetSystem8)->ArgsProduct({ { 1, 3 }, { 25, 100, 400, 1600 } })
+    ->Unit(benchmark::kMicrosecond);
+
+//Force evaluations per planet and update next to the time, against BM_UniformSubsteps at the finest level
+template<int N>
+static void BM_BlockTimestep(benchmark::State& state)
+{
+    planets::BlockTimestepSystem<N> planetSystem(state.range(0));
+    for (auto _ : state)
+    {
+        planetSystem.Update(1.0f / 60.0f);
+    }
+    state.counters["evaluations_per_planet"] = static_cast<double>(planetSystem.GetForceEvaluationCount()) /
+        static_cast<double>(state.iterations() * state.range(0));
+    state.SetItemsProcessed(state.iterations() * state.range(0));
 }
-BENCHMARK(BM_Update4)->Range(fromRange, toRange);
+BENCHMARK_TEMPLATE(BM_BlockTimestep, 8)->Range(1 << 10, 1 << 16);
+BENCHMARK_TEMPLATE(BM_BlockTimestep, 16)->Range(1 << 10, 1 << 16);
 
-static void BM_Update8(benchmark::State& state)
+//Every planet at the substep the innermost ones need, the cost block timesteps avoid
+static void BM_UniformSubsteps(benchmark::State& state)
 {
     planets::PlanetSystem8 planetSystem(state.range(0));
+    planetSystem.SetIntegrator(planets::Integrator::Leapfrog);
+    const auto substepCount = static_cast<int>(state.range(1));
+    for (auto _ : state)
+    {
+        for (int i = 0; i < substepCount; i++)
+        {
+            planetSystem.Update(1.0f / 60.0f / static_cast<float>(substepCount));
+        }
+    }
+    state.counters["evaluations_per_planet"] = substepCount;
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UniformSubsteps)->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 16, 8), { 8 } });
+
+//One evaluation of every planet, whatever the time jumped, against BM_Update which needs a step per frame
+template<int N>
+static void BM_Kepler(benchmark::State& state)
+{
+    planets::KeplerSystem<N> planetSystem(state.range(0));
+    double time = 0.0;
+    for (auto _ : state)
+    {
+        time += static_cast<double>(state.range(1)) / 60.0;
+        planetSystem.SetTime(time);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_Kepler, 8)->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 16, 8), { 1, 1000 } });
+BENCHMARK_TEMPLATE(BM_Kepler, 16)->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 16, 8), { 1, 1000 } });
+
+constexpr long threadSweepPlanetCount = 1 << 22;
+
+static void BM_Update4Threads(benchmark::State& state)
+{
+    planets::ThreadPool threadPool(state.range(1));
+    planets::PlanetSystem4 planetSystem(state.range(0), &threadPool);
+    for (auto _ : state)
+    {
+        planetSystem.Update(0.166f);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Update4Threads)->ArgsProduct({ {threadSweepPlanetCount}, benchmark::CreateRange(1, 32, 2) })->UseRealTime();
+
+static void BM_Update8Threads(benchmark::State& state)
+{
+    planets::ThreadPool threadPool(state.range(1));
+    planets::PlanetSystem8 planetSystem(state.range(0), &threadPool);
     for (auto _ : state)
     {
         planetSystem.Update(0.166f);
     }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Update8Threads)->ArgsProduct({ {threadSweepPlanetCount}, benchmark::CreateRange(1, 32, 2) })->UseRealTime();
+
+
+static void BM_UpdateBarnesHut(benchmark::State& state)
+{
+    planets::ThreadPool threadPool;
+    planets::BarnesHutSystem planetSystem(state.range(0), 0.5f, &threadPool);
+    for (auto _ : state)
+    {
+        planetSystem.Update(0.0166f);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_UpdateBarnesHut)->Range(1 << 10, 1 << 20)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_UpdateParticleMesh(benchmark::State& state)
+{
+    planets::ThreadPool threadPool;
+    planets::ParticleMeshSystem planetSystem(state.range(0), static_cast<int>(state.range(1)), &threadPool);
+    for (auto _ : state)
+    {
+        planetSystem.Update(0.0166f);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
 }
-BENCHMARK(BM_Update8)->Range(fromRange, toRange);
\ No newline at end of file
+BENCHMARK(BM_UpdateParticleMesh)->ArgsProduct({ benchmark::CreateRange(1 << 10, 1 << 24, 16), { 256, 1024 } })
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,112 @@
+#include "circle_mesh.h"
+#include "density_splat.h"
+#include "planet.h"
+#include "thread_pool.h"
+#include <benchmark/benchmark.h>
+
+#include <numbers>
+#include <vector>
+
+constexpr int circleResolution = 12;
+constexpr float circleRadius = 3.0f;
+
+template<typename T>
+static void BM_EmitCircles(benchmark::State& state)
+{
+    T planetSystem(state.range(0));
+    const planets::CircleMesh circleMesh(circleResolution, circleRadius);
+    std::vector<sf::Vertex> vertices(state.range(0) * circleMesh.GetVertexCountPerPlanet());
+    for (auto _ : state)
+    {
+        circleMesh.Emit(planetSystem.GetPositions(), planets::pixelToMeter, vertices);
+        benchmark::DoNotOptimize(vertices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK_TEMPLATE(BM_EmitCircles, planets::PlanetSystem)->Range(1 << 10, 1 << 18);
+BENCHMARK_TEMPLATE(BM_EmitCircles, planets::PlanetSystem8)->Range(1 << 10, 1 << 18);
+
+static void BM_EmitCirclesThreads(benchmark::State& state)
+{
+    planets::ThreadPool threadPool(state.range(1));
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    const planets::CircleMesh circleMesh(circleResolution, circleRadius);
+    std::vector<sf::Vertex> vertices(state.range(0) * circleMesh.GetVertexCountPerPlanet());
+    for (auto _ : state)
+    {
+        circleMesh.Emit(planetSystem.GetPositions(), planets::pixelToMeter, vertices, &threadPool);
+        benchmark::DoNotOptimize(vertices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EmitCirclesThreads)->ArgsProduct({ { 1 << 18 }, benchmark::CreateRange(1, 16, 2) })->UseRealTime();
+
+//The per planet loop main.cpp used before CircleMesh, as a baseline
+static void BM_EmitCirclesScalar(benchmark::State& state)
+{
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    std::vector<planets::Vec2f> circleVertices;
+    for (int i = 0; i < circleResolution; i++)
+    {
+        const auto angle = static_cast<float>(i) * 2.0f * std::numbers::pi_v<float> / circleResolution;
+        circleVertices.push_back({ std::cos(angle), std::sin(angle) });
+    }
+    std::vector<sf::Vertex> vertices(state.range(0) * circleResolution * 3);
+    for (auto _ : state)
+    {
+        for (int i = 0; i < state.range(0); i++)
+        {
+            const auto currentIndex = circleResolution * 3 * i;
+            const auto pixelPosition = static_cast<sf::Vector2f>(planetSystem.GetPosition(i) * planets::pixelToMeter);
+            for (int j = 0; j < circleResolution; j++)
+            {
+                vertices[currentIndex + j * 3].position = pixelPosition;
+                vertices[currentIndex + j * 3 + 1].position = pixelPosition + static_cast<sf::Vector2f>(circleVertices[j] * circleRadius);
+                vertices[currentIndex + j * 3 + 2].position = pixelPosition + static_cast<sf::Vector2f>(circleVertices[(j + 1) % circleResolution] * circleRadius);
+            }
+        }
+        benchmark::DoNotOptimize(vertices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EmitCirclesScalar)->Range(1 << 10, 1 << 18);
+
+//range(1) is the visible share of the view in percent, the view is a square centered on worldCenter
+static void BM_EmitVisible(benchmark::State& state)
+{
+    planets::ThreadPool threadPool;
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    const planets::CircleMesh circleMesh(circleResolution, circleRadius);
+    std::vector<sf::Vertex> vertices(state.range(0) * circleMesh.GetVertexCountPerPlanet());
+    const auto center = planets::worldCenter * planets::pixelToMeter;
+    const auto halfSize = planets::outerRaidus * planets::pixelToMeter * static_cast<float>(state.range(1)) / 100.0f;
+    const sf::FloatRect bounds{ center.x - halfSize, center.y - halfSize, 2.0f * halfSize, 2.0f * halfSize };
+    std::size_t visibleCount = 0;
+    for (auto _ : state)
+    {
+        visibleCount = circleMesh.EmitVisible(planetSystem.GetPositions(), planets::pixelToMeter, bounds, vertices, &threadPool);
+        benchmark::DoNotOptimize(vertices.data());
+    }
+    state.counters["visible"] = static_cast<double>(visibleCount);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EmitVisible)->ArgsProduct({ { 1 << 18 }, { 10, 25, 50, 100 } })->UseRealTime();
+
+//Whole ring in a 1280x720 image, against BM_EmitVisible at 100% for the same planets
+static void BM_DensitySplat(benchmark::State& state)
+{
+    planets::ThreadPool threadPool(state.range(1));
+    planets::PlanetSystem8 planetSystem(state.range(0));
+    planets::DensitySplat densitySplat(1280, 720);
+    const auto center = planets::worldCenter * planets::pixelToMeter;
+    const auto halfSize = planets::outerRaidus * planets::pixelToMeter;
+    const sf::FloatRect bounds{ center.x - halfSize, center.y - halfSize, 2.0f * halfSize, 2.0f * halfSize };
+    for (auto _ : state)
+    {
+        densitySplat.Accumulate(planetSystem.GetPositions(), planets::pixelToMeter, bounds, &threadPool);
+        densitySplat.Shade(sf::Color::Blue, &threadPool);
+        benchmark::DoNotOptimize(densitySplat.GetPixels());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_DensitySplat)->ArgsProduct({ { 1 << 14, 1 << 18 }, { 1, 4 } })->UseRealTime();
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+namespace planets
+{
+
+//Point mass pulling every planet with G * mass / r^2, in meters and meters per second. mass is relative to the
+//single star at worldCenter the planets are generated around, whose mass is 1. It moves in a straight line at velocity
+//between two calls to SetAttractors, so a curved path is followed by setting it again every frame. A moving attractor
+//pulls from where it is at the middle of each step, or at its end with velocity Verlet, which kicks at both ends.
+struct Attractor
+{
+    sf::Vector2f position;
+    sf::Vector2f velocity;
+    float mass = 1.0f;
+};
+
+}
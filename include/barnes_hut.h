@@ -0,0 +1,78 @@
+#pragma once
+
+#include "planet.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//The up to four children of a quadtree node, one child per lane so the opening test runs on the whole quad at once.
+//Lanes with zero mass are empty cells.
+struct NodeQuad
+{
+    FourFloat centerXs;
+    FourFloat centerYs;
+    FourFloat masses;
+    FourFloat sizes;
+    //Quad holding the children of the lane, -1 for leaves
+    std::array<std::int32_t, 4> childQuads{ -1, -1, -1, -1 };
+    std::array<std::uint32_t, 4> bodyBegins{};
+    std::array<std::uint32_t, 4> bodyEnds{};
+};
+
+//Planets pulled by worldCenter and by each other, the mutual gravity is approximated with a Barnes-Hut quadtree
+//rebuilt every step. openingAngle is the size/distance ratio under which a node is taken as a point mass,
+//0 opens every node and gives the exact sum.
+class BarnesHutSystem
+{
+public:
+    //Same planets as BasicPlanetSystem for the same seed
+    BarnesHutSystem(std::size_t planetCount, float openingAngle = 0.5f, ThreadPool* threadPool = nullptr,
+        std::uint64_t seed = RandomSeed()) noexcept;
+    void Update(float dt) noexcept;
+    Vec2f GetPosition(int index) const;
+    //Planet to planet acceleration of the last Update, without worldCenter
+    Vec2f GetMutualAcceleration(int index) const;
+
+    void SetOpeningAngle(float openingAngle) noexcept { openingAngle_ = openingAngle; }
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+    [[nodiscard]] const std::vector<NodeQuad>& GetQuads() const noexcept { return quads_; }
+
+    //Rebuilds the tree and the mutual accelerations of the current positions
+    void ComputeMutualAccelerations() noexcept;
+private:
+    void SortBodies() noexcept;
+    void BuildTree() noexcept;
+    void ComputeGroupAccelerations(std::size_t group, std::vector<float>& sourceXs,
+        std::vector<float>& sourceYs, std::vector<float>& sourceMasses) noexcept;
+
+    ThreadPool* threadPool_ = nullptr;
+    float openingAngle_ = 0.5f;
+    std::size_t planetCount_ = 0;
+
+    //Bodies in Morton order, padded to a multiple of laneWidth
+    std::vector<float> xs_;
+    std::vector<float> ys_;
+    std::vector<float> velocityXs_;
+    std::vector<float> velocityYs_;
+    std::vector<float> accelerationXs_;
+    std::vector<float> accelerationYs_;
+    std::vector<std::uint32_t> planetIds_;
+    std::vector<std::uint32_t> bodyOfPlanet_;
+
+    std::vector<std::uint64_t> keys_;
+    std::vector<float> scratch_;
+    std::vector<std::uint32_t> scratchIds_;
+    std::vector<NodeQuad> quads_;
+    //Root cell of the tree
+    Vec2f rootCorner_{};
+    float rootSize_ = 0.0f;
+};
+
+}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "planet.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Planets orbiting worldCenter with hierarchical power of two timesteps. Each block of N planets takes 2^level leapfrog
+//substeps per Update, level being the smallest one whose substep resolves the fastest orbit of the block. Planets are
+//regularly sorted by level so the blocks hold planets needing about the same substep.
+template<int N>
+class BlockTimestepSystem
+{
+public:
+    //Fraction of the dynamical time sqrt(r^3 / G) a substep may span
+    static constexpr float defaultAccuracy = 0.02f;
+    static constexpr int maxLevel = 10;
+    //Updates between two sorts of the planets by level
+    static constexpr int sortInterval = 32;
+
+    //Same planets as BasicPlanetSystem for the same seed
+    BlockTimestepSystem(std::size_t planetCount, float accuracy = defaultAccuracy, ThreadPool* threadPool = nullptr,
+        std::uint64_t seed = RandomSeed()) noexcept;
+    void Update(float dt) noexcept;
+    Vec2f GetPosition(int index) const;
+    Vec2f GetVelocity(int index) const;
+    //Blocks are in level order, not in planet order, see PositionView
+    [[nodiscard]] PositionView GetPositions() const noexcept;
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+
+    //Lane force evaluations since construction, padding lanes included
+    [[nodiscard]] std::uint64_t GetForceEvaluationCount() const noexcept { return forceEvaluationCount_; }
+    //Substep level the block holding the planet used in the last Update
+    [[nodiscard]] int GetLevel(int index) const;
+private:
+    //Smallest level whose substep of dt is under accuracy times the timescale of the planet
+    [[nodiscard]] int ComputeLevel(float inverseSqrTime, float dt) const noexcept;
+    void SortByLevel(float dt) noexcept;
+    void StepBlock(std::size_t block, float dt) noexcept;
+
+    ThreadPool* threadPool_ = nullptr;
+    float accuracy_ = defaultAccuracy;
+    std::size_t planetCount_ = 0;
+    int updateCount_ = 0;
+    std::uint64_t forceEvaluationCount_ = 0;
+
+    std::vector<NVec2f<N>> positions_;
+    std::vector<NVec2f<N>> velocities_;
+    std::vector<std::uint8_t> blockLevels_;
+    //Planet in each lane slot, planetCount for padding
+    std::vector<std::uint32_t> planetOfSlot_;
+    std::vector<std::uint32_t> slotOfPlanet_;
+};
+
+using BlockTimestepSystem4 = BlockTimestepSystem<4>;
+using BlockTimestepSystem8 = BlockTimestepSystem<8>;
+using BlockTimestepSystem16 = BlockTimestepSystem<16>;
+
+}
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace planets
+{
+
+//Binary snapshot of a planet system: a CheckpointHeader, then the position blocks and the velocity blocks exactly as
+//they lie in memory, each starting at a multiple of checkpointAlignment so they can be used in place once mapped,
+//then the attractors and the planet masses right after the velocities.
+//Native byte order, a checkpoint is read back on the machine type that wrote it.
+constexpr std::array<char, 8> checkpointMagic{ 'P', 'L', 'A', 'N', 'E', 'T', 'S', '\0' };
+constexpr std::uint32_t checkpointVersion = 2;
+constexpr std::size_t checkpointAlignment = 4096;
+//Floats per attractor: x, y, velocity x, velocity y and mass
+constexpr std::size_t checkpointAttractorFloats = 5;
+
+struct CheckpointHeader
+{
+    std::array<char, 8> magic = checkpointMagic;
+    std::uint32_t version = checkpointVersion;
+    //Lanes per block and bytes per lane, the layout of the blocks
+    std::uint32_t width = 0;
+    std::uint32_t scalarSize = 0;
+    std::uint32_t integrator = 0;
+    std::uint64_t planetCount = 0;
+    std::uint64_t blockCount = 0;
+    std::uint64_t seed = 0;
+    //Simulated seconds since the planets were generated
+    double time = 0.0;
+    //From the start of the file
+    std::uint64_t positionsOffset = 0;
+    std::uint64_t velocitiesOffset = 0;
+    std::uint64_t attractorCount = 0;
+    std::uint64_t attractorsOffset = 0;
+    //0 while every planet weighs planetMass, planetCount once planets merged
+    std::uint64_t massCount = 0;
+    std::uint64_t massesOffset = 0;
+    float collisionRadius = 0.0f;
+};
+
+//Whole file mapped copy on write: the pages are read on first access and writes stay private to the process.
+//Read into memory on systems without mmap.
+class MappedFile
+{
+public:
+    //nullptr when the file cannot be opened or mapped
+    [[nodiscard]] static std::shared_ptr<MappedFile> Open(const std::filesystem::path& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::span<std::byte> GetBytes() const noexcept { return { data_, size_ }; }
+private:
+    MappedFile() = default;
+
+    std::byte* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+//Header and blocks of a checkpoint file, the blocks point into file
+struct Checkpoint
+{
+    CheckpointHeader header;
+    std::shared_ptr<MappedFile> file;
+    std::span<std::byte> positions;
+    std::span<std::byte> velocities;
+    //checkpointAttractorFloats per attractor
+    std::span<const float> attractors;
+    std::span<const float> masses;
+};
+
+//Writes header, with its offsets and counts filled in, the blocks, the attractors and the masses. Replaces path only
+//once the whole file is written, so the blocks can come from the very checkpoint being overwritten. False when the
+//file cannot be written.
+bool WriteCheckpoint(const std::filesystem::path& path, CheckpointHeader header, std::span<const std::byte> positions,
+    std::span<const std::byte> velocities, std::span<const float> attractors, std::span<const float> masses);
+//std::nullopt when the file is missing, of another version or too short for what its header announces
+[[nodiscard]] std::optional<Checkpoint> OpenCheckpoint(const std::filesystem::path& path);
+
+//Blocks of a planet system, either owned or adopted from a checkpoint without a copy.
+//Copies and resizes always own their blocks, so no two systems ever share mapped pages.
+template<typename T>
+class BlockStorage
+{
+public:
+    BlockStorage() = default;
+    //blocks must be aligned for T and stay inside file
+    BlockStorage(std::shared_ptr<MappedFile> file, std::span<std::byte> blocks) noexcept :
+        file_(std::move(file)), data_(reinterpret_cast<T*>(blocks.data())), size_(blocks.size() / sizeof(T))
+    {
+    }
+    BlockStorage(const BlockStorage& other) : owned_(other.begin(), other.end()), data_(owned_.data()), size_(owned_.size())
+    {
+    }
+    BlockStorage(BlockStorage&& other) noexcept :
+        file_(std::move(other.file_)), owned_(std::move(other.owned_)),
+        data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0))
+    {
+    }
+    BlockStorage& operator=(const BlockStorage& other)
+    {
+        if (this != &other)
+        {
+            *this = BlockStorage(other);
+        }
+        return *this;
+    }
+    BlockStorage& operator=(BlockStorage&& other) noexcept
+    {
+        file_ = std::move(other.file_);
+        owned_ = std::move(other.owned_);
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        return *this;
+    }
+
+    void resize(std::size_t size, const T& value)
+    {
+        if (file_ != nullptr)
+        {
+            owned_.assign(begin(), begin() + std::min(size, size_));
+            file_.reset();
+        }
+        owned_.resize(size, value);
+        data_ = owned_.data();
+        size_ = owned_.size();
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] T* data() noexcept { return data_; }
+    [[nodiscard]] const T* data() const noexcept { return data_; }
+    T& operator[](std::size_t index) noexcept { return data_[index]; }
+    const T& operator[](std::size_t index) const noexcept { return data_[index]; }
+    [[nodiscard]] const T* begin() const noexcept { return data_; }
+    [[nodiscard]] const T* end() const noexcept { return data_ + size_; }
+    [[nodiscard]] std::span<const std::byte> GetBytes() const noexcept { return std::as_bytes(std::span<const T>(data_, size_)); }
+    //True while the blocks are the pages of a checkpoint
+    [[nodiscard]] bool IsMapped() const noexcept { return file_ != nullptr; }
+private:
+    std::shared_ptr<MappedFile> file_;
+    //Moving a vector keeps its buffer, so data_ follows it through the moves
+    std::vector<T> owned_;
+    T* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "position_view.h"
+#include "vec.h"
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace planets
+{
+
+class ThreadPool;
+
+//Triangle list of one circle per planet, resolution triangles of (center, rim point, next rim point), all of one color
+class CircleMesh
+{
+public:
+    CircleMesh(int resolution, float radius, sf::Color color = sf::Color::White);
+
+    [[nodiscard]] std::size_t GetVertexCountPerPlanet() const noexcept { return offsets_.size(); }
+    //Writes the circle of every planet of positions scaled by scale, whole vertices with the color and texture coordinates 0.
+    //vertices holds GetVertexCountPerPlanet() vertices per planet, usually the storage of an sf::VertexArray.
+    void Emit(const PositionView& positions, float scale, std::span<sf::Vertex> vertices, ThreadPool* threadPool = nullptr) const;
+    //Same for the planets whose circle overlaps bounds (in scaled units), packed at the front of vertices in planet order.
+    //Returns the number of circles written.
+    std::size_t EmitVisible(const PositionView& positions, float scale, const sf::FloatRect& bounds,
+        std::span<sf::Vertex> vertices, ThreadPool* threadPool = nullptr) const;
+private:
+    //Floats of an sf::Vertex, its position first
+    static constexpr std::size_t vertexFloats = sizeof(sf::Vertex) / sizeof(float);
+    //Four floats of a circle's vertices. offsets holds the vertex offsets on the position lanes and 0 on the others,
+    //fill the color and texture coordinates on the others and 0 on the position lanes.
+    struct Row
+    {
+        FourFloat offsets;
+        FourFloat fill;
+    };
+
+    //Writes the vertices of one circle around center
+    void WriteCircle(float centerX, float centerY, sf::Vertex* circle) const noexcept;
+
+    float radius_ = 0.0f;
+    sf::Color color_;
+    //Offset of each vertex of a circle from its planet, in pixels
+    std::vector<sf::Vector2f> offsets_;
+    //A circle as whole rows, its last vertices when fewer than four floats are left are written from offsets_
+    std::vector<Row> rows_;
+    //The fields under the lanes repeat every vertexFloats rows, these flag the x lanes and the position lanes of each
+    std::array<FourFloat, vertexFloats> xMasks_;
+    std::array<FourFloat, vertexFloats> positionMasks_;
+};
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "position_view.h"
+#include "vec.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace planets
+{
+
+class ThreadPool;
+
+inline namespace PLANETS_ISA
+{
+
+//Uniform grid broadphase for planet to planet contacts. The cells are as wide as the contact distance and wrapped
+//into a table of twice the planet count, so only the 3x3 cells around a planet can hold its contacts whatever the
+//extent of the planets. The planets are counting sorted by cell with atomic counters, and each planet tests the
+//sorted cells around it a lane block at a time.
+class CollisionGrid
+{
+public:
+    //Finds, for every planet of positions, its nearest other planet closer than distance (ties to the lowest index).
+    //The result does not depend on the thread count. Returns the number of planets with such a neighbor.
+    std::size_t FindNearest(const PositionView& positions, float distance, ThreadPool* threadPool = nullptr);
+    //Per planet of the last FindNearest, the index of its nearest neighbor or -1
+    [[nodiscard]] std::span<const std::int32_t> GetNearest() const noexcept { return nearest_; }
+private:
+    void SortByCell(const PositionView& positions, float inverseCellSize, ThreadPool* threadPool);
+
+    std::uint32_t tableMask_ = 0;
+    std::uint32_t rowStride_ = 1;
+    std::vector<std::uint32_t> cellOfPlanet_;
+    //Exclusive end of every cell in the sorted arrays, its begin is the end of the cell before
+    std::vector<std::uint32_t> cellEnds_;
+    //Planets in cell order, padded with one lane block far from every planet for the loads past the last cell
+    std::vector<float> sortedXs_;
+    std::vector<float> sortedYs_;
+    std::vector<std::uint32_t> sortedIds_;
+    std::vector<std::int32_t> nearest_;
+};
+
+}
+}
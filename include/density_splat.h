@@ -0,0 +1,43 @@
+#pragma once
+
+#include "position_view.h"
+
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/Graphics/Rect.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace planets
+{
+
+class ThreadPool;
+
+//Planet count per pixel of a width x height image covering some bounds, the level of detail used when the circles
+//would be smaller than a pixel. Accumulate bins the planets, the RGBA pixels are then ready for sf::Texture::update.
+class DensitySplat
+{
+public:
+    DensitySplat(unsigned width, unsigned height);
+    void Resize(unsigned width, unsigned height);
+
+    //Replaces the counts with the planets inside bounds (in scaled units), pixel (0, 0) is the top left of bounds
+    void Accumulate(const PositionView& positions, float scale, const sf::FloatRect& bounds, ThreadPool* threadPool = nullptr);
+    //Fills the RGBA pixels with color, fading from transparent for empty pixels to opaque for dense ones
+    void Shade(sf::Color color, ThreadPool* threadPool = nullptr);
+
+    [[nodiscard]] unsigned GetWidth() const noexcept { return width_; }
+    [[nodiscard]] unsigned GetHeight() const noexcept { return height_; }
+    [[nodiscard]] const std::vector<std::uint32_t>& GetCounts() const noexcept { return counts_; }
+    [[nodiscard]] const std::uint8_t* GetPixels() const noexcept { return pixels_.data(); }
+private:
+    unsigned width_ = 0;
+    unsigned height_ = 0;
+    std::vector<std::uint32_t> counts_;
+    //One private count buffer per thread, summed into counts_
+    std::vector<std::vector<std::uint32_t>> sliceCounts_;
+    std::vector<std::uint8_t> pixels_;
+};
+
+}
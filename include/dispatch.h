@@ -0,0 +1,96 @@
+#pragma once
+
+#include "attractor.h"
+#include "checkpoint.h"
+#include "integrator.h"
+#include "intrinsics.h"
+#include "position_view.h"
+#include <SFML/System/Vector2.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+namespace planets
+{
+//The namespace of this translation unit has to be declared inline before the other kernel namespaces below
+inline namespace PLANETS_ISA
+{
+}
+
+class ThreadPool;
+
+//Ordered from the most to the least widely supported
+enum class Isa
+{
+    Sse,
+    Avx2,
+    Avx512
+};
+
+//Best instruction set supported by both the cpu and the os
+[[nodiscard]] Isa DetectIsa() noexcept;
+[[nodiscard]] std::optional<Isa> ParseIsa(std::string_view name) noexcept;
+[[nodiscard]] std::string_view GetIsaName(Isa isa) noexcept;
+//Float lanes of the widest PlanetSystem the isa has intrinsics for
+[[nodiscard]] int GetLaneWidth(Isa isa) noexcept;
+
+//Detected isa, lowered by a --isa=<sse|avx2|avx512> argument or else the PLANETS_ISA environment variable.
+//A request above what the cpu supports falls back to the detected isa.
+[[nodiscard]] Isa SelectIsa(int argc, char** argv) noexcept;
+
+//Isa independent handle on the PlanetSystem variants of the kernel namespaces
+class PlanetSystemInterface
+{
+public:
+    virtual ~PlanetSystemInterface() = default;
+    virtual void Update(float dt) noexcept = 0;
+    //steps updates of dt in one pass over the planets, see BasicPlanetSystem::Update
+    virtual void Update(float dt, int steps) noexcept = 0;
+    [[nodiscard]] virtual sf::Vector2f GetPosition(int index) const = 0;
+    [[nodiscard]] virtual PositionView GetPositions() const noexcept = 0;
+    //Writes every position multiplied by scale, positions must hold at least the planet count
+    virtual void WritePositions(std::span<sf::Vector2f> positions, float scale) const noexcept = 0;
+    virtual void SetIntegrator(Integrator integrator) noexcept = 0;
+    //Sum of the specific orbital energies, to follow the integration error
+    [[nodiscard]] virtual double GetEnergy() const noexcept = 0;
+    //Simulated seconds since the planets were generated, checkpoints included
+    [[nodiscard]] virtual double GetTime() const noexcept = 0;
+    //See BasicPlanetSystem::SetCollisionRadius, the planet count of GetPositions drops as planets merge
+    virtual void SetCollisionRadius(float radius) noexcept = 0;
+    //See BasicPlanetSystem::SetAttractors
+    virtual void SetAttractors(std::span<const Attractor> attractors) = 0;
+    //See BasicPlanetSystem::SaveCheckpoint
+    virtual bool SaveCheckpoint(const std::filesystem::path& path) const = 0;
+};
+
+//width is the lane count (1, 4, 8 or 16), returns nullptr for any other width.
+//The planets of a seed are the same whatever the isa, width and thread pool, up to float rounding across isas and widths.
+//Without a seed they come from std::random_device.
+[[nodiscard]] std::unique_ptr<PlanetSystemInterface> CreatePlanetSystem(
+    Isa isa, int width, std::size_t planetCount, ThreadPool* threadPool = nullptr, std::optional<std::uint64_t> seed = std::nullopt);
+
+//Resumes the planet system saved in a checkpoint, with the width it was saved with.
+//nullptr when the file is missing, corrupt or not from one of the float widths above.
+[[nodiscard]] std::unique_ptr<PlanetSystemInterface> LoadPlanetSystem(
+    Isa isa, const std::filesystem::path& path, ThreadPool* threadPool = nullptr);
+
+//One factory per kernel namespace, see PLANETS_ISA in intrinsics.h
+#define PLANETS_DECLARE_KERNEL_FACTORY(isa) \
+    namespace isa \
+    { \
+    [[nodiscard]] std::unique_ptr<PlanetSystemInterface> CreatePlanetSystem( \
+        int width, std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed); \
+    [[nodiscard]] std::unique_ptr<PlanetSystemInterface> LoadPlanetSystem(Checkpoint checkpoint, ThreadPool* threadPool); \
+    }
+
+PLANETS_DECLARE_KERNEL_FACTORY(sse)
+PLANETS_DECLARE_KERNEL_FACTORY(avx2)
+PLANETS_DECLARE_KERNEL_FACTORY(avx512)
+
+#undef PLANETS_DECLARE_KERNEL_FACTORY
+}
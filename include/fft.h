@@ -0,0 +1,34 @@
+#pragma once
+
+#include "intrinsics.h"
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Radix-2 complex FFT of a fixed power of two size, the twiddles of each stage and the bit reversal are computed once
+class Fft
+{
+public:
+    explicit Fft(std::size_t size);
+    //In place, the inverse is not scaled by 1/size
+    void Forward(std::complex<float>* data) const noexcept;
+    void Inverse(std::complex<float>* data) const noexcept;
+
+    [[nodiscard]] std::size_t GetSize() const noexcept { return size_; }
+private:
+    void Transform(std::complex<float>* data) const noexcept;
+
+    std::size_t size_ = 0;
+    std::vector<std::complex<float>> twiddles_;
+    std::vector<std::uint32_t> bitReversal_;
+};
+
+}
+}
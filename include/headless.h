@@ -0,0 +1,69 @@
+#pragma once
+
+#include "dispatch.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace planets
+{
+
+//Settings of a windowless run of the frame pipeline, see ParseHeadlessOptions
+struct HeadlessOptions
+{
+    std::size_t planetCount = 10'000;
+    //Lane count of the PlanetSystem, as in CreatePlanetSystem
+    int width = 0;
+    int steps = 1'000;
+    //Frames run before timing starts
+    int warmupSteps = 10;
+    float dt = 1.0f / 60.0f;
+    Integrator integrator = Integrator::Euler;
+    //0 uses every hardware thread
+    std::size_t threadCount = 0;
+    //Same planets on every run with the same seed, random ones without
+    std::optional<std::uint64_t> seed;
+    //Checkpoint to start from instead of new planets, its planet count and width replace the options
+    std::filesystem::path resume;
+    //Where to save the state after the last step
+    std::filesystem::path checkpoint;
+    //Trajectory file recording every frame, warmup included, see TrajectoryRecorder
+    std::filesystem::path record;
+    //Planets touching at the drawn circle radius merge, see PlanetSystem::SetCollisionRadius
+    bool collisions = false;
+    //Set when an argument was not recognized or had an invalid value, a mistyped option must not run with the defaults
+    bool invalidOptions = false;
+};
+
+//Options of a --headless run, std::nullopt without --headless. Recognized arguments are --collisions, --planets=<count>,
+//--backend=<1|4|8|16>, --steps=<count>, --warmup=<count>, --dt=<seconds>, --threads=<count>, --seed=<integer>,
+//--resume=<file>, --checkpoint=<file>, --record=<file> and --integrator=<euler|leapfrog|verlet|yoshida4>. Invalid values
+//keep their default, they and other arguments, but --isa, are reported to errors and set invalidOptions.
+//The backend defaults to the widest of isa.
+[[nodiscard]] std::optional<HeadlessOptions> ParseHeadlessOptions(int argc, char** argv, Isa isa, std::ostream& errors);
+
+//Value under which lies percent of the samples (nearest rank), samples is sorted in place
+[[nodiscard]] double Percentile(std::span<double> samples, double percent) noexcept;
+
+//Duration samples of one frame stage in milliseconds
+struct StageTimings
+{
+    std::string_view name;
+    std::vector<double> milliseconds;
+};
+
+//One line per stage with its p50, p90, p99 and max, stages are sorted in place
+void PrintTimings(std::span<StageTimings> stages, std::ostream& output);
+
+//Runs the simulation and the vertex building of the default view without a window and prints the stage timings
+//and the relative energy drift,
+//returns the process exit code
+int RunHeadless(const HeadlessOptions& options, Isa isa, std::ostream& output);
+
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace planets
+{
+
+//Time stepping schemes of the planet systems, by increasing cost per step.
+//Euler is semi-implicit (symplectic, first order), the others are symplectic and second or fourth order.
+enum class Integrator
+{
+    Euler,
+    //Drift, kick, drift: one force evaluation per step
+    Leapfrog,
+    //Kick, drift, kick: one force evaluation per step, the last one is kept for the next first kick
+    VelocityVerlet,
+    //Three leapfrog substeps with Yoshida's weights: three force evaluations per step
+    Yoshida4
+};
+
+constexpr std::string_view GetIntegratorName(Integrator integrator) noexcept
+{
+    switch (integrator)
+    {
+    case Integrator::Euler: return "euler";
+    case Integrator::Leapfrog: return "leapfrog";
+    case Integrator::VelocityVerlet: return "verlet";
+    case Integrator::Yoshida4: return "yoshida4";
+    }
+    return "euler";
+}
+
+constexpr std::optional<Integrator> ParseIntegrator(std::string_view name) noexcept
+{
+    for (const auto integrator : { Integrator::Euler, Integrator::Leapfrog, Integrator::VelocityVerlet, Integrator::Yoshida4 })
+    {
+        if (name == GetIntegratorName(integrator))
+        {
+            return integrator;
+        }
+    }
+    return std::nullopt;
+}
+
+}
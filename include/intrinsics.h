@@ -14,3 +14,14 @@
 #if defined(__GNUC__) || defined(__clang__)
 typedef float v4sf __attribute__ ((vector_size (16)));
 #endif
+
+//vec and planet kernels are compiled once per instruction set, each copy lives in its own inline namespace
+#if defined(__AVX512F__)
+#define PLANETS_ISA avx512
+#elif defined(__AVX2__)
+#define PLANETS_ISA avx2
+#elif defined(__SSE__)
+#define PLANETS_ISA sse
+#else
+#define PLANETS_ISA generic
+#endif
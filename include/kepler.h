@@ -0,0 +1,76 @@
+#pragma once
+
+#include "planet.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Planets moved along their exact two-body orbits around worldCenter. Positions and velocities are turned into orbital
+//elements once, then the position at any time is one Kepler equation solve, whatever the time jumped since the last one.
+//Elliptic orbits fill the first slots and hyperbolic ones the next, so all the blocks but one run a single solver.
+template<int N>
+class KeplerSystem
+{
+public:
+    //Same planets as BasicPlanetSystem for the same seed
+    explicit KeplerSystem(std::size_t planetCount, ThreadPool* threadPool = nullptr, std::uint64_t seed = RandomSeed());
+    KeplerSystem(std::span<const Vec2f> positions, std::span<const Vec2f> velocities, ThreadPool* threadPool = nullptr);
+
+    //Moves every planet to time since construction, backwards as well
+    void SetTime(double time) noexcept;
+    void Update(float dt) noexcept { SetTime(time_ + dt); }
+    [[nodiscard]] double GetTime() const noexcept { return time_; }
+    //Position at the last SetTime
+    Vec2f GetPosition(int index) const;
+    //Position at any time, without touching the others
+    [[nodiscard]] Vec2f ComputePosition(int index, double time) const;
+    //Blocks are elliptic orbits first, not in planet order, see PositionView
+    [[nodiscard]] PositionView GetPositions() const noexcept;
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+private:
+    //Elements of the N orbits of a block. Lengths are from the periapsis so near parabolic orbits keep their precision:
+    //an ellipse is periapsis - 2 a sin^2(E/2) along the periapsis direction and 2 b sin(E/2) cos(E/2) along the normal,
+    //a hyperbola periapsis - 2 a sinh^2(H/2) and 2 b sinh(H/2) cosh(H/2), with |a| for a
+    struct OrbitBlock
+    {
+        FloatArray<N> periapses;
+        FloatArray<N> semiMajorAxes;
+        FloatArray<N> semiMinorAxes;
+        FloatArray<N> eccentricities;
+        //|1 - e|, as the eccentricity is rounded off near 1
+        FloatArray<N> eccentricityGaps;
+        //Double so the phase n t keeps its precision however far the time jumps
+        std::array<double, N> meanMotions;
+        std::array<double, N> meanAnomalies;
+        NVec2f<N> periapsisDirections;
+        //Periapsis direction turned by 90 degrees towards the motion
+        NVec2f<N> normalDirections;
+    };
+
+    [[nodiscard]] NVec2f<N> ComputeBlock(std::size_t block, double time) const noexcept;
+    void Initialize(std::span<const Vec2f> positions, std::span<const Vec2f> velocities);
+
+    ThreadPool* threadPool_ = nullptr;
+    std::size_t planetCount_ = 0;
+    //First slot of the hyperbolic orbits
+    std::size_t hyperbolicBegin_ = 0;
+    double time_ = 0.0;
+
+    std::vector<OrbitBlock> orbits_;
+    std::vector<NVec2f<N>> positions_;
+    std::vector<std::uint32_t> slotOfPlanet_;
+};
+
+using KeplerSystem4 = KeplerSystem<4>;
+using KeplerSystem8 = KeplerSystem<8>;
+using KeplerSystem16 = KeplerSystem<16>;
+
+}
+}
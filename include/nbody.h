@@ -0,0 +1,95 @@
+#pragma once
+
+#include "planet.h"
+
+#include <span>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Adds the softened pull of the sources onto a block of targets
+template<int N>
+NVec2f<N> AccumulateGravity(const NVec2f<N>& targets, const float* xs, const float* ys,
+    const float* masses, std::size_t sourceCount) noexcept
+{
+    NVec2f<N> acceleration{ Vec2f::zero() };
+    const FloatArray<N> sqrSoftening{ gravitySoftening * gravitySoftening };
+    for (std::size_t i = 0; i < sourceCount; i++)
+    {
+        const NVec2f<N> source{ Vec2f{ xs[i], ys[i] } };
+        const auto delta = source - targets;
+        const auto sqrDistance = delta.SquareMagnitude() + sqrSoftening;
+        const auto inverseCube = FloatArray<N>{ G * masses[i] } / (sqrDistance * sqrDistance.Sqrt());
+        acceleration += delta * inverseCube;
+    }
+    return acceleration;
+}
+
+//Same as AccumulateGravity for TileSize target blocks at once, each source lane is broadcast once for the whole tile
+template<int N, int TileSize>
+void AccumulateGravityTile(const NVec2f<N>* targets, NVec2f<N>* accelerations,
+    const NVec2f<N>* sources, const FloatArray<N>* masses, std::size_t sourceBlockCount) noexcept
+{
+    std::array<NVec2f<N>, TileSize> tileAccelerations;
+    tileAccelerations.fill(NVec2f<N>{ Vec2f::zero() });
+    const FloatArray<N> sqrSoftening{ gravitySoftening * gravitySoftening };
+    for (std::size_t block = 0; block < sourceBlockCount; block++)
+    {
+        const auto& sourceBlock = sources[block];
+        const auto& massBlock = masses[block];
+        for (int lane = 0; lane < N; lane++)
+        {
+            const NVec2f<N> source{ Vec2f{ sourceBlock.Xs()[lane], sourceBlock.Ys()[lane] } };
+            const FloatArray<N> gm{ G * massBlock[lane] };
+            for (int t = 0; t < TileSize; t++)
+            {
+                const auto delta = source - targets[t];
+                const auto sqrDistance = delta.SquareMagnitude() + sqrSoftening;
+                tileAccelerations[t] += delta * (gm / (sqrDistance * sqrDistance.Sqrt()));
+            }
+        }
+    }
+    for (int t = 0; t < TileSize; t++)
+    {
+        accelerations[t] = tileAccelerations[t];
+    }
+}
+
+//Planets pulled by worldCenter and by each other with exact O(N^2) softened gravity
+template<int N>
+class DirectSumSystem
+{
+public:
+    //Target blocks sharing each broadcast source
+    static constexpr int tileSize = 4;
+
+    //Same planets as BasicPlanetSystem for the same seed
+    DirectSumSystem(std::size_t planetCount, ThreadPool* threadPool = nullptr, std::uint64_t seed = RandomSeed()) noexcept;
+    void Update(float dt) noexcept;
+    Vec2f GetPosition(int index) const;
+    //Planet to planet acceleration of the last Update, without worldCenter
+    Vec2f GetMutualAcceleration(int index) const;
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+
+    void ComputeMutualAccelerations() noexcept;
+private:
+    ThreadPool* threadPool_ = nullptr;
+    //Padded to a multiple of tileSize blocks, padding lanes have no mass
+    std::vector<NVec2f<N>> positions_;
+    std::vector<NVec2f<N>> velocities_;
+    std::vector<NVec2f<N>> accelerations_;
+    std::vector<FloatArray<N>> masses_;
+};
+
+using DirectSumSystem4 = DirectSumSystem<4>;
+using DirectSumSystem8 = DirectSumSystem<8>;
+using DirectSumSystem16 = DirectSumSystem<16>;
+
+//Exact softened planet to planet accelerations, the reference for the approximate solvers
+std::vector<Vec2f> ComputeDirectAccelerations(std::span<const Vec2f> positions, ThreadPool* threadPool = nullptr);
+
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "fft.h"
+#include "planet.h"
+
+#include <complex>
+#include <vector>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Planets pulled by worldCenter and by each other, the mutual gravity is solved on a gridSize x gridSize mesh
+//centered on worldCenter. Masses are deposited with cloud-in-cell weights, convolved with the softened force
+//kernel through a zero padded FFT (isolated boundaries) and interpolated back with the same weights.
+//Planets leaving the mesh only feel worldCenter.
+class ParticleMeshSystem
+{
+public:
+    //gridSize must be a power of two. Same planets as BasicPlanetSystem for the same seed.
+    ParticleMeshSystem(std::size_t planetCount, int gridSize = 256, ThreadPool* threadPool = nullptr, std::uint64_t seed = RandomSeed());
+    void Update(float dt) noexcept;
+    Vec2f GetPosition(int index) const;
+    //Planet to planet acceleration of the last Update, without worldCenter
+    Vec2f GetMutualAcceleration(int index) const;
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+
+    [[nodiscard]] float GetCellSize() const noexcept { return cellSize_; }
+
+    void ComputeMutualAccelerations() noexcept;
+private:
+    void Deposit() noexcept;
+    void SolveField() noexcept;
+    void Interpolate() noexcept;
+
+    ThreadPool* threadPool_ = nullptr;
+    std::size_t planetCount_ = 0;
+    std::size_t gridSize_ = 0;
+    Vec2f gridCorner_{};
+    float cellSize_ = 0.0f;
+
+    std::vector<LaneVec2f> positions_;
+    std::vector<LaneVec2f> velocities_;
+    std::vector<LaneVec2f> accelerations_;
+
+    //gridSize x gridSize mass per node, one grid per deposit slice
+    std::vector<std::vector<float>> sliceDensities_;
+    //2 gridSize wide padded mesh, holds the density then the field with ax in the real part and ay in the imaginary one
+    std::vector<std::complex<float>> mesh_;
+    //Spectrum of the force kernel kx + i ky, column major to match the column pass
+    std::vector<std::complex<float>> kernel_;
+    Fft fft_;
+};
+
+}
+}
@@ -1,13 +1,33 @@
 #pragma once
 
+#include "attractor.h"
+#include "checkpoint.h"
+#include "collision.h"
+#include "integrator.h"
+#include "position_view.h"
+#include "random.h"
 #include "vec.h"
+#include "vec_math.h"
 
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <numbers>
+#include <optional>
 #include <span>
+#include <type_traits>
+#include <vector>
 
 namespace planets
 {
 
+class ThreadPool;
+class PlanetSystemInterface;
+
+inline namespace PLANETS_ISA
+{
+
 constexpr float innerRadius = 1.5f;
 constexpr float outerRaidus = 5.5f;
 constexpr float pixelToMeter = 100.f;
@@ -16,63 +36,270 @@ constexpr Vec2f worldCenter{ 5.0f, 2.5f };
 //Shoudl not be equal to worldCenter
 constexpr Vec2f defaultPos{ 1.0f, 1.0f };
 constexpr Vec2f defaultVel{ 100.0f, 100.0f };
+//Mutual gravity between planets, used by the n-body engines
+constexpr float planetMass = 1.0e-5f;
+constexpr float gravitySoftening = 0.01f;
 
-struct Planet
+constexpr float CalculateAcceleration(float sqrRadius) noexcept
 {
-    Vec2f position{};
-    Vec2f velocity{};
+    return G / sqrRadius;
+}
+
+template<typename T, int N>
+SimdArray<T, N> CalculateAcceleration(const SimdArray<T, N>& sqrRadius) noexcept
+{
+    const SimdArray<T, N> g{ G };
+    return g / sqrRadius;
+}
+
+//How CalculateGravity gets 1 / |delta|^3, by decreasing speed.
+//Estimate cubes the hardware rsqrt (12 bits with SSE/AVX, 14 with AVX-512), Refined adds one Newton-Raphson
+//iteration (about 22 bits) and Exact divides by a square root. Lanes without an rsqrt instruction, double lanes
+//included, get the exact reciprocal square root in every tier.
+enum class GravityAccuracy
+{
+    Estimate,
+    Refined,
+    Exact
 };
 
-constexpr float CalculateAcceleration(float sqrRadius) noexcept
+inline float Sqrt(float x) noexcept
 {
-    return G / sqrRadius;
+    return std::sqrt(x);
 }
 
-inline FourFloat CalculateAcceleration(const FourFloat& sqrRadius) noexcept
+template<typename T, int N>
+SimdArray<T, N> Sqrt(const SimdArray<T, N>& x) noexcept
 {
-    const FourFloat g{ G };
-    return g / sqrRadius ;
+    return x.Sqrt();
 }
 
-inline EightFloat CalculateAcceleration(const EightFloat& sqrRadius) noexcept
+inline float ReciprocalSqrt(float x) noexcept
 {
-    const EightFloat g{ G };
-    return g / sqrRadius;
+#if defined(__SSE__)
+    return _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(x)));
+#else
+    return 1.0f / std::sqrt(x);
+#endif
 }
 
+template<typename T, int N>
+SimdArray<T, N> ReciprocalSqrt(const SimdArray<T, N>& x) noexcept
+{
+    return x.ReciprocalSqrt();
+}
 
+//1 / sqrRadius^(3/2) without a divide outside the Exact tier, Float is float or a SimdArray
+template<GravityAccuracy Accuracy, typename Float>
+inline Float InverseCube(const Float& sqrRadius) noexcept
+{
+    if constexpr (Accuracy == GravityAccuracy::Exact)
+    {
+        return Float{ 1.0f } / (sqrRadius * Sqrt(sqrRadius));
+    }
+    else
+    {
+        auto inverseRadius = ReciprocalSqrt(sqrRadius);
+        if constexpr (Accuracy == GravityAccuracy::Refined)
+        {
+            inverseRadius = inverseRadius * (Float{ 1.5f } - Float{ 0.5f } * sqrRadius * inverseRadius * inverseRadius);
+        }
+        return inverseRadius * inverseRadius * inverseRadius;
+    }
+}
 
-class PlanetSystem
+//Pull of worldCenter at delta from it, as -G delta / |delta|^3. The symplectic integrators need the Exact tier,
+//the estimate would cap their accuracy.
+template<GravityAccuracy Accuracy = GravityAccuracy::Exact>
+inline Vec2f CalculateGravity(const Vec2f& delta) noexcept
 {
-public:
-    PlanetSystem(std::size_t planetCount) noexcept;
-    void Update(float dt) noexcept;
-    Vec2f GetPosition(int index) const;
+    return delta * (-G * InverseCube<Accuracy>(delta.SquareMagnitude()));
+}
 
-private:
-    std::vector<Planet> planets_;
-};
+template<GravityAccuracy Accuracy = GravityAccuracy::Exact, typename T, int N>
+inline NVec2<T, N> CalculateGravity(const NVec2<T, N>& delta) noexcept
+{
+    return delta * (SimdArray<T, N>{ -G } * InverseCube<Accuracy>(delta.SquareMagnitude()));
+}
 
+//Orbits of the planets first to first + N - 1, radius in [innerRadius, outerRaidus) and angle in [0, pi). Every planet
+//starts perpendicular to worldCenter at the same speed sqrt(G), the circular speed at radius 1 only: the disk starts
+//at the pericenter of eccentric orbits, and past radius 2 that is the escape speed, so the outer planets fly away.
+//Planet i draws the counters 2i and 2i + 1 of rng, so every block can be generated on its own, by any thread.
+template<int N>
+void GenerateOrbits(const CounterRng& rng, std::size_t first, NVec2f<N>& positions, NVec2f<N>& velocities) noexcept
+{
+    constexpr auto pi = std::numbers::pi_v<float>;
+    const auto counter = 2 * static_cast<std::uint64_t>(first);
+    const auto radius = rng.Uniforms<N>(counter, 2) * (outerRaidus - innerRadius) + FloatArray<N>{ innerRadius };
+    //up rotated by angle is (-cos, -sin) of angle - pi/2, which stays in the range of SinCos
+    const auto angle = rng.Uniforms<N>(counter + 1, 2) * pi - FloatArray<N>{ pi / 2.0f };
+    FloatArray<N> sin, cos;
+    SinCos(angle, sin, cos);
+    positions = NVec2f<N>{ FloatArray<N>{ 0.0f } - cos * radius, FloatArray<N>{ 0.0f } - sin * radius } + NVec2f<N>{ worldCenter };
+    const auto speed = (CalculateAcceleration(radius) * radius).Sqrt();
+    velocities = NVec2f<N>{ FloatArray<N>{ 0.0f } - sin * speed, cos * speed };
+}
 
-class PlanetSystem4
+//Lane types of BasicPlanetSystem. ScalarBackend runs one planet per lane with plain floats and only takes Width 1.
+//SimdBackend packs Width planets in FloatArray/NVec2f, held in registers when this namespace has intrinsics for Width.
+//SimdDoubleBackend does the same in double for long runs, the planets still come in and out as floats.
+struct ScalarBackend
 {
-public:
-    PlanetSystem4(std::size_t planetCount) noexcept;
-    void Update(float dt) noexcept;
-    Vec2f GetPosition(int index) const;
-private:
-    std::vector<FourVec2f> positions_;
-    std::vector<FourVec2f> velocities_;
+    using Scalar = float;
+    template<int Width>
+    using Float = float;
+    template<int Width>
+    using Vec = Vec2f;
+
+    template<int Width>
+    static Vec2f Pack(const float* xs, const float* ys, int, Vec2f) noexcept
+    {
+        return { xs[0], ys[0] };
+    }
+
+    static Vec2f GetLane(const Vec2f& v, int) noexcept
+    {
+        return v;
+    }
+};
+
+template<typename T>
+struct BasicSimdBackend
+{
+    using Scalar = T;
+    template<int Width>
+    using Float = SimdArray<T, Width>;
+    template<int Width>
+    using Vec = NVec2<T, Width>;
+
+    //Loads count planets and fills the remaining lanes with fill
+    template<int Width>
+    static NVec2<T, Width> Pack(const float* xs, const float* ys, int count, Vec2f fill) noexcept
+    {
+        if constexpr (std::is_same_v<T, float>)
+        {
+            return { FloatArray<Width>{ xs, count, fill.x }, FloatArray<Width>{ ys, count, fill.y } };
+        }
+        else
+        {
+            std::array<T, Width> laneXs{}, laneYs{};
+            std::copy_n(xs, count, laneXs.begin());
+            std::copy_n(ys, count, laneYs.begin());
+            return { SimdArray<T, Width>{ laneXs.data(), count, fill.x }, SimdArray<T, Width>{ laneYs.data(), count, fill.y } };
+        }
+    }
+
+    template<int Width>
+    static Vec2f GetLane(const NVec2<T, Width>& v, int lane) noexcept
+    {
+        return { static_cast<float>(v.Xs()[lane]), static_cast<float>(v.Ys()[lane]) };
+    }
 };
+using SimdBackend = BasicSimdBackend<float>;
+using SimdDoubleBackend = BasicSimdBackend<double>;
 
-class PlanetSystem8
+//Planets pulled by a list of attractors, the star at worldCenter by default, stored in blocks of Width lanes.
+//Unroll blocks are updated side by side so their div and sqrt chains overlap.
+template<int Width, typename Backend, int Unroll = 1>
+class BasicPlanetSystem
 {
 public:
-    PlanetSystem8(std::size_t planetCount) noexcept;
-    void Update(float dt) noexcept;
+    using Float = typename Backend::template Float<Width>;
+    using Vec = typename Backend::template Vec<Width>;
+
+    //threadPool is optional and not owned, Update stays single threaded without it.
+    //The planets are generated on threadPool too, the same seed gives the same planets whatever its thread count.
+    BasicPlanetSystem(std::size_t planetCount, ThreadPool* threadPool = nullptr, std::uint64_t seed = RandomSeed()) noexcept;
+    void Update(float dt) noexcept { Update(dt, 1); }
+    //Same result as steps calls to Update(dt), but each cache sized chunk of blocks takes all its steps at once, so
+    //sizes past the caches are not bound by streaming the state through memory on every step
+    void Update(float dt, int steps) noexcept;
     Vec2f GetPosition(int index) const;
+    //Whole state without per planet calls, see PositionView. The double backend converts the positions to floats first.
+    [[nodiscard]] PositionView GetPositions() const noexcept;
+    //Writes the planetCount positions multiplied by scale, positions must hold at least planetCount elements
+    void WritePositions(std::span<sf::Vector2f> positions, float scale = 1.0f) const noexcept;
+    Vec2f GetVelocity(int index) const;
+    //Sum of the specific orbital energies v^2/2 - sum of G mass/r over the attractors, constant under the exact motion
+    //while the attractors stand still
+    [[nodiscard]] double GetEnergy() const noexcept;
+    void SetThreadPool(ThreadPool* threadPool) noexcept { threadPool_ = threadPool; }
+    void SetIntegrator(Integrator integrator) noexcept;
+    [[nodiscard]] Integrator GetIntegrator() const noexcept { return integrator_; }
+    //Simulated seconds since the planets were generated
+    [[nodiscard]] double GetTime() const noexcept { return time_; }
+    [[nodiscard]] std::uint64_t GetSeed() const noexcept { return seed_; }
+    [[nodiscard]] std::size_t GetPlanetCount() const noexcept { return planetCount_; }
+
+    //Planets closer than twice radius merge at the end of every Update into one planet at their center of mass,
+    //with the sum of their masses and momenta. Chains of touching planets merge as a whole. 0, the default, lets
+    //them pass through each other. Merged planets are compacted by moving the last planets into the freed indices.
+    void SetCollisionRadius(float radius) noexcept { collisionRadius_ = radius; }
+    [[nodiscard]] float GetCollisionRadius() const noexcept { return collisionRadius_; }
+    //planetMass times the number of planets merged into it, saved in checkpoints with the collision radius
+    [[nodiscard]] float GetMass(int index) const;
+
+    //Replaces the star at worldCenter, which the planets are still generated around. The update cost grows linearly
+    //with the attractor count, none lets the planets fly straight.
+    void SetAttractors(std::span<const Attractor> attractors);
+    //Where the attractors are at GetTime, moved by every Update
+    [[nodiscard]] std::span<const Attractor> GetAttractors() const noexcept { return attractors_; }
+
+    //Writes the blocks and the metadata to path, see checkpoint.h. False when the file cannot be written.
+    bool SaveCheckpoint(const std::filesystem::path& path) const;
+    //Resumes from a checkpoint saved with the same Width and lane type. The blocks are used in place from the mapped
+    //file, its pages are only read as the updates reach them. std::nullopt for a missing, corrupt or foreign file.
+    [[nodiscard]] static std::optional<BasicPlanetSystem> LoadCheckpoint(const std::filesystem::path& path, ThreadPool* threadPool = nullptr);
+    [[nodiscard]] static std::optional<BasicPlanetSystem> LoadCheckpoint(Checkpoint checkpoint, ThreadPool* threadPool = nullptr);
+    //True while the blocks are still the pages of the checkpoint they were loaded from
+    [[nodiscard]] bool IsMapped() const noexcept { return positions_.IsMapped(); }
 private:
-    std::vector<EightVec2f> positions_;
-    std::vector<EightVec2f> velocities_;
+    BasicPlanetSystem() = default;
+    void UpdateBlocks(float dt, int steps, std::size_t begin, std::size_t end) noexcept;
+    struct LaneAttractor;
+    template<Integrator I, std::size_t AttractorCount>
+    void StepBlocks(float dt, std::span<const LaneAttractor, AttractorCount> attractors, std::size_t begin, std::size_t end) noexcept;
+    void ComputeAccelerations(std::size_t begin, std::size_t end) noexcept;
+    void MergeCollisions();
+
+    ThreadPool* threadPool_ = nullptr;
+    std::size_t planetCount_ = 0;
+    Integrator integrator_ = Integrator::Euler;
+    double time_ = 0.0;
+    std::uint64_t seed_ = 0;
+    //Padded to a multiple of Unroll blocks
+    BlockStorage<Vec> positions_;
+    BlockStorage<Vec> velocities_;
+    //Gravity at the current positions, only kept by VelocityVerlet
+    std::vector<Vec> accelerations_;
+    //Float copy of the positions handed out by GetPositions when the lanes are not floats
+    mutable std::vector<float> floatPositions_;
+    float collisionRadius_ = 0.0f;
+    CollisionGrid collisionGrid_;
+    //Empty until the first merge, every planet then weighs planetMass
+    std::vector<float> masses_;
+    std::vector<Attractor> attractors_{ Attractor{ static_cast<sf::Vector2f>(worldCenter), {}, 1.0f } };
+    //attractors_ broadcast to every lane by SetAttractors, gm is G * mass
+    struct LaneAttractor
+    {
+        Vec position;
+        Float gm;
+    };
+    std::vector<LaneAttractor> laneAttractors_{ LaneAttractor{ Vec{ worldCenter }, Float{ G } } };
+    //Set when an attractor has a velocity, the Update then samples them once per step into stepAttractors_, one run of
+    //laneAttractors_.size() per step
+    bool attractorsMove_ = false;
+    std::vector<LaneAttractor> stepAttractors_;
 };
-}
\ No newline at end of file
+
+//Two blocks in flight never lost in the BM_Update grid and helps the scalar and eight lane versions
+using PlanetSystem = BasicPlanetSystem<1, ScalarBackend, 2>;
+using PlanetSystem4 = BasicPlanetSystem<4, SimdBackend, 2>;
+using PlanetSystem8 = BasicPlanetSystem<8, SimdBackend, 2>;
+using PlanetSystem16 = BasicPlanetSystem<16, SimdBackend, 2>;
+using DoublePlanetSystem4 = BasicPlanetSystem<4, SimdDoubleBackend, 2>;
+using DoublePlanetSystem8 = BasicPlanetSystem<8, SimdDoubleBackend, 2>;
+
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+
+#include <cstddef>
+#include <span>
+
+namespace planets
+{
+
+//Read only SoA view on the positions of a planet system, valid until its next Update.
+//Block b stores laneCount xs then laneCount ys, planet i is lane i % laneCount of block i / laneCount.
+//The last block may hold padding lanes past planetCount.
+class PositionView
+{
+public:
+    PositionView() = default;
+    PositionView(const float* data, std::size_t planetCount, std::size_t laneCount) noexcept :
+        data_(data), planetCount_(planetCount), laneCount_(laneCount)
+    {
+    }
+
+    [[nodiscard]] std::size_t GetPlanetCount() const noexcept { return planetCount_; }
+    [[nodiscard]] std::size_t GetLaneCount() const noexcept { return laneCount_; }
+    [[nodiscard]] std::size_t GetBlockCount() const noexcept { return (planetCount_ + laneCount_ - 1) / laneCount_; }
+
+    //Every block back to back, padding lanes included
+    [[nodiscard]] std::span<const float> GetData() const noexcept
+    {
+        return { data_, GetBlockCount() * 2 * laneCount_ };
+    }
+
+    [[nodiscard]] std::span<const float> Xs(std::size_t block) const noexcept
+    {
+        return { data_ + block * 2 * laneCount_, laneCount_ };
+    }
+
+    [[nodiscard]] std::span<const float> Ys(std::size_t block) const noexcept
+    {
+        return { data_ + block * 2 * laneCount_ + laneCount_, laneCount_ };
+    }
+
+    [[nodiscard]] sf::Vector2f operator[](std::size_t index) const noexcept
+    {
+        const auto block = index / laneCount_;
+        const auto lane = index % laneCount_;
+        return { Xs(block)[lane], Ys(block)[lane] };
+    }
+private:
+    const float* data_ = nullptr;
+    std::size_t planetCount_ = 0;
+    std::size_t laneCount_ = 1;
+};
+
+}
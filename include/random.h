@@ -0,0 +1,76 @@
+#pragma once
+
+#include "vec.h"
+
+#include <array>
+#include <cstdint>
+#include <random>
+
+namespace planets
+{
+
+//For runs that do not ask for a seed
+inline std::uint64_t RandomSeed()
+{
+    std::random_device rd;
+    return (static_cast<std::uint64_t>(rd()) << 32) | rd();
+}
+
+inline namespace PLANETS_ISA
+{
+
+//Counter based random numbers: the number at counter is a hash of the counter and the seed, not a state advanced
+//by the previous draws, so any thread can draw any part of the sequence in any order and get the same numbers.
+//Counters are 64 bit so runs past 2^31 planets do not wrap, the high word only changes the key and the low word is
+//hashed with plain 32 bit integer operations, a fixed count of lanes is turned into vector code by the compiler.
+class CounterRng
+{
+public:
+    explicit CounterRng(std::uint64_t seed) noexcept :
+        key_(Mix(static_cast<std::uint32_t>(seed) ^ Mix(static_cast<std::uint32_t>(seed >> 32) + 0x9E3779B9u)))
+    {
+    }
+
+    [[nodiscard]] std::uint32_t Bits(std::uint64_t counter) const noexcept
+    {
+        //Mix(0) is 0, so the counters under 2^32 keep the seed key. Adding the key between the rounds keeps two seeds
+        //from giving shuffles of the same numbers.
+        const auto key = key_ + Mix(static_cast<std::uint32_t>(counter >> 32));
+        return Mix(Mix(static_cast<std::uint32_t>(counter) ^ key) + key);
+    }
+
+    //Uniform in [0, 1), from the 24 high bits
+    [[nodiscard]] float Uniform(std::uint64_t counter) const noexcept
+    {
+        return static_cast<float>(Bits(counter) >> 8) * 0x1.0p-24f;
+    }
+
+    //Uniform(first + i * stride) in lane i
+    template<int N>
+    [[nodiscard]] FloatArray<N> Uniforms(std::uint64_t first, std::uint64_t stride) const noexcept
+    {
+        std::array<float, N> lanes;
+        for (int i = 0; i < N; i++)
+        {
+            lanes[i] = Uniform(first + static_cast<std::uint64_t>(i) * stride);
+        }
+        return FloatArray<N>{ lanes.data() };
+    }
+
+private:
+    //lowbias32 finalizer by Chris Wellons, a bijection of the 32 bit integers
+    static constexpr std::uint32_t Mix(std::uint32_t x) noexcept
+    {
+        x ^= x >> 16;
+        x *= 0x7FEB352Du;
+        x ^= x >> 15;
+        x *= 0x846CA68Bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    std::uint32_t key_ = 0;
+};
+
+}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "position_view.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace planets
+{
+
+class PlanetSystemInterface;
+
+//Copy of the positions of a planet system after a simulation step, time is when the step is due on the wall clock
+struct PositionSnapshot
+{
+    std::vector<float> data;
+    std::size_t planetCount = 0;
+    std::size_t laneCount = 1;
+    std::chrono::steady_clock::time_point time{};
+    std::uint64_t step = 0;
+
+    void Assign(const PositionView& positions);
+    [[nodiscard]] PositionView GetView() const noexcept { return { data.data(), planetCount, laneCount }; }
+};
+
+//Lock free hand over of snapshots from one writer thread to one reader thread, neither ever waits.
+//The writer fills GetBack and publishes it, the reader picks up the latest published snapshot with Acquire and keeps
+//the one before it for interpolation. Snapshots published between two Acquire calls are skipped.
+class SnapshotBuffer
+{
+public:
+    //Writer thread
+    [[nodiscard]] PositionSnapshot& GetBack() noexcept { return snapshots_[back_]; }
+    void Publish() noexcept;
+
+    //Reader thread, true when a newer snapshot became the front, the previous front then becomes GetPrevious
+    bool Acquire() noexcept;
+    [[nodiscard]] const PositionSnapshot& GetFront() const noexcept { return snapshots_[front_]; }
+    [[nodiscard]] const PositionSnapshot& GetPrevious() const noexcept { return snapshots_[previous_]; }
+private:
+    static constexpr std::uint32_t freshBit = 4;
+
+    //Each snapshot is owned by exactly one of the slots below, the middle one is swapped atomically
+    std::array<PositionSnapshot, 4> snapshots_;
+    std::uint32_t back_ = 0;
+    //Index of the middle snapshot, with freshBit set when the reader has not taken it yet
+    std::atomic<std::uint32_t> middle_{ 1 };
+    std::uint32_t front_ = 2;
+    std::uint32_t previous_ = 3;
+};
+
+//Steps a planet system with a fixed dt on its own thread, paced on the wall clock, and hands its positions to the
+//render thread through a SnapshotBuffer. The planet system must not be used by anything else while this runs.
+class SimulationThread
+{
+public:
+    SimulationThread(PlanetSystemInterface& planetSystem, float fixedDt);
+    ~SimulationThread() = default;
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    //Render thread, positions at now minus one fixed step, interpolated between the last two snapshots.
+    //Valid until the next call.
+    [[nodiscard]] PositionView GetPositions(std::chrono::steady_clock::time_point now);
+
+    [[nodiscard]] float GetFixedDt() const noexcept { return fixedDt_; }
+    [[nodiscard]] std::uint64_t GetStepCount() const noexcept { return stepCount_.load(std::memory_order_relaxed); }
+private:
+    void Run(std::stop_token stopToken);
+    void PublishSnapshot(std::chrono::steady_clock::time_point time, std::uint64_t step);
+
+    PlanetSystemInterface& planetSystem_;
+    float fixedDt_;
+    std::atomic<std::uint64_t> stepCount_{ 0 };
+    SnapshotBuffer snapshots_;
+    std::vector<float> interpolated_;
+    //Last member, so it is stopped and joined before the rest is destroyed
+    std::jthread thread_;
+};
+
+//previous + (current - previous) * alpha for every float
+void Interpolate(std::span<const float> previous, std::span<const float> current, float alpha, std::span<float> result) noexcept;
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace planets
+{
+
+//Work stealing pool: each thread owns a contiguous slice of the chunks and steals from the back of the others.
+//The calling thread takes part in ParallelFor, so a pool of N threads spawns N-1 workers.
+//ParallelFor must not be called concurrently or recursively on the same pool.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Calls func(chunkBegin, chunkEnd) on every chunk of [begin, end) and waits for all of them
+    void ParallelFor(std::size_t begin, std::size_t end, std::size_t chunkSize,
+        const std::function<void(std::size_t, std::size_t)>& func);
+
+    [[nodiscard]] std::size_t GetThreadCount() const noexcept { return slices_.size(); }
+private:
+    void WorkerLoop(std::size_t workerIndex);
+    void RunChunks(std::size_t workerIndex);
+    bool PopFront(std::size_t sliceIndex, std::uint32_t& chunk) noexcept;
+    bool PopBack(std::size_t sliceIndex, std::uint32_t& chunk) noexcept;
+
+    struct alignas(64) Slice
+    {
+        //Packed [begin, end) of chunk indices, begin in the low half
+        std::atomic<std::uint64_t> range{0};
+    };
+
+    std::vector<Slice> slices_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable startCondition_;
+    std::condition_variable doneCondition_;
+    std::uint64_t jobEpoch_ = 0;
+    std::size_t busyWorkers_ = 0;
+    bool stop_ = false;
+
+    const std::function<void(std::size_t, std::size_t)>* func_ = nullptr;
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    std::size_t chunkSize_ = 1;
+};
+
+//Runs the chunks on threadPool, or one after the other on the calling thread when threadPool is null
+void ParallelFor(ThreadPool* threadPool, std::size_t begin, std::size_t end, std::size_t chunkSize,
+    const std::function<void(std::size_t, std::size_t)>& func);
+
+}
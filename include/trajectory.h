@@ -0,0 +1,137 @@
+#pragma once
+
+#include "position_view.h"
+#include "simulation_thread.h"
+#include <SFML/System/Vector2.hpp>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace planets
+{
+
+//Position history file: a TrajectoryHeader, then for every frame a TrajectoryFrameHeader and its payload.
+//Positions are rounded to multiples of the quantum and every coordinate is stored as its difference to the
+//linear extrapolation of the two frames before, zigzag and LEB128 varint encoded: every x in planet order, then every y.
+//The prediction starts over on the first frame and whenever the planet count changes.
+constexpr std::array<char, 8> trajectoryMagic{ 'P', 'L', 'A', 'N', 'T', 'R', 'A', 'J' };
+constexpr std::uint32_t trajectoryVersion = 1;
+
+struct TrajectoryHeader
+{
+    std::array<char, 8> magic = trajectoryMagic;
+    std::uint32_t version = trajectoryVersion;
+    std::uint32_t reserved = 0;
+    //Meters per quantization step
+    double quantum = 0.0;
+};
+
+struct TrajectoryFrameHeader
+{
+    double time = 0.0;
+    std::uint64_t planetCount = 0;
+    std::uint64_t payloadSize = 0;
+};
+
+//Quantizes and encodes positions against the two frames before, keeps the quantized frames for the next one
+class TrajectoryEncoder
+{
+public:
+    explicit TrajectoryEncoder(double quantum) noexcept : scale_(static_cast<float>(1.0 / quantum)) {}
+
+    //Encoded frame, valid until the next call
+    [[nodiscard]] std::span<const std::uint8_t> Encode(const PositionView& positions);
+private:
+    float scale_;
+    std::size_t history_ = 0;
+    std::vector<std::int32_t> previous_;
+    std::vector<std::int32_t> current_;
+    std::vector<std::uint32_t> residuals_;
+    std::vector<std::uint8_t> payload_;
+};
+
+//Records the positions of a planet system to a trajectory file. Record only copies the positions, the encoding
+//and the writing happen on a writer thread fed through a bounded queue of snapshots. Record waits for the writer
+//when the queue is full, so a slow disk slows the simulation down rather than dropping frames.
+class TrajectoryRecorder
+{
+public:
+    //nullptr when the file cannot be created. queueCapacity is the count of snapshots waiting for the writer.
+    [[nodiscard]] static std::unique_ptr<TrajectoryRecorder> Create(
+        const std::filesystem::path& path, double quantum = 1.0e-4, std::size_t queueCapacity = 8);
+    //Writes the snapshots still in the queue
+    ~TrajectoryRecorder() = default;
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    //time is the simulated time of the positions
+    void Record(const PositionView& positions, double time);
+    //Waits for the queue to be written out, false once a write failed
+    bool Flush();
+
+    [[nodiscard]] std::uint64_t GetFrameCount() const noexcept { return frameCount_; }
+    //Bytes written so far, headers included
+    [[nodiscard]] std::uint64_t GetWrittenBytes() const noexcept { return writtenBytes_.load(std::memory_order_relaxed); }
+private:
+    TrajectoryRecorder(std::ofstream output, double quantum, std::size_t queueCapacity);
+    void Run(std::stop_token stopToken);
+
+    std::ofstream output_;
+    TrajectoryEncoder encoder_;
+    std::uint64_t frameCount_ = 0;
+    std::atomic<std::uint64_t> writtenBytes_{ 0 };
+    std::atomic<bool> failed_{ false };
+
+    //Ring of snapshots: Record fills slot head_ % size while the writer encodes slot tail_ % size
+    std::vector<PositionSnapshot> snapshots_;
+    std::vector<double> times_;
+    std::uint64_t head_ = 0;
+    std::uint64_t tail_ = 0;
+    std::mutex mutex_;
+    std::condition_variable freeCondition_;
+    std::condition_variable_any queuedCondition_;
+    //Last member, so it is stopped and joined before the rest is destroyed
+    std::jthread thread_;
+};
+
+//Positions of one recorded frame, in planet order
+struct TrajectoryFrame
+{
+    double time = 0.0;
+    std::vector<sf::Vector2f> positions;
+};
+
+//Streams the frames of a trajectory file back one after the other, only the current frame is held in memory
+class TrajectoryReader
+{
+public:
+    //nullptr when the file is missing or not a trajectory of this version
+    [[nodiscard]] static std::unique_ptr<TrajectoryReader> Open(const std::filesystem::path& path);
+
+    //Decodes the next frame into frame, false at the end of the file or on a corrupt frame
+    bool Next(TrajectoryFrame& frame);
+
+    [[nodiscard]] double GetQuantum() const noexcept { return quantum_; }
+private:
+    TrajectoryReader(std::ifstream input, double quantum) noexcept : input_(std::move(input)), quantum_(quantum) {}
+
+    std::ifstream input_;
+    double quantum_;
+    std::size_t history_ = 0;
+    std::vector<std::int32_t> previous_;
+    std::vector<std::int32_t> current_;
+    std::vector<std::uint8_t> payload_;
+};
+
+}
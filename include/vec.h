@@ -4,11 +4,17 @@
 #include <SFML/System/Vector2.hpp>
 
 #include <cmath>
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cstdint>
 #include <random>
+#include <type_traits>
 
 namespace planets
 {
+inline namespace PLANETS_ISA
+{
 
 struct Vec2f
 {
@@ -94,187 +100,696 @@ constexpr Vec2f operator*(float f, Vec2f v) noexcept
     return v*f;
 }
 
+//N lanes of float or double. The primary template loops over the lanes, the widths the target has intrinsics for
+//are specialized below.
+template<typename T, int N>
+class SimdArray
+{
+public:
+    SimdArray() = default;
+    explicit SimdArray(T f) noexcept;
+    explicit SimdArray(const T* ptr) noexcept;
+    //Loads count (<= N) values and fills the remaining lanes with fill
+    SimdArray(const T* ptr, int count, T fill) noexcept;
+    const T& operator[](int i) const  noexcept { return ns_[i]; }
+    T& operator[](int i) noexcept { return ns_[i]; }
+
+    [[nodiscard]] const T* data() const noexcept { return ns_.data(); }
+    T* data() noexcept { return ns_.data(); }
+
+    SimdArray<T, N> operator+(const SimdArray<T, N>& other) const noexcept;
+    SimdArray<T, N> operator-(const SimdArray<T, N>& other) const noexcept;
+    SimdArray<T, N> operator*(const SimdArray<T, N>& other) const noexcept;
+    SimdArray<T, N> operator*(T f) const noexcept;
+    SimdArray<T, N> operator/(const SimdArray<T, N>& other) const noexcept;
+    SimdArray<T, N> operator/(T f) const noexcept;
+    [[nodiscard]] SimdArray<T, N> Sqrt() const noexcept;
+    //Hardware estimate for the float widths with intrinsics, exact otherwise
+    [[nodiscard]] SimdArray<T, N> ReciprocalSqrt() const noexcept;
+    [[nodiscard]] SimdArray<T, N> Abs() const noexcept;
+    //Nearest integer, ties to even
+    [[nodiscard]] SimdArray<T, N> Round() const noexcept;
+    //floor(log2(|x|)) of normal non zero lanes
+    [[nodiscard]] SimdArray<T, N> Exponent() const noexcept;
+    //x * 2^exponents for integral exponents that keep the result normal
+    [[nodiscard]] SimdArray<T, N> ScaleByPowerOfTwo(const SimdArray<T, N>& exponents) const noexcept;
+    static SimdArray<T, N> Min(const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept;
+    static SimdArray<T, N> Max(const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept;
+    //Bit i is set when lo[i] <= v[i] <= hi[i]
+    static std::uint32_t InRangeMask(const SimdArray<T, N>& v, const SimdArray<T, N>& lo, const SimdArray<T, N>& hi) noexcept;
+    //Bit by bit or of the lanes, for lanes holding bit patterns or masks
+    SimdArray<T, N> operator|(const SimdArray<T, N>& other) const noexcept;
+    //Writes the N lanes to ptr, which needs no alignment
+    void Store(T* ptr) const noexcept;
+    //Lanes of a where every bit of the mask lane is set, lanes of b where none is
+    static SimdArray<T, N> Select(const SimdArray<T, N>& mask, const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept;
+private:
+    std::array<T, N> ns_{};
+};
+
 template<int N>
-class FloatArray
+using FloatArray = SimdArray<float, N>;
+template<int N>
+using DoubleArray = SimdArray<double, N>;
+
+//The widths with intrinsics for the target keep their lanes in one register, every operator is inline
+//so a whole expression compiles to straight-line SIMD without going through memory
+#if defined(__SSE__)
+template<>
+class SimdArray<float, 4>
+{
+public:
+    SimdArray() = default;
+    explicit SimdArray(__m128 v) noexcept : v_(v) {}
+    explicit SimdArray(float f) noexcept : v_(_mm_set1_ps(f)) {}
+    explicit SimdArray(const float* ptr) noexcept : v_(_mm_loadu_ps(ptr)) {}
+    SimdArray(const float* ptr, int count, float fill) noexcept
+    {
+        alignas(16) std::array<float, 4> ns;
+        for (int i = 0; i < 4; i++)
+        {
+            ns[i] = i < count ? ptr[i] : fill;
+        }
+        v_ = _mm_load_ps(ns.data());
+    }
+    const float& operator[](int i) const noexcept { return data()[i]; }
+    float& operator[](int i) noexcept { return data()[i]; }
+
+    [[nodiscard]] const float* data() const noexcept { return reinterpret_cast<const float*>(&v_); }
+    float* data() noexcept { return reinterpret_cast<float*>(&v_); }
+    [[nodiscard]] __m128 Register() const noexcept { return v_; }
+
+    FloatArray<4> operator+(const FloatArray<4>& other) const noexcept { return FloatArray<4>{ _mm_add_ps(v_, other.v_) }; }
+    FloatArray<4> operator-(const FloatArray<4>& other) const noexcept { return FloatArray<4>{ _mm_sub_ps(v_, other.v_) }; }
+    FloatArray<4> operator*(const FloatArray<4>& other) const noexcept { return FloatArray<4>{ _mm_mul_ps(v_, other.v_) }; }
+    FloatArray<4> operator*(float f) const noexcept { return FloatArray<4>{ _mm_mul_ps(v_, _mm_set1_ps(f)) }; }
+    FloatArray<4> operator/(const FloatArray<4>& other) const noexcept { return FloatArray<4>{ _mm_div_ps(v_, other.v_) }; }
+    FloatArray<4> operator/(float f) const noexcept { return FloatArray<4>{ _mm_div_ps(v_, _mm_set1_ps(f)) }; }
+    [[nodiscard]] FloatArray<4> Sqrt() const noexcept { return FloatArray<4>{ _mm_sqrt_ps(v_) }; }
+    [[nodiscard]] FloatArray<4> ReciprocalSqrt() const noexcept { return FloatArray<4>{ _mm_rsqrt_ps(v_) }; }
+    [[nodiscard]] FloatArray<4> Abs() const noexcept { return FloatArray<4>{ _mm_andnot_ps(_mm_set1_ps(-0.0f), v_) }; }
+    [[nodiscard]] FloatArray<4> Round() const noexcept { return FloatArray<4>{ _mm_cvtepi32_ps(_mm_cvtps_epi32(v_)) }; }
+    [[nodiscard]] FloatArray<4> Exponent() const noexcept
+    {
+        const auto biased = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(v_), 23), _mm_set1_epi32(0xFF));
+        return FloatArray<4>{ _mm_cvtepi32_ps(_mm_sub_epi32(biased, _mm_set1_epi32(127))) };
+    }
+    [[nodiscard]] FloatArray<4> ScaleByPowerOfTwo(const FloatArray<4>& exponents) const noexcept
+    {
+        const auto shift = _mm_slli_epi32(_mm_cvtps_epi32(exponents.v_), 23);
+        return FloatArray<4>{ _mm_castsi128_ps(_mm_add_epi32(_mm_castps_si128(v_), shift)) };
+    }
+    static FloatArray<4> Min(const FloatArray<4>& a, const FloatArray<4>& b) noexcept { return FloatArray<4>{ _mm_min_ps(a.v_, b.v_) }; }
+    static FloatArray<4> Max(const FloatArray<4>& a, const FloatArray<4>& b) noexcept { return FloatArray<4>{ _mm_max_ps(a.v_, b.v_) }; }
+    static std::uint32_t InRangeMask(const FloatArray<4>& v, const FloatArray<4>& lo, const FloatArray<4>& hi) noexcept
+    {
+        return static_cast<std::uint32_t>(_mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(v.v_, lo.v_), _mm_cmple_ps(v.v_, hi.v_))));
+    }
+    FloatArray<4> operator|(const FloatArray<4>& other) const noexcept { return FloatArray<4>{ _mm_or_ps(v_, other.v_) }; }
+    void Store(float* ptr) const noexcept { _mm_storeu_ps(ptr, v_); }
+    static FloatArray<4> Select(const FloatArray<4>& mask, const FloatArray<4>& a, const FloatArray<4>& b) noexcept
+    {
+        return FloatArray<4>{ _mm_or_ps(_mm_and_ps(mask.v_, a.v_), _mm_andnot_ps(mask.v_, b.v_)) };
+    }
+private:
+    __m128 v_ = _mm_setzero_ps();
+};
+#endif
+
+#if defined(__AVX2__)
+template<>
+class SimdArray<float, 8>
+{
+public:
+    SimdArray() = default;
+    explicit SimdArray(__m256 v) noexcept : v_(v) {}
+    explicit SimdArray(float f) noexcept : v_(_mm256_set1_ps(f)) {}
+    explicit SimdArray(const float* ptr) noexcept : v_(_mm256_loadu_ps(ptr)) {}
+    SimdArray(const float* ptr, int count, float fill) noexcept
+    {
+        const auto mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        v_ = _mm256_blendv_ps(_mm256_set1_ps(fill), _mm256_maskload_ps(ptr, mask), _mm256_castsi256_ps(mask));
+    }
+    const float& operator[](int i) const noexcept { return data()[i]; }
+    float& operator[](int i) noexcept { return data()[i]; }
+
+    [[nodiscard]] const float* data() const noexcept { return reinterpret_cast<const float*>(&v_); }
+    float* data() noexcept { return reinterpret_cast<float*>(&v_); }
+    [[nodiscard]] __m256 Register() const noexcept { return v_; }
+
+    FloatArray<8> operator+(const FloatArray<8>& other) const noexcept { return FloatArray<8>{ _mm256_add_ps(v_, other.v_) }; }
+    FloatArray<8> operator-(const FloatArray<8>& other) const noexcept { return FloatArray<8>{ _mm256_sub_ps(v_, other.v_) }; }
+    FloatArray<8> operator*(const FloatArray<8>& other) const noexcept { return FloatArray<8>{ _mm256_mul_ps(v_, other.v_) }; }
+    FloatArray<8> operator*(float f) const noexcept { return FloatArray<8>{ _mm256_mul_ps(v_, _mm256_set1_ps(f)) }; }
+    FloatArray<8> operator/(const FloatArray<8>& other) const noexcept { return FloatArray<8>{ _mm256_div_ps(v_, other.v_) }; }
+    FloatArray<8> operator/(float f) const noexcept { return FloatArray<8>{ _mm256_div_ps(v_, _mm256_set1_ps(f)) }; }
+    [[nodiscard]] FloatArray<8> Sqrt() const noexcept { return FloatArray<8>{ _mm256_sqrt_ps(v_) }; }
+    [[nodiscard]] FloatArray<8> ReciprocalSqrt() const noexcept { return FloatArray<8>{ _mm256_rsqrt_ps(v_) }; }
+    [[nodiscard]] FloatArray<8> Abs() const noexcept { return FloatArray<8>{ _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v_) }; }
+    [[nodiscard]] FloatArray<8> Round() const noexcept
+    {
+        return FloatArray<8>{ _mm256_round_ps(v_, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+    }
+    [[nodiscard]] FloatArray<8> Exponent() const noexcept
+    {
+        const auto biased = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(v_), 23), _mm256_set1_epi32(0xFF));
+        return FloatArray<8>{ _mm256_cvtepi32_ps(_mm256_sub_epi32(biased, _mm256_set1_epi32(127))) };
+    }
+    [[nodiscard]] FloatArray<8> ScaleByPowerOfTwo(const FloatArray<8>& exponents) const noexcept
+    {
+        const auto shift = _mm256_slli_epi32(_mm256_cvtps_epi32(exponents.v_), 23);
+        return FloatArray<8>{ _mm256_castsi256_ps(_mm256_add_epi32(_mm256_castps_si256(v_), shift)) };
+    }
+    static FloatArray<8> Min(const FloatArray<8>& a, const FloatArray<8>& b) noexcept { return FloatArray<8>{ _mm256_min_ps(a.v_, b.v_) }; }
+    static FloatArray<8> Max(const FloatArray<8>& a, const FloatArray<8>& b) noexcept { return FloatArray<8>{ _mm256_max_ps(a.v_, b.v_) }; }
+    static std::uint32_t InRangeMask(const FloatArray<8>& v, const FloatArray<8>& lo, const FloatArray<8>& hi) noexcept
+    {
+        return static_cast<std::uint32_t>(_mm256_movemask_ps(
+            _mm256_and_ps(_mm256_cmp_ps(v.v_, lo.v_, _CMP_GE_OQ), _mm256_cmp_ps(v.v_, hi.v_, _CMP_LE_OQ))));
+    }
+    FloatArray<8> operator|(const FloatArray<8>& other) const noexcept { return FloatArray<8>{ _mm256_or_ps(v_, other.v_) }; }
+    void Store(float* ptr) const noexcept { _mm256_storeu_ps(ptr, v_); }
+    static FloatArray<8> Select(const FloatArray<8>& mask, const FloatArray<8>& a, const FloatArray<8>& b) noexcept
+    {
+        return FloatArray<8>{ _mm256_blendv_ps(b.v_, a.v_, mask.v_) };
+    }
+private:
+    __m256 v_ = _mm256_setzero_ps();
+};
+#endif
+
+#if defined(__AVX512F__)
+template<>
+class SimdArray<float, 16>
+{
+public:
+    SimdArray() = default;
+    explicit SimdArray(__m512 v) noexcept : v_(v) {}
+    explicit SimdArray(float f) noexcept : v_(_mm512_set1_ps(f)) {}
+    explicit SimdArray(const float* ptr) noexcept : v_(_mm512_loadu_ps(ptr)) {}
+    SimdArray(const float* ptr, int count, float fill) noexcept :
+        v_(_mm512_mask_loadu_ps(_mm512_set1_ps(fill), count >= 16 ? __mmask16(0xFFFF) : __mmask16((1u << count) - 1u), ptr))
+    {
+    }
+    const float& operator[](int i) const noexcept { return data()[i]; }
+    float& operator[](int i) noexcept { return data()[i]; }
+
+    [[nodiscard]] const float* data() const noexcept { return reinterpret_cast<const float*>(&v_); }
+    float* data() noexcept { return reinterpret_cast<float*>(&v_); }
+    [[nodiscard]] __m512 Register() const noexcept { return v_; }
+
+    FloatArray<16> operator+(const FloatArray<16>& other) const noexcept { return FloatArray<16>{ _mm512_add_ps(v_, other.v_) }; }
+    FloatArray<16> operator-(const FloatArray<16>& other) const noexcept { return FloatArray<16>{ _mm512_sub_ps(v_, other.v_) }; }
+    FloatArray<16> operator*(const FloatArray<16>& other) const noexcept { return FloatArray<16>{ _mm512_mul_ps(v_, other.v_) }; }
+    FloatArray<16> operator*(float f) const noexcept { return FloatArray<16>{ _mm512_mul_ps(v_, _mm512_set1_ps(f)) }; }
+    FloatArray<16> operator/(const FloatArray<16>& other) const noexcept { return FloatArray<16>{ _mm512_div_ps(v_, other.v_) }; }
+    FloatArray<16> operator/(float f) const noexcept { return FloatArray<16>{ _mm512_div_ps(v_, _mm512_set1_ps(f)) }; }
+    [[nodiscard]] FloatArray<16> Sqrt() const noexcept { return FloatArray<16>{ _mm512_sqrt_ps(v_) }; }
+    [[nodiscard]] FloatArray<16> ReciprocalSqrt() const noexcept { return FloatArray<16>{ _mm512_rsqrt14_ps(v_) }; }
+    [[nodiscard]] FloatArray<16> Abs() const noexcept { return FloatArray<16>{ _mm512_abs_ps(v_) }; }
+    [[nodiscard]] FloatArray<16> Round() const noexcept
+    {
+        return FloatArray<16>{ _mm512_roundscale_ps(v_, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+    }
+    [[nodiscard]] FloatArray<16> Exponent() const noexcept { return FloatArray<16>{ _mm512_getexp_ps(v_) }; }
+    [[nodiscard]] FloatArray<16> ScaleByPowerOfTwo(const FloatArray<16>& exponents) const noexcept
+    {
+        return FloatArray<16>{ _mm512_scalef_ps(v_, exponents.v_) };
+    }
+    static FloatArray<16> Min(const FloatArray<16>& a, const FloatArray<16>& b) noexcept { return FloatArray<16>{ _mm512_min_ps(a.v_, b.v_) }; }
+    static FloatArray<16> Max(const FloatArray<16>& a, const FloatArray<16>& b) noexcept { return FloatArray<16>{ _mm512_max_ps(a.v_, b.v_) }; }
+    static std::uint32_t InRangeMask(const FloatArray<16>& v, const FloatArray<16>& lo, const FloatArray<16>& hi) noexcept
+    {
+        return _mm512_cmp_ps_mask(v.v_, lo.v_, _CMP_GE_OQ) & _mm512_cmp_ps_mask(v.v_, hi.v_, _CMP_LE_OQ);
+    }
+    FloatArray<16> operator|(const FloatArray<16>& other) const noexcept
+    {
+        return FloatArray<16>{ _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(v_), _mm512_castps_si512(other.v_))) };
+    }
+    void Store(float* ptr) const noexcept { _mm512_storeu_ps(ptr, v_); }
+    static FloatArray<16> Select(const FloatArray<16>& mask, const FloatArray<16>& a, const FloatArray<16>& b) noexcept
+    {
+        //0xCA is mask ? a : b bit by bit
+        return FloatArray<16>{ _mm512_castsi512_ps(_mm512_ternarylogic_epi32(
+            _mm512_castps_si512(mask.v_), _mm512_castps_si512(a.v_), _mm512_castps_si512(b.v_), 0xCA)) };
+    }
+private:
+    __m512 v_ = _mm512_setzero_ps();
+};
+#endif
+
+//Double lanes, half as many per register. There is no double estimate of 1/sqrt(x) worth its precision loss,
+//so ReciprocalSqrt stays exact.
+#if defined(__AVX2__)
+template<>
+class SimdArray<double, 4>
 {
 public:
-    FloatArray() = default;
-    explicit FloatArray(float f) noexcept;
-    explicit FloatArray(const float* ptr) noexcept;
-    const float& operator[](int i) const  noexcept { return ns_[i]; }
-    float& operator[](int i) noexcept { return ns_[i]; }
-
-    [[nodiscard]] const float* data() const noexcept { return ns_.data(); }
-    float* data() noexcept { return ns_.data(); }
-
-    FloatArray<N> operator+(const FloatArray<N>& other) const noexcept;
-    FloatArray<N> operator-(const FloatArray<N>& other) const noexcept;
-    FloatArray<N> operator*(const FloatArray<N>& other) const noexcept;
-    FloatArray<N> operator*(float f) const noexcept;
-    FloatArray<N> operator/(const FloatArray<N>& other) const noexcept;
-    FloatArray<N> operator/(float f) const noexcept;
-    [[nodiscard]] FloatArray<N> Sqrt() const noexcept;
-    [[nodiscard]] FloatArray<N> ReciprocalSqrt() const noexcept;
+    SimdArray() = default;
+    explicit SimdArray(__m256d v) noexcept : v_(v) {}
+    explicit SimdArray(double f) noexcept : v_(_mm256_set1_pd(f)) {}
+    explicit SimdArray(const double* ptr) noexcept : v_(_mm256_loadu_pd(ptr)) {}
+    SimdArray(const double* ptr, int count, double fill) noexcept
+    {
+        const auto mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(count), _mm256_setr_epi64x(0, 1, 2, 3));
+        v_ = _mm256_blendv_pd(_mm256_set1_pd(fill), _mm256_maskload_pd(ptr, mask), _mm256_castsi256_pd(mask));
+    }
+    const double& operator[](int i) const noexcept { return data()[i]; }
+    double& operator[](int i) noexcept { return data()[i]; }
+
+    [[nodiscard]] const double* data() const noexcept { return reinterpret_cast<const double*>(&v_); }
+    double* data() noexcept { return reinterpret_cast<double*>(&v_); }
+    [[nodiscard]] __m256d Register() const noexcept { return v_; }
+
+    DoubleArray<4> operator+(const DoubleArray<4>& other) const noexcept { return DoubleArray<4>{ _mm256_add_pd(v_, other.v_) }; }
+    DoubleArray<4> operator-(const DoubleArray<4>& other) const noexcept { return DoubleArray<4>{ _mm256_sub_pd(v_, other.v_) }; }
+    DoubleArray<4> operator*(const DoubleArray<4>& other) const noexcept { return DoubleArray<4>{ _mm256_mul_pd(v_, other.v_) }; }
+    DoubleArray<4> operator*(double f) const noexcept { return DoubleArray<4>{ _mm256_mul_pd(v_, _mm256_set1_pd(f)) }; }
+    DoubleArray<4> operator/(const DoubleArray<4>& other) const noexcept { return DoubleArray<4>{ _mm256_div_pd(v_, other.v_) }; }
+    DoubleArray<4> operator/(double f) const noexcept { return DoubleArray<4>{ _mm256_div_pd(v_, _mm256_set1_pd(f)) }; }
+    [[nodiscard]] DoubleArray<4> Sqrt() const noexcept { return DoubleArray<4>{ _mm256_sqrt_pd(v_) }; }
+    [[nodiscard]] DoubleArray<4> ReciprocalSqrt() const noexcept { return DoubleArray<4>{ _mm256_div_pd(_mm256_set1_pd(1.0), _mm256_sqrt_pd(v_)) }; }
+    [[nodiscard]] DoubleArray<4> Abs() const noexcept { return DoubleArray<4>{ _mm256_andnot_pd(_mm256_set1_pd(-0.0), v_) }; }
+    [[nodiscard]] DoubleArray<4> Round() const noexcept
+    {
+        return DoubleArray<4>{ _mm256_round_pd(v_, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+    }
+    [[nodiscard]] DoubleArray<4> Exponent() const noexcept
+    {
+        //The low halves of the 64 bit lanes packed together, AVX2 has no 64 bit integer to double conversion
+        const auto biased = _mm256_and_si256(_mm256_srli_epi64(_mm256_castpd_si256(v_), 52), _mm256_set1_epi64x(0x7FF));
+        const auto packed = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(biased, _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6)));
+        return DoubleArray<4>{ _mm256_cvtepi32_pd(_mm_sub_epi32(packed, _mm_set1_epi32(1023))) };
+    }
+    [[nodiscard]] DoubleArray<4> ScaleByPowerOfTwo(const DoubleArray<4>& exponents) const noexcept
+    {
+        const auto shift = _mm256_slli_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(exponents.v_)), 52);
+        return DoubleArray<4>{ _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(v_), shift)) };
+    }
+    static DoubleArray<4> Min(const DoubleArray<4>& a, const DoubleArray<4>& b) noexcept { return DoubleArray<4>{ _mm256_min_pd(a.v_, b.v_) }; }
+    static DoubleArray<4> Max(const DoubleArray<4>& a, const DoubleArray<4>& b) noexcept { return DoubleArray<4>{ _mm256_max_pd(a.v_, b.v_) }; }
+    static std::uint32_t InRangeMask(const DoubleArray<4>& v, const DoubleArray<4>& lo, const DoubleArray<4>& hi) noexcept
+    {
+        return static_cast<std::uint32_t>(_mm256_movemask_pd(
+            _mm256_and_pd(_mm256_cmp_pd(v.v_, lo.v_, _CMP_GE_OQ), _mm256_cmp_pd(v.v_, hi.v_, _CMP_LE_OQ))));
+    }
+    DoubleArray<4> operator|(const DoubleArray<4>& other) const noexcept { return DoubleArray<4>{ _mm256_or_pd(v_, other.v_) }; }
+    void Store(double* ptr) const noexcept { _mm256_storeu_pd(ptr, v_); }
+    static DoubleArray<4> Select(const DoubleArray<4>& mask, const DoubleArray<4>& a, const DoubleArray<4>& b) noexcept
+    {
+        return DoubleArray<4>{ _mm256_blendv_pd(b.v_, a.v_, mask.v_) };
+    }
 private:
-    std::array<float, N> ns_{};
+    __m256d v_ = _mm256_setzero_pd();
 };
+#endif
+
+#if defined(__AVX512F__)
+template<>
+class SimdArray<double, 8>
+{
+public:
+    SimdArray() = default;
+    explicit SimdArray(__m512d v) noexcept : v_(v) {}
+    explicit SimdArray(double f) noexcept : v_(_mm512_set1_pd(f)) {}
+    explicit SimdArray(const double* ptr) noexcept : v_(_mm512_loadu_pd(ptr)) {}
+    SimdArray(const double* ptr, int count, double fill) noexcept :
+        v_(_mm512_mask_loadu_pd(_mm512_set1_pd(fill), count >= 8 ? __mmask8(0xFF) : __mmask8((1u << count) - 1u), ptr))
+    {
+    }
+    const double& operator[](int i) const noexcept { return data()[i]; }
+    double& operator[](int i) noexcept { return data()[i]; }
+
+    [[nodiscard]] const double* data() const noexcept { return reinterpret_cast<const double*>(&v_); }
+    double* data() noexcept { return reinterpret_cast<double*>(&v_); }
+    [[nodiscard]] __m512d Register() const noexcept { return v_; }
+
+    DoubleArray<8> operator+(const DoubleArray<8>& other) const noexcept { return DoubleArray<8>{ _mm512_add_pd(v_, other.v_) }; }
+    DoubleArray<8> operator-(const DoubleArray<8>& other) const noexcept { return DoubleArray<8>{ _mm512_sub_pd(v_, other.v_) }; }
+    DoubleArray<8> operator*(const DoubleArray<8>& other) const noexcept { return DoubleArray<8>{ _mm512_mul_pd(v_, other.v_) }; }
+    DoubleArray<8> operator*(double f) const noexcept { return DoubleArray<8>{ _mm512_mul_pd(v_, _mm512_set1_pd(f)) }; }
+    DoubleArray<8> operator/(const DoubleArray<8>& other) const noexcept { return DoubleArray<8>{ _mm512_div_pd(v_, other.v_) }; }
+    DoubleArray<8> operator/(double f) const noexcept { return DoubleArray<8>{ _mm512_div_pd(v_, _mm512_set1_pd(f)) }; }
+    [[nodiscard]] DoubleArray<8> Sqrt() const noexcept { return DoubleArray<8>{ _mm512_sqrt_pd(v_) }; }
+    [[nodiscard]] DoubleArray<8> ReciprocalSqrt() const noexcept { return DoubleArray<8>{ _mm512_div_pd(_mm512_set1_pd(1.0), _mm512_sqrt_pd(v_)) }; }
+    [[nodiscard]] DoubleArray<8> Abs() const noexcept { return DoubleArray<8>{ _mm512_abs_pd(v_) }; }
+    [[nodiscard]] DoubleArray<8> Round() const noexcept
+    {
+        return DoubleArray<8>{ _mm512_roundscale_pd(v_, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+    }
+    [[nodiscard]] DoubleArray<8> Exponent() const noexcept { return DoubleArray<8>{ _mm512_getexp_pd(v_) }; }
+    [[nodiscard]] DoubleArray<8> ScaleByPowerOfTwo(const DoubleArray<8>& exponents) const noexcept
+    {
+        return DoubleArray<8>{ _mm512_scalef_pd(v_, exponents.v_) };
+    }
+    static DoubleArray<8> Min(const DoubleArray<8>& a, const DoubleArray<8>& b) noexcept { return DoubleArray<8>{ _mm512_min_pd(a.v_, b.v_) }; }
+    static DoubleArray<8> Max(const DoubleArray<8>& a, const DoubleArray<8>& b) noexcept { return DoubleArray<8>{ _mm512_max_pd(a.v_, b.v_) }; }
+    static std::uint32_t InRangeMask(const DoubleArray<8>& v, const DoubleArray<8>& lo, const DoubleArray<8>& hi) noexcept
+    {
+        return _mm512_cmp_pd_mask(v.v_, lo.v_, _CMP_GE_OQ) & _mm512_cmp_pd_mask(v.v_, hi.v_, _CMP_LE_OQ);
+    }
+    DoubleArray<8> operator|(const DoubleArray<8>& other) const noexcept
+    {
+        return DoubleArray<8>{ _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(v_), _mm512_castpd_si512(other.v_))) };
+    }
+    void Store(double* ptr) const noexcept { _mm512_storeu_pd(ptr, v_); }
+    static DoubleArray<8> Select(const DoubleArray<8>& mask, const DoubleArray<8>& a, const DoubleArray<8>& b) noexcept
+    {
+        return DoubleArray<8>{ _mm512_castsi512_pd(_mm512_ternarylogic_epi64(
+            _mm512_castpd_si512(mask.v_), _mm512_castpd_si512(a.v_), _mm512_castpd_si512(b.v_), 0xCA)) };
+    }
+private:
+    __m512d v_ = _mm512_setzero_pd();
+};
+#endif
 
 using FourFloat = FloatArray<4>;
 using EightFloat = FloatArray<8>;
+using SixteenFloat = FloatArray<16>;
+using FourDouble = DoubleArray<4>;
+using EightDouble = DoubleArray<8>;
 
-template<int N>
-class NVec2f
+//Built on SimdArray, so it lives in registers whenever SimdArray<T, N> does
+template<typename T, int N>
+class NVec2
 {
 public:
-    NVec2f() = default;
+    NVec2() = default;
 
-    constexpr explicit NVec2f(const Vec2f& v) noexcept
+    explicit NVec2(const Vec2f& v) noexcept : xs_(v.x), ys_(v.y)
     {
-        for (int i = 0; i < N; i++)
-        {
-            xs_[i] = v.x;
-            ys_[i] = v.y;
-        }
     }
 
-    constexpr explicit NVec2f(const Vec2f* ptr) noexcept
+    explicit NVec2(const Vec2f* ptr) noexcept
     {
+        std::array<T, N> xs, ys;
         for(int i = 0; i < N; i++)
         {
-            xs_[i] = ptr[i].x;
-            ys_[i] = ptr[i].y;
+            xs[i] = ptr[i].x;
+            ys[i] = ptr[i].y;
         }
+        xs_ = SimdArray<T, N>{ xs.data() };
+        ys_ = SimdArray<T, N>{ ys.data() };
     }
 
-    constexpr explicit NVec2f(const std::array<Vec2f, N> array) noexcept
+    explicit NVec2(const std::array<Vec2f, N>& array) noexcept : NVec2(array.data())
     {
-        for (int i = 0; i < N; i++)
-        {
-            xs_[i] = array[i].x;
-            ys_[i] = array[i].y;
-        }
     }
 
-    NVec2f<N> operator+(const NVec2f<N>& other) const noexcept;
+    NVec2(const SimdArray<T, N>& xs, const SimdArray<T, N>& ys) noexcept : xs_(xs), ys_(ys)
+    {
+    }
 
-    NVec2f<N>& operator+=(const NVec2f<N>& other) noexcept;
+    NVec2<T, N> operator+(const NVec2<T, N>& other) const noexcept { return { xs_ + other.xs_, ys_ + other.ys_ }; }
 
-    NVec2f<N> operator-(const NVec2f<N>& other) const noexcept;
-    NVec2f<N> operator-() const noexcept;
-    NVec2f<N> operator*(const FloatArray<N>& ns) const noexcept;
-    NVec2f<N> operator/(const FloatArray<N>& ns) const noexcept;
+    NVec2<T, N>& operator+=(const NVec2<T, N>& other) noexcept
+    {
+        xs_ = xs_ + other.xs_;
+        ys_ = ys_ + other.ys_;
+        return *this;
+    }
+
+    NVec2<T, N> operator-(const NVec2<T, N>& other) const noexcept { return { xs_ - other.xs_, ys_ - other.ys_ }; }
+    NVec2<T, N> operator-() const noexcept
+    {
+        const SimdArray<T, N> zero{ T{ 0 } };
+        return { zero - xs_, zero - ys_ };
+    }
+    NVec2<T, N> operator*(const SimdArray<T, N>& ns) const noexcept { return { xs_ * ns, ys_ * ns }; }
+    NVec2<T, N> operator/(const SimdArray<T, N>& ns) const noexcept { return { xs_ / ns, ys_ / ns }; }
 
 
-    static FloatArray<N> Dot(const NVec2f<N>& v1, const NVec2f<N>& v2) noexcept;
+    static SimdArray<T, N> Dot(const NVec2<T, N>& v1, const NVec2<T, N>& v2) noexcept
+    {
+        return v1.xs_ * v2.xs_ + v1.ys_ * v2.ys_;
+    }
 
-    static FloatArray<N> Det(const NVec2f<N>& v1, const NVec2f<N>& v2) noexcept;
+    static SimdArray<T, N> Det(const NVec2<T, N>& v1, const NVec2<T, N>& v2) noexcept
+    {
+        return v1.xs_ * v2.ys_ - v1.ys_ * v2.xs_;
+    }
 
-    [[nodiscard]] FloatArray<N> SquareMagnitude() const noexcept
+    [[nodiscard]] SimdArray<T, N> SquareMagnitude() const noexcept
     {
         return Dot(*this, *this);
     }
 
-    [[nodiscard]] FloatArray<N> Magnitude() const noexcept
+    [[nodiscard]] SimdArray<T, N> Magnitude() const noexcept
     {
         return SquareMagnitude().Sqrt();
     }
 
-    [[nodiscard]] NVec2f<N> Normalized() const noexcept
+    [[nodiscard]] NVec2<T, N> Normalized() const noexcept
     {
         return (*this) * SquareMagnitude().ReciprocalSqrt();
     }
 
-    [[nodiscard]] const auto& Xs() const noexcept {return xs_;}
-    [[nodiscard]] const auto& Ys() const noexcept {return ys_;}
+    [[nodiscard]] const SimdArray<T, N>& Xs() const noexcept {return xs_;}
+    [[nodiscard]] const SimdArray<T, N>& Ys() const noexcept {return ys_;}
 
 private:
-    std::array<float, N> xs_{};
-    std::array<float, N> ys_{};
+    SimdArray<T, N> xs_{};
+    SimdArray<T, N> ys_{};
 };
 
+template<int N>
+using NVec2f = NVec2<float, N>;
+template<int N>
+using NVec2d = NVec2<double, N>;
+
 using FourVec2f = NVec2f<4>;
 using EightVec2f = NVec2f<8>;
+using SixteenVec2f = NVec2f<16>;
+using FourVec2d = NVec2d<4>;
+using EightVec2d = NVec2d<8>;
+
+//Widest lane count with intrinsics in this kernel namespace
+#if defined(__AVX512F__)
+constexpr int laneWidth = 16;
+#elif defined(__AVX2__)
+constexpr int laneWidth = 8;
+#else
+constexpr int laneWidth = 4;
+#endif
+using LaneFloat = FloatArray<laneWidth>;
+using LaneVec2f = NVec2f<laneWidth>;
 
+//Generic lane by lane versions, used by the widths without intrinsics for the target
+template<typename T, int N>
+SimdArray<T, N>::SimdArray(T f) noexcept
+{
+    ns_.fill(f);
+}
 
-#if defined(__SSE__)
-
-template<>
-FourFloat::FloatArray(float f) noexcept;
-
-template<>
-FourFloat::FloatArray(const float* f) noexcept;
-
-template<>
-FourFloat FourFloat::Sqrt() const noexcept;
-
-template<>
-FourFloat FourFloat::ReciprocalSqrt() const noexcept;
-
-template<>
-FourFloat FourFloat::operator*(const FloatArray<4>& rhs) const noexcept;
-
-template<>
-FourFloat FourFloat::operator*(float rhs) const noexcept;
-
-template<>
-NVec2f<4> FourVec2f::operator+(const FourVec2f& v) const noexcept;
-
-template<>
-FourVec2f& FourVec2f::operator+=(const FourVec2f& v) noexcept;
+template<typename T, int N>
+SimdArray<T, N>::SimdArray(const T* ptr) noexcept
+{
+    std::copy_n(ptr, N, ns_.begin());
+}
 
-template<>
-FourVec2f FourVec2f::operator-(const FourVec2f& v) const noexcept;
+template<typename T, int N>
+SimdArray<T, N>::SimdArray(const T* ptr, int count, T fill) noexcept
+{
+    for (int i = 0; i < N; i++)
+    {
+        ns_[i] = i < count ? ptr[i] : fill;
+    }
+}
 
-template<>
-FourVec2f FourVec2f::operator*(const FourFloat& ns) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator+(const SimdArray<T, N>& other) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] + other[i];
+    }
+    return result;
+}
 
-template<>
-FourVec2f FourVec2f::operator/(const FloatArray<4>& ns) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator-(const SimdArray<T, N>& other) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] - other[i];
+    }
+    return result;
+}
 
-template<>
-FourFloat FourVec2f::Dot(const NVec2f<4>& v1, const NVec2f<4>& v2) noexcept;
-#endif
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator*(const SimdArray<T, N>& other) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] * other[i];
+    }
+    return result;
+}
 
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator*(T f) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] * f;
+    }
+    return result;
+}
 
-#ifdef __AVX2__
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator/(const SimdArray<T, N>& other) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] / other[i];
+    }
+    return result;
+}
 
-template<>
-EightFloat::FloatArray(float f) noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator/(T f) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = ns_[i] / f;
+    }
+    return result;
+}
 
-template<>
-EightFloat::FloatArray(const float* f) noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Sqrt() const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::sqrt(ns_[i]);
+    }
+    return result;
+}
 
-template<>
-EightFloat EightFloat::Sqrt() const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::ReciprocalSqrt() const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = T{ 1 } / std::sqrt(ns_[i]);
+    }
+    return result;
+}
 
-template<>
-EightFloat EightFloat::ReciprocalSqrt() const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Abs() const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::abs(ns_[i]);
+    }
+    return result;
+}
 
-template<>
-EightFloat EightFloat::operator*(const EightFloat& rhs) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Round() const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::nearbyint(ns_[i]);
+    }
+    return result;
+}
 
-template<>
-EightFloat EightFloat::operator*(float rhs) const noexcept;
-//EightVec2f
-template<>
-EightVec2f EightVec2f::operator+(const EightVec2f& other) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Exponent() const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = static_cast<T>(std::ilogb(ns_[i]));
+    }
+    return result;
+}
 
-template<>
-EightVec2f& EightVec2f::operator+=(const EightVec2f& other) noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::ScaleByPowerOfTwo(const SimdArray<T, N>& exponents) const noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::ldexp(ns_[i], static_cast<int>(exponents[i]));
+    }
+    return result;
+}
 
-template<>
-EightVec2f EightVec2f::operator-(const EightVec2f& other) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Min(const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::min(a[i], b[i]);
+    }
+    return result;
+}
 
-template<>
-EightVec2f EightVec2f::operator*(const EightFloat& ns) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Max(const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept
+{
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::max(a[i], b[i]);
+    }
+    return result;
+}
 
-template<>
-EightVec2f EightVec2f::operator/(const EightFloat& ns) const noexcept;
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::operator|(const SimdArray<T, N>& other) const noexcept
+{
+    using Bits = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), std::uint32_t, std::uint64_t>;
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::bit_cast<T>(std::bit_cast<Bits>(ns_[i]) | std::bit_cast<Bits>(other[i]));
+    }
+    return result;
+}
 
-template<>
-EightFloat EightVec2f::Dot(const EightVec2f& v1, const EightVec2f& v2) noexcept;
-#endif
+template<typename T, int N>
+void SimdArray<T, N>::Store(T* ptr) const noexcept
+{
+    std::copy_n(ns_.begin(), N, ptr);
+}
 
+template<typename T, int N>
+SimdArray<T, N> SimdArray<T, N>::Select(const SimdArray<T, N>& mask, const SimdArray<T, N>& a, const SimdArray<T, N>& b) noexcept
+{
+    using Bits = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), std::uint32_t, std::uint64_t>;
+    SimdArray<T, N> result;
+    for (int i = 0; i < N; i++)
+    {
+        result[i] = std::bit_cast<Bits>(mask[i]) != 0 ? a[i] : b[i];
+    }
+    return result;
+}
 
+template<typename T, int N>
+std::uint32_t SimdArray<T, N>::InRangeMask(const SimdArray<T, N>& v, const SimdArray<T, N>& lo, const SimdArray<T, N>& hi) noexcept
+{
+    std::uint32_t mask = 0;
+    for (int i = 0; i < N; i++)
+    {
+        mask |= static_cast<std::uint32_t>(lo[i] <= v[i] && v[i] <= hi[i]) << i;
+    }
+    return mask;
+}
 
-}
\ No newline at end of file
+}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "vec.h"
+
+#include <numbers>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+//Polynomial approximations of the usual functions on every lane of a FloatArray, accurate to a few float ulps
+//(of the argument for Exp, as -ffast-math may fold the two part reduction).
+//Built only on the FloatArray operators, so they stay in registers wherever FloatArray does.
+
+//|x| under 87, so the result stays a normal float
+template<int N>
+FloatArray<N> Exp(const FloatArray<N>& x) noexcept
+{
+    //x = k ln2 + r with |r| <= ln2 / 2
+    constexpr float ln2High = 0.693359375f;
+    constexpr float ln2Low = -2.12194440e-4f;
+    const auto k = (x * std::numbers::log2e_v<float>).Round();
+    const auto r = x - k * ln2High - k * ln2Low;
+    auto polynomial = FloatArray<N>{ 1.0f / 5040.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f / 720.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f / 120.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f / 24.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f / 6.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 0.5f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f };
+    polynomial = polynomial * r + FloatArray<N>{ 1.0f };
+    return polynomial.ScaleByPowerOfTwo(k);
+}
+
+//Positive normal x
+template<int N>
+FloatArray<N> Log(const FloatArray<N>& x) noexcept
+{
+    //x = m 2^e with m in [1, 2), ln m = 2 atanh(s) with s = (m - 1) / (m + 1) in [0, 1/3]
+    const auto e = x.Exponent();
+    const auto m = x.ScaleByPowerOfTwo(FloatArray<N>{ 0.0f } - e);
+    const FloatArray<N> one{ 1.0f };
+    const auto s = (m - one) / (m + one);
+    const auto s2 = s * s;
+    auto polynomial = FloatArray<N>{ 1.0f / 11.0f };
+    polynomial = polynomial * s2 + FloatArray<N>{ 1.0f / 9.0f };
+    polynomial = polynomial * s2 + FloatArray<N>{ 1.0f / 7.0f };
+    polynomial = polynomial * s2 + FloatArray<N>{ 1.0f / 5.0f };
+    polynomial = polynomial * s2 + FloatArray<N>{ 1.0f / 3.0f };
+    polynomial = polynomial * s2 + one;
+    return e * std::numbers::ln2_v<float> + s * polynomial * 2.0f;
+}
+
+//|x| up to pi/2, where the Taylor series need no reduction
+template<int N>
+void SinCos(const FloatArray<N>& x, FloatArray<N>& sin, FloatArray<N>& cos) noexcept
+{
+    const auto x2 = x * x;
+    auto sinPolynomial = FloatArray<N>{ -1.0f / 39916800.0f };
+    sinPolynomial = sinPolynomial * x2 + FloatArray<N>{ 1.0f / 362880.0f };
+    sinPolynomial = sinPolynomial * x2 + FloatArray<N>{ -1.0f / 5040.0f };
+    sinPolynomial = sinPolynomial * x2 + FloatArray<N>{ 1.0f / 120.0f };
+    sinPolynomial = sinPolynomial * x2 + FloatArray<N>{ -1.0f / 6.0f };
+    sin = x + x * x2 * sinPolynomial;
+    auto cosPolynomial = FloatArray<N>{ 1.0f / 479001600.0f };
+    cosPolynomial = cosPolynomial * x2 + FloatArray<N>{ -1.0f / 3628800.0f };
+    cosPolynomial = cosPolynomial * x2 + FloatArray<N>{ 1.0f / 40320.0f };
+    cosPolynomial = cosPolynomial * x2 + FloatArray<N>{ -1.0f / 720.0f };
+    cosPolynomial = cosPolynomial * x2 + FloatArray<N>{ 1.0f / 24.0f };
+    cosPolynomial = cosPolynomial * x2 + FloatArray<N>{ -0.5f };
+    cos = FloatArray<N>{ 1.0f } + x2 * cosPolynomial;
+}
+
+}
+}
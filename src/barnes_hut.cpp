@@ -0,0 +1,458 @@
+#include "barnes_hut.h"
+#include "nbody.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <limits>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+//Bodies a leaf keeps before it is split
+constexpr std::uint32_t leafCapacity = 16;
+//Morton keys use 16 bits per axis
+constexpr int maxLevel = 16;
+//The subtrees under this level are built in parallel
+constexpr int parallelBuildLevel = 3;
+constexpr std::size_t bodyChunkSize = 16 * 1024;
+constexpr std::size_t groupChunkSize = 16;
+
+std::uint32_t SpreadBits(std::uint32_t v) noexcept
+{
+    v &= 0xFFFFu;
+    v = (v | (v << 8u)) & 0x00FF00FFu;
+    v = (v | (v << 4u)) & 0x0F0F0F0Fu;
+    v = (v | (v << 2u)) & 0x33333333u;
+    v = (v | (v << 1u)) & 0x55555555u;
+    return v;
+}
+
+std::uint32_t ChildOf(std::uint64_t key, int level) noexcept
+{
+    return static_cast<std::uint32_t>(key >> (62 - 2 * level)) & 3u;
+}
+
+class TreeBuilder
+{
+public:
+    TreeBuilder(std::vector<NodeQuad>& quads, const std::uint64_t* keys, const float* xs, const float* ys, int deferLevel) noexcept :
+        quads_(quads), keys_(keys), xs_(xs), ys_(ys), deferLevel_(deferLevel)
+    {
+    }
+
+    struct DeferredCell
+    {
+        std::int32_t quad;
+        int lane;
+        std::uint32_t begin, end;
+        Vec2f corner;
+        float size;
+    };
+
+    //Builds the quad of the children of the node covering [begin, end), returns its index
+    std::int32_t BuildQuad(std::uint32_t begin, std::uint32_t end, int level, Vec2f corner, float size)
+    {
+        const auto quadIndex = static_cast<std::int32_t>(quads_.size());
+        quads_.emplace_back();
+        const auto childSize = size * 0.5f;
+        auto childBegin = begin;
+        for (std::uint32_t child = 0; child < 4; child++)
+        {
+            const auto childEnd = static_cast<std::uint32_t>(std::partition_point(keys_ + childBegin, keys_ + end,
+                [level, child](std::uint64_t key) { return ChildOf(key, level) <= child; }) - keys_);
+            const Vec2f childCorner{ corner.x + static_cast<float>(child & 1u) * childSize,
+                corner.y + static_cast<float>(child >> 1u) * childSize };
+            FillLane(quadIndex, static_cast<int>(child), childBegin, childEnd, level + 1, childCorner, childSize);
+            childBegin = childEnd;
+        }
+        return quadIndex;
+    }
+
+    [[nodiscard]] const std::vector<DeferredCell>& GetDeferredCells() const noexcept { return deferredCells_; }
+
+    //Center of mass of the lane from the quad of its children
+    static void SumChildren(std::vector<NodeQuad>& quads, std::int32_t quadIndex, int lane) noexcept
+    {
+        const auto& children = quads[quads[quadIndex].childQuads[lane]];
+        float mass = 0.0f;
+        Vec2f weighted{};
+        for (int child = 0; child < 4; child++)
+        {
+            mass += children.masses[child];
+            weighted += Vec2f{ children.centerXs[child], children.centerYs[child] } * children.masses[child];
+        }
+        auto& quad = quads[quadIndex];
+        quad.masses[lane] = mass;
+        quad.centerXs[lane] = weighted.x / mass;
+        quad.centerYs[lane] = weighted.y / mass;
+    }
+private:
+    void FillLane(std::int32_t quadIndex, int lane, std::uint32_t begin, std::uint32_t end, int level, Vec2f corner, float size)
+    {
+        quads_[quadIndex].sizes[lane] = size;
+        quads_[quadIndex].bodyBegins[lane] = begin;
+        quads_[quadIndex].bodyEnds[lane] = end;
+        if (begin == end)
+        {
+            return;
+        }
+        if (end - begin <= leafCapacity || level == maxLevel)
+        {
+            Vec2f sum{};
+            for (auto i = begin; i < end; i++)
+            {
+                sum += Vec2f{ xs_[i], ys_[i] };
+            }
+            const auto center = sum / static_cast<float>(end - begin);
+            auto& quad = quads_[quadIndex];
+            quad.centerXs[lane] = center.x;
+            quad.centerYs[lane] = center.y;
+            quad.masses[lane] = static_cast<float>(end - begin) * planetMass;
+            return;
+        }
+        if (level == deferLevel_)
+        {
+            deferredCells_.push_back({ quadIndex, lane, begin, end, corner, size });
+            return;
+        }
+        const auto childQuad = BuildQuad(begin, end, level, corner, size);
+        quads_[quadIndex].childQuads[lane] = childQuad;
+        SumChildren(quads_, quadIndex, lane);
+    }
+
+    std::vector<NodeQuad>& quads_;
+    const std::uint64_t* keys_;
+    const float* xs_;
+    const float* ys_;
+    int deferLevel_;
+    std::vector<DeferredCell> deferredCells_;
+};
+}
+
+BarnesHutSystem::BarnesHutSystem(std::size_t planetCount, float openingAngle, ThreadPool* threadPool, std::uint64_t seed) noexcept :
+    threadPool_(threadPool), openingAngle_(openingAngle), planetCount_(planetCount)
+{
+
+    const auto paddedCount = (planetCount / laneWidth + 1) * laneWidth;
+    xs_.resize(paddedCount, defaultPos.x);
+    ys_.resize(paddedCount, defaultPos.y);
+    velocityXs_.resize(paddedCount, defaultVel.x);
+    velocityYs_.resize(paddedCount, defaultVel.y);
+    accelerationXs_.resize(paddedCount);
+    accelerationYs_.resize(paddedCount);
+    planetIds_.resize(planetCount);
+    bodyOfPlanet_.resize(planetCount);
+    keys_.resize(planetCount);
+    const CounterRng rng(seed);
+    for (std::size_t first = 0; first < planetCount; first += laneWidth)
+    {
+        LaneVec2f positions, velocities;
+        GenerateOrbits<laneWidth>(rng, first, positions, velocities);
+        for (std::size_t lane = 0; lane < std::min<std::size_t>(laneWidth, planetCount - first); lane++)
+        {
+            const auto i = first + lane;
+            xs_[i] = positions.Xs()[lane];
+            ys_[i] = positions.Ys()[lane];
+            velocityXs_[i] = velocities.Xs()[lane];
+            velocityYs_[i] = velocities.Ys()[lane];
+            planetIds_[i] = static_cast<std::uint32_t>(i);
+            bodyOfPlanet_[i] = static_cast<std::uint32_t>(i);
+        }
+    }
+}
+
+void BarnesHutSystem::Update(float dt) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    ComputeMutualAccelerations();
+    ParallelFor(threadPool_, 0, xs_.size() / laneWidth, bodyChunkSize / laneWidth, [this, dt](std::size_t begin, std::size_t end)
+    {
+        const LaneVec2f laneWorldCenter{ worldCenter };
+        const LaneFloat laneDt{ dt };
+        for (auto i = begin * laneWidth; i < end * laneWidth; i += laneWidth)
+        {
+            LaneVec2f position{ LaneFloat{ xs_.data() + i }, LaneFloat{ ys_.data() + i } };
+            LaneVec2f velocity{ LaneFloat{ velocityXs_.data() + i }, LaneFloat{ velocityYs_.data() + i } };
+            const LaneVec2f mutualAcceleration{ LaneFloat{ accelerationXs_.data() + i }, LaneFloat{ accelerationYs_.data() + i } };
+            //Calculate new velocity
+            const auto delta = position - laneWorldCenter;
+            const auto accelerationValue = CalculateAcceleration(delta.SquareMagnitude());
+            const auto acceleration = (-delta).Normalized() * accelerationValue + mutualAcceleration;
+            velocity += acceleration * laneDt;
+            //Calculate new position
+            position += velocity * laneDt;
+            std::copy_n(position.Xs().data(), laneWidth, xs_.data() + i);
+            std::copy_n(position.Ys().data(), laneWidth, ys_.data() + i);
+            std::copy_n(velocity.Xs().data(), laneWidth, velocityXs_.data() + i);
+            std::copy_n(velocity.Ys().data(), laneWidth, velocityYs_.data() + i);
+        }
+    });
+}
+
+Vec2f BarnesHutSystem::GetPosition(int index) const
+{
+    const auto body = bodyOfPlanet_[index];
+    return { xs_[body], ys_[body] };
+}
+
+Vec2f BarnesHutSystem::GetMutualAcceleration(int index) const
+{
+    const auto body = bodyOfPlanet_[index];
+    return { accelerationXs_[body], accelerationYs_[body] };
+}
+
+void BarnesHutSystem::ComputeMutualAccelerations() noexcept
+{
+    SortBodies();
+    BuildTree();
+#ifdef TRACY_ENABLE
+    ZoneScopedN("Tree Walk");
+#endif
+    const auto groupCount = xs_.size() / laneWidth;
+    ParallelFor(threadPool_, 0, groupCount, groupChunkSize, [this](std::size_t begin, std::size_t end)
+    {
+        std::vector<float> sourceXs, sourceYs, sourceMasses;
+        for (auto group = begin; group < end; group++)
+        {
+            ComputeGroupAccelerations(group, sourceXs, sourceYs, sourceMasses);
+        }
+    });
+}
+
+void BarnesHutSystem::SortBodies() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    if (planetCount_ == 0)
+    {
+        return;
+    }
+    //Bounding box, one partial result per chunk
+    const auto chunkCount = (planetCount_ + bodyChunkSize - 1) / bodyChunkSize;
+    std::vector<std::array<float, 4>> bounds(chunkCount);
+    ParallelFor(threadPool_, 0, planetCount_, bodyChunkSize, [this, &bounds](std::size_t begin, std::size_t end)
+    {
+        constexpr auto inf = std::numeric_limits<float>::max();
+        std::array<float, 4> bound{ inf, inf, -inf, -inf };
+        for (auto i = begin; i < end; i++)
+        {
+            bound = { std::min(bound[0], xs_[i]), std::min(bound[1], ys_[i]),
+                std::max(bound[2], xs_[i]), std::max(bound[3], ys_[i]) };
+        }
+        bounds[begin / bodyChunkSize] = bound;
+    });
+    auto bound = bounds[0];
+    for (const auto& chunkBound : bounds)
+    {
+        bound = { std::min(bound[0], chunkBound[0]), std::min(bound[1], chunkBound[1]),
+            std::max(bound[2], chunkBound[2]), std::max(bound[3], chunkBound[3]) };
+    }
+    rootCorner_ = { bound[0], bound[1] };
+    rootSize_ = std::max({ bound[2] - bound[0], bound[3] - bound[1], gravitySoftening }) * 1.001f;
+
+    const auto scale = 65536.0f / rootSize_;
+    ParallelFor(threadPool_, 0, planetCount_, bodyChunkSize, [this, scale](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            const auto cellX = std::min(static_cast<std::uint32_t>((xs_[i] - rootCorner_.x) * scale), 0xFFFFu);
+            const auto cellY = std::min(static_cast<std::uint32_t>((ys_[i] - rootCorner_.y) * scale), 0xFFFFu);
+            const std::uint64_t morton = SpreadBits(cellX) | (SpreadBits(cellY) << 1u);
+            keys_[i] = (morton << 32u) | i;
+        }
+        std::sort(keys_.begin() + static_cast<std::ptrdiff_t>(begin), keys_.begin() + static_cast<std::ptrdiff_t>(end));
+    });
+    //Merge the sorted chunks two by two
+    std::vector<std::uint64_t> mergedKeys(planetCount_);
+    for (auto width = bodyChunkSize; width < planetCount_; width *= 2)
+    {
+        ParallelFor(threadPool_, 0, (planetCount_ + 2 * width - 1) / (2 * width), 1, [this, width, &mergedKeys](std::size_t begin, std::size_t end)
+        {
+            for (auto pair = begin; pair < end; pair++)
+            {
+                const auto first = keys_.begin() + static_cast<std::ptrdiff_t>(pair * 2 * width);
+                const auto middle = keys_.begin() + static_cast<std::ptrdiff_t>(std::min(pair * 2 * width + width, planetCount_));
+                const auto last = keys_.begin() + static_cast<std::ptrdiff_t>(std::min(pair * 2 * width + 2 * width, planetCount_));
+                std::merge(first, middle, middle, last, mergedKeys.begin() + (first - keys_.begin()));
+            }
+        });
+        keys_.swap(mergedKeys);
+    }
+
+    //Gather the bodies in key order
+    scratch_.resize(planetCount_);
+    scratchIds_.resize(planetCount_);
+    for (auto* values : { &xs_, &ys_, &velocityXs_, &velocityYs_ })
+    {
+        ParallelFor(threadPool_, 0, planetCount_, bodyChunkSize, [this, values](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; i++)
+            {
+                scratch_[i] = (*values)[static_cast<std::uint32_t>(keys_[i])];
+            }
+        });
+        std::copy_n(scratch_.begin(), planetCount_, values->begin());
+    }
+    ParallelFor(threadPool_, 0, planetCount_, bodyChunkSize, [this](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            scratchIds_[i] = planetIds_[static_cast<std::uint32_t>(keys_[i])];
+        }
+    });
+    planetIds_.swap(scratchIds_);
+    ParallelFor(threadPool_, 0, planetCount_, bodyChunkSize, [this](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            bodyOfPlanet_[planetIds_[i]] = static_cast<std::uint32_t>(i);
+        }
+    });
+}
+
+void BarnesHutSystem::BuildTree() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    quads_.clear();
+    if (planetCount_ == 0)
+    {
+        return;
+    }
+    //Top levels on this thread, the cells under them are built in parallel then appended
+    TreeBuilder topBuilder(quads_, keys_.data(), xs_.data(), ys_.data(), parallelBuildLevel);
+    topBuilder.BuildQuad(0, static_cast<std::uint32_t>(planetCount_), 0, rootCorner_, rootSize_);
+    const auto topQuadCount = quads_.size();
+    const auto& cells = topBuilder.GetDeferredCells();
+
+    std::vector<std::vector<NodeQuad>> cellQuads(cells.size());
+    ParallelFor(threadPool_, 0, cells.size(), 1, [this, &cells, &cellQuads](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            TreeBuilder cellBuilder(cellQuads[i], keys_.data(), xs_.data(), ys_.data(), -1);
+            cellBuilder.BuildQuad(cells[i].begin, cells[i].end, parallelBuildLevel, cells[i].corner, cells[i].size);
+        }
+    });
+    std::vector<std::size_t> offsets(cells.size());
+    auto quadCount = topQuadCount;
+    for (std::size_t i = 0; i < cells.size(); i++)
+    {
+        offsets[i] = quadCount;
+        quadCount += cellQuads[i].size();
+        quads_[cells[i].quad].childQuads[cells[i].lane] = static_cast<std::int32_t>(offsets[i]);
+    }
+    quads_.resize(quadCount);
+    ParallelFor(threadPool_, 0, cells.size(), 1, [this, &offsets, &cellQuads](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            const auto offset = static_cast<std::int32_t>(offsets[i]);
+            for (std::size_t j = 0; j < cellQuads[i].size(); j++)
+            {
+                auto quad = cellQuads[i][j];
+                for (auto& childQuad : quad.childQuads)
+                {
+                    childQuad = childQuad >= 0 ? childQuad + offset : childQuad;
+                }
+                quads_[offsets[i] + j] = quad;
+            }
+        }
+    });
+    //Children always come after their parent, so a reverse walk of the top quads sees complete children
+    for (auto quad = static_cast<std::int32_t>(topQuadCount) - 1; quad >= 0; quad--)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (quads_[quad].childQuads[lane] >= 0)
+            {
+                TreeBuilder::SumChildren(quads_, quad, lane);
+            }
+        }
+    }
+}
+
+void BarnesHutSystem::ComputeGroupAccelerations(std::size_t group, std::vector<float>& sourceXs,
+    std::vector<float>& sourceYs, std::vector<float>& sourceMasses) noexcept
+{
+    const auto begin = group * laneWidth;
+    const auto end = std::min(begin + laneWidth, planetCount_);
+    if (begin >= end)
+    {
+        return;
+    }
+    const LaneVec2f targets{ LaneFloat{ xs_.data() + begin }, LaneFloat{ ys_.data() + begin } };
+    Vec2f groupMin{ xs_[begin], ys_[begin] };
+    Vec2f groupMax = groupMin;
+    for (auto i = begin; i < end; i++)
+    {
+        groupMin = { std::min(groupMin.x, xs_[i]), std::min(groupMin.y, ys_[i]) };
+        groupMax = { std::max(groupMax.x, xs_[i]), std::max(groupMax.y, ys_[i]) };
+    }
+    const auto groupCenter = (groupMin + groupMax) * 0.5f;
+    const auto groupHalfSize = (groupMax - groupMin) * 0.5f;
+    const FourFloat groupCenterXs{ groupCenter.x }, groupCenterYs{ groupCenter.y };
+    const FourFloat groupHalfXs{ groupHalfSize.x }, groupHalfYs{ groupHalfSize.y };
+    const FourFloat zero{ 0.0f };
+    const FourFloat sqrOpeningAngle{ openingAngle_ * openingAngle_ };
+
+    sourceXs.clear();
+    sourceYs.clear();
+    sourceMasses.clear();
+    //Depth first walk, each pop pushes at most 3 more quads than it removes
+    std::array<std::int32_t, 4 * maxLevel> stack{};
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+        const auto& quad = quads_[stack[--stackSize]];
+        //Distance from each child center of mass to the group box
+        const auto dxs = FourFloat::Max((quad.centerXs - groupCenterXs).Abs() - groupHalfXs, zero);
+        const auto dys = FourFloat::Max((quad.centerYs - groupCenterYs).Abs() - groupHalfYs, zero);
+        const auto opened = quad.sizes * quad.sizes - (dxs * dxs + dys * dys) * sqrOpeningAngle;
+        for (int lane = 0; lane < 4; lane++)
+        {
+            if (quad.masses[lane] <= 0.0f)
+            {
+                continue;
+            }
+            if (opened[lane] < 0.0f)
+            {
+                sourceXs.push_back(quad.centerXs[lane]);
+                sourceYs.push_back(quad.centerYs[lane]);
+                sourceMasses.push_back(quad.masses[lane]);
+            }
+            else if (quad.childQuads[lane] >= 0)
+            {
+                stack[stackSize++] = quad.childQuads[lane];
+            }
+            else
+            {
+                for (auto body = quad.bodyBegins[lane]; body < quad.bodyEnds[lane]; body++)
+                {
+                    sourceXs.push_back(xs_[body]);
+                    sourceYs.push_back(ys_[body]);
+                    sourceMasses.push_back(planetMass);
+                }
+            }
+        }
+    }
+    const auto acceleration = AccumulateGravity<laneWidth>(targets, sourceXs.data(), sourceYs.data(), sourceMasses.data(), sourceXs.size());
+    std::copy_n(acceleration.Xs().data(), laneWidth, accelerationXs_.data() + begin);
+    std::copy_n(acceleration.Ys().data(), laneWidth, accelerationYs_.data() + begin);
+}
+
+}
+}
@@ -0,0 +1,218 @@
+#include "block_timestep.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <utility>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+//Blocks handed to a worker at once, small because their cost varies with the level
+constexpr std::size_t blockChunkSize = 16;
+
+//1 / timescale^2 of each lane, the timescale being the shortest of the dynamical time sqrt(r^3 / G) and the
+//crossing time r / |v|, so fast planets falling in are refined before they get close.
+//Only picks a power of two, so the rsqrt estimate is precise enough.
+template<int N>
+FloatArray<N> ComputeInverseSqrTime(const NVec2f<N>& position, const NVec2f<N>& velocity) noexcept
+{
+    const auto delta = position - NVec2f<N>{ worldCenter };
+    const auto sqrRadius = delta.SquareMagnitude();
+    return FloatArray<N>::Max(FloatArray<N>{ G } * sqrRadius.ReciprocalSqrt(), velocity.SquareMagnitude()) / sqrRadius;
+}
+}
+
+template<int N>
+BlockTimestepSystem<N>::BlockTimestepSystem(std::size_t planetCount, float accuracy, ThreadPool* threadPool, std::uint64_t seed) noexcept :
+    threadPool_(threadPool), accuracy_(accuracy), planetCount_(planetCount)
+{
+    const CounterRng rng(seed);
+
+    const auto blockCount = (planetCount + N - 1) / N;
+    positions_.resize(blockCount, NVec2f<N>{ defaultPos });
+    velocities_.resize(blockCount, NVec2f<N>{ defaultVel });
+    blockLevels_.resize(blockCount, 0);
+    planetOfSlot_.resize(blockCount * N, static_cast<std::uint32_t>(planetCount));
+    slotOfPlanet_.resize(planetCount);
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        const auto count = static_cast<int>(std::min<std::size_t>(planetCount - block * N, N));
+        for (int lane = 0; lane < count; lane++)
+        {
+            const auto planet = block * N + lane;
+            planetOfSlot_[planet] = static_cast<std::uint32_t>(planet);
+            slotOfPlanet_[planet] = static_cast<std::uint32_t>(planet);
+        }
+        NVec2f<N> positions, velocities;
+        GenerateOrbits<N>(rng, block * N, positions, velocities);
+        positions_[block] = SimdBackend::Pack<N>(positions.Xs().data(), positions.Ys().data(), count, defaultPos);
+        velocities_[block] = SimdBackend::Pack<N>(velocities.Xs().data(), velocities.Ys().data(), count, defaultVel);
+    }
+}
+
+template<int N>
+void BlockTimestepSystem<N>::Update(float dt) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    if (updateCount_ % sortInterval == 0)
+    {
+        SortByLevel(dt);
+    }
+    updateCount_++;
+    ParallelFor(threadPool_, 0, positions_.size(), blockChunkSize, [this, dt](std::size_t begin, std::size_t end)
+    {
+        for (auto block = begin; block < end; block++)
+        {
+            StepBlock(block, dt);
+        }
+    });
+    for (const auto level : blockLevels_)
+    {
+        forceEvaluationCount_ += (std::uint64_t{ 1 } << level) * N;
+    }
+}
+
+template<int N>
+void BlockTimestepSystem<N>::StepBlock(std::size_t block, float dt) noexcept
+{
+    auto position = positions_[block];
+    auto velocity = velocities_[block];
+    //The fastest planet sets the substep of the whole block, padding lanes are left out
+    const auto inverseSqrTime = ComputeInverseSqrTime(position, velocity);
+    const auto count = static_cast<int>(std::min<std::size_t>(planetCount_ - block * N, N));
+    float maxInverseSqrTime = 0.0f;
+    for (int lane = 0; lane < count; lane++)
+    {
+        maxInverseSqrTime = std::max(maxInverseSqrTime, inverseSqrTime[lane]);
+    }
+    const auto level = ComputeLevel(maxInverseSqrTime, dt);
+    blockLevels_[block] = static_cast<std::uint8_t>(level);
+
+    //Leapfrog with the half drifts of consecutive substeps merged, one force evaluation per substep
+    const auto substepCount = 1 << level;
+    const auto substep = dt / static_cast<float>(substepCount);
+    const FloatArray<N> laneSubstep{ substep };
+    const FloatArray<N> laneHalfSubstep{ 0.5f * substep };
+    const NVec2f<N> laneWorldCenter{ worldCenter };
+    position += velocity * laneHalfSubstep;
+    for (int i = 0; i < substepCount; i++)
+    {
+        velocity += CalculateGravity(position - laneWorldCenter) * laneSubstep;
+        position += velocity * (i + 1 < substepCount ? laneSubstep : laneHalfSubstep);
+    }
+    positions_[block] = position;
+    velocities_[block] = velocity;
+}
+
+template<int N>
+int BlockTimestepSystem<N>::ComputeLevel(float inverseSqrTime, float dt) const noexcept
+{
+    //Smallest level with 4^level >= (dt / (accuracy * timescale))^2, clamped first so the conversion cannot overflow
+    constexpr auto maxSqrSubstepCount = static_cast<float>(1u << (2 * maxLevel));
+    const auto sqrSubstepCount = std::min(dt * dt * inverseSqrTime / (accuracy_ * accuracy_), maxSqrSubstepCount);
+    if (!(sqrSubstepCount > 1.0f))
+    {
+        return 0;
+    }
+    return (std::bit_width(static_cast<unsigned>(std::ceil(sqrSubstepCount)) - 1u) + 1) / 2;
+}
+
+template<int N>
+void BlockTimestepSystem<N>::SortByLevel(float dt) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    //Counting sort of the planets by their own level, finest first
+    //Planets always fill the slots [0, planetCount), padding comes after them
+    std::vector<std::uint8_t> slotLevels(planetCount_);
+    std::array<std::size_t, maxLevel + 2> levelStarts{};
+    for (std::size_t block = 0; block < positions_.size(); block++)
+    {
+        const auto inverseSqrTime = ComputeInverseSqrTime(positions_[block], velocities_[block]);
+        const auto count = static_cast<int>(std::min<std::size_t>(planetCount_ - block * N, N));
+        for (int lane = 0; lane < count; lane++)
+        {
+            const auto level = maxLevel - ComputeLevel(inverseSqrTime[lane], dt);
+            slotLevels[block * N + lane] = static_cast<std::uint8_t>(level);
+            levelStarts[level + 1]++;
+        }
+    }
+    for (int level = 0; level <= maxLevel; level++)
+    {
+        levelStarts[level + 1] += levelStarts[level];
+    }
+    //Scattered slot by slot straight from the blocks, the planet then moves to the slot of its level
+    std::vector<float> xs(planetCount_), ys(planetCount_), velocityXs(planetCount_), velocityYs(planetCount_);
+    std::vector<std::uint32_t> planetOfSlot(planetOfSlot_.size(), static_cast<std::uint32_t>(planetCount_));
+    for (std::size_t oldSlot = 0; oldSlot < planetCount_; oldSlot++)
+    {
+        const auto slot = levelStarts[slotLevels[oldSlot]]++;
+        const auto& position = positions_[oldSlot / N];
+        const auto& velocity = velocities_[oldSlot / N];
+        const auto lane = static_cast<int>(oldSlot % N);
+        xs[slot] = position.Xs()[lane];
+        ys[slot] = position.Ys()[lane];
+        velocityXs[slot] = velocity.Xs()[lane];
+        velocityYs[slot] = velocity.Ys()[lane];
+        planetOfSlot[slot] = planetOfSlot_[oldSlot];
+    }
+    planetOfSlot_ = std::move(planetOfSlot);
+    for (std::size_t slot = 0; slot < planetCount_; slot++)
+    {
+        slotOfPlanet_[planetOfSlot_[slot]] = static_cast<std::uint32_t>(slot);
+    }
+    for (std::size_t block = 0; block < positions_.size(); block++)
+    {
+        const auto begin = block * N;
+        const auto count = static_cast<int>(std::min<std::size_t>(planetCount_ - begin, N));
+        positions_[block] = SimdBackend::Pack<N>(xs.data() + begin, ys.data() + begin, count, defaultPos);
+        velocities_[block] = SimdBackend::Pack<N>(velocityXs.data() + begin, velocityYs.data() + begin, count, defaultVel);
+    }
+}
+
+template<int N>
+Vec2f BlockTimestepSystem<N>::GetPosition(int index) const
+{
+    const auto slot = slotOfPlanet_[index];
+    return SimdBackend::GetLane(positions_[slot / N], static_cast<int>(slot % N));
+}
+
+template<int N>
+Vec2f BlockTimestepSystem<N>::GetVelocity(int index) const
+{
+    const auto slot = slotOfPlanet_[index];
+    return SimdBackend::GetLane(velocities_[slot / N], static_cast<int>(slot % N));
+}
+
+template<int N>
+PositionView BlockTimestepSystem<N>::GetPositions() const noexcept
+{
+    return { reinterpret_cast<const float*>(positions_.data()), planetCount_, N };
+}
+
+template<int N>
+int BlockTimestepSystem<N>::GetLevel(int index) const
+{
+    return blockLevels_[slotOfPlanet_[index] / N];
+}
+
+template class BlockTimestepSystem<4>;
+template class BlockTimestepSystem<8>;
+template class BlockTimestepSystem<16>;
+
+}
+}
@@ -0,0 +1,174 @@
+#include "checkpoint.h"
+
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PLANETS_HAS_MMAP 1
+#endif
+
+namespace planets
+{
+
+namespace
+{
+constexpr std::uint64_t AlignUp(std::uint64_t offset) noexcept
+{
+    return (offset + checkpointAlignment - 1) / checkpointAlignment * checkpointAlignment;
+}
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::filesystem::path& path)
+{
+    std::shared_ptr<MappedFile> file(new MappedFile());
+#if defined(PLANETS_HAS_MMAP)
+    const auto descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+    {
+        return nullptr;
+    }
+    struct stat status{};
+    if (::fstat(descriptor, &status) != 0 || status.st_size <= 0)
+    {
+        ::close(descriptor);
+        return nullptr;
+    }
+    const auto size = static_cast<std::size_t>(status.st_size);
+    //Private and writable: the planet system updates the pages in place without touching the file
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, descriptor, 0);
+    //The mapping keeps the file alive
+    ::close(descriptor);
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    file->data_ = static_cast<std::byte*>(data);
+    file->size_ = size;
+#else
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if (!input)
+    {
+        return nullptr;
+    }
+    const auto size = static_cast<std::size_t>(input.tellg());
+    if (size == 0)
+    {
+        return nullptr;
+    }
+    file->data_ = static_cast<std::byte*>(::operator new(size, std::align_val_t{ checkpointAlignment }));
+    file->size_ = size;
+    input.seekg(0);
+    if (!input.read(reinterpret_cast<char*>(file->data_), static_cast<std::streamsize>(size)))
+    {
+        return nullptr;
+    }
+#endif
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ == nullptr)
+    {
+        return;
+    }
+#if defined(PLANETS_HAS_MMAP)
+    ::munmap(data_, size_);
+#else
+    ::operator delete(data_, std::align_val_t{ checkpointAlignment });
+#endif
+}
+
+bool WriteCheckpoint(const std::filesystem::path& path, CheckpointHeader header, std::span<const std::byte> positions,
+    std::span<const std::byte> velocities, std::span<const float> attractors, std::span<const float> masses)
+{
+    header.positionsOffset = AlignUp(sizeof(CheckpointHeader));
+    header.velocitiesOffset = AlignUp(header.positionsOffset + positions.size());
+    header.attractorCount = attractors.size() / checkpointAttractorFloats;
+    header.attractorsOffset = header.velocitiesOffset + velocities.size();
+    header.massCount = masses.size();
+    header.massesOffset = header.attractorsOffset + attractors.size_bytes();
+    //Written next to path and renamed over it: the blocks may be the pages of the checkpoint being replaced,
+    //which must stay whole until they are written out, and a failed save keeps the previous checkpoint
+    auto temporaryPath = path;
+    temporaryPath += ".tmp";
+    std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+    const std::array<char, checkpointAlignment> padding{};
+    const auto writePadding = [&](std::uint64_t from, std::uint64_t to)
+    {
+        output.write(padding.data(), static_cast<std::streamsize>(to - from));
+    };
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    writePadding(sizeof(header), header.positionsOffset);
+    output.write(reinterpret_cast<const char*>(positions.data()), static_cast<std::streamsize>(positions.size()));
+    writePadding(header.positionsOffset + positions.size(), header.velocitiesOffset);
+    output.write(reinterpret_cast<const char*>(velocities.data()), static_cast<std::streamsize>(velocities.size()));
+    output.write(reinterpret_cast<const char*>(attractors.data()), static_cast<std::streamsize>(attractors.size_bytes()));
+    output.write(reinterpret_cast<const char*>(masses.data()), static_cast<std::streamsize>(masses.size_bytes()));
+    output.close();
+    std::error_code error;
+    if (output.fail())
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    std::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
+
+std::optional<Checkpoint> OpenCheckpoint(const std::filesystem::path& path)
+{
+    auto file = MappedFile::Open(path);
+    if (file == nullptr)
+    {
+        return std::nullopt;
+    }
+    const auto bytes = file->GetBytes();
+    Checkpoint checkpoint;
+    if (bytes.size() < sizeof(CheckpointHeader))
+    {
+        return std::nullopt;
+    }
+    std::memcpy(&checkpoint.header, bytes.data(), sizeof(CheckpointHeader));
+    const auto& header = checkpoint.header;
+    if (header.magic != checkpointMagic || header.version != checkpointVersion || header.width == 0 || header.width > 64
+        || header.scalarSize == 0 || header.scalarSize > 8 || header.blockCount > bytes.size())
+    {
+        return std::nullopt;
+    }
+    const auto blockBytes = header.blockCount * 2 * header.width * header.scalarSize;
+    const auto fits = [&](std::uint64_t offset)
+    {
+        return offset % checkpointAlignment == 0 && offset <= bytes.size() && blockBytes <= bytes.size() - offset;
+    };
+    if (header.blockCount * header.width < header.planetCount || !fits(header.positionsOffset) || !fits(header.velocitiesOffset))
+    {
+        return std::nullopt;
+    }
+    //Counts beyond the file size are rejected first, multiplying them could overflow
+    const auto floatsFit = [&](std::uint64_t offset, std::uint64_t count)
+    {
+        return count <= bytes.size() && offset % alignof(float) == 0 && offset <= bytes.size()
+            && count * sizeof(float) <= bytes.size() - offset;
+    };
+    if (header.attractorCount > bytes.size() || !floatsFit(header.attractorsOffset, header.attractorCount * checkpointAttractorFloats)
+        || (header.massCount != 0 && header.massCount != header.planetCount) || !floatsFit(header.massesOffset, header.massCount))
+    {
+        return std::nullopt;
+    }
+    checkpoint.positions = bytes.subspan(header.positionsOffset, blockBytes);
+    checkpoint.velocities = bytes.subspan(header.velocitiesOffset, blockBytes);
+    checkpoint.attractors = { reinterpret_cast<const float*>(bytes.data() + header.attractorsOffset),
+        header.attractorCount * checkpointAttractorFloats };
+    checkpoint.masses = { reinterpret_cast<const float*>(bytes.data() + header.massesOffset), header.massCount };
+    checkpoint.file = std::move(file);
+    return checkpoint;
+}
+
+}
@@ -0,0 +1,202 @@
+#include "circle_mesh.h"
+#include "thread_pool.h"
+#include "vec.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <utility>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+
+namespace
+{
+//Planets per thread chunk, a multiple of the emission lane count
+constexpr std::size_t emitChunkSize = 1024;
+constexpr int emitLanes = 4;
+
+//Scaled centers of the planets [first, first + count), count <= emitLanes
+void LoadCenters(const PositionView& positions, std::size_t first, int count, const FourFloat& scale, FourFloat& xs, FourFloat& ys) noexcept
+{
+    //Lanes are whole view blocks when the view is at least emitLanes wide, else they are gathered planet by planet
+    if (positions.GetLaneCount() % emitLanes == 0)
+    {
+        const auto block = first / positions.GetLaneCount();
+        const auto lane = first % positions.GetLaneCount();
+        xs = FourFloat{ positions.Xs(block).data() + lane } * scale;
+        ys = FourFloat{ positions.Ys(block).data() + lane } * scale;
+        return;
+    }
+    std::array<float, emitLanes> gatheredXs{}, gatheredYs{};
+    for (int i = 0; i < count; i++)
+    {
+        const auto position = positions[first + i];
+        gatheredXs[i] = position.x;
+        gatheredYs[i] = position.y;
+    }
+    xs = FourFloat{ gatheredXs.data() } * scale;
+    ys = FourFloat{ gatheredYs.data() } * scale;
+}
+
+float LaneMask(bool set) noexcept
+{
+    return std::bit_cast<float>(set ? ~std::uint32_t{} : std::uint32_t{});
+}
+}
+
+CircleMesh::CircleMesh(int resolution, float radius, sf::Color color) : radius_(radius), color_(color)
+{
+    constexpr auto twoPi = 2.0f * std::numbers::pi_v<float>;
+    offsets_.reserve(3 * static_cast<std::size_t>(resolution));
+    for (int i = 0; i < resolution; i++)
+    {
+        const auto angle = static_cast<float>(i) * twoPi / static_cast<float>(resolution);
+        const auto nextAngle = static_cast<float>(i + 1) * twoPi / static_cast<float>(resolution);
+        offsets_.insert(offsets_.end(), { sf::Vector2f{},
+            sf::Vector2f{ std::cos(angle), std::sin(angle) } * radius,
+            sf::Vector2f{ std::cos(nextAngle), std::sin(nextAngle) } * radius });
+    }
+
+    static_assert(sizeof(sf::Vertex) == vertexFloats * sizeof(float) && offsetof(sf::Vertex, position) == 0);
+    //Field of float index of a circle: 0 and 1 the position, 2 the color, 3 and 4 the texture coordinates
+    const auto field = [](std::size_t index) { return index % vertexFloats; };
+    for (std::size_t row = 0; row < vertexFloats; row++)
+    {
+        std::array<float, emitLanes> xMask{}, positionMask{};
+        for (int lane = 0; lane < emitLanes; lane++)
+        {
+            xMask[lane] = LaneMask(field(row * emitLanes + lane) == 0);
+            positionMask[lane] = LaneMask(field(row * emitLanes + lane) < 2);
+        }
+        xMasks_[row] = FourFloat{ xMask.data() };
+        positionMasks_[row] = FourFloat{ positionMask.data() };
+    }
+    const auto rowCount = offsets_.size() * vertexFloats / emitLanes;
+    rows_.reserve(rowCount);
+    for (std::size_t row = 0; row < rowCount; row++)
+    {
+        std::array<float, emitLanes> offsets{}, fill{};
+        for (int lane = 0; lane < emitLanes; lane++)
+        {
+            const auto index = row * emitLanes + lane;
+            const auto& offset = offsets_[index / vertexFloats];
+            offsets[lane] = field(index) == 0 ? offset.x : field(index) == 1 ? offset.y : 0.0f;
+            fill[lane] = field(index) == 2 ? std::bit_cast<float>(color) : 0.0f;
+        }
+        rows_.push_back({ FourFloat{ offsets.data() }, FourFloat{ fill.data() } });
+    }
+}
+
+void CircleMesh::WriteCircle(float centerX, float centerY, sf::Vertex* circle) const noexcept
+{
+    auto* floats = reinterpret_cast<float*>(circle);
+    const auto rowCount = rows_.size();
+    const auto* rows = rows_.data();
+    std::size_t row = 0;
+    //Expanded at compile time over the vertexFloats rows after which the fields repeat, so every row is one add of the
+    //broadcast center and one or of the color, stored whole
+    [&]<std::size_t... F>(std::index_sequence<F...>)
+    {
+        const std::array centers{ FourFloat::Select(positionMasks_[F],
+            FourFloat::Select(xMasks_[F], FourFloat{ centerX }, FourFloat{ centerY }), FourFloat{ 0.0f })... };
+        for (; row + vertexFloats <= rowCount; row += vertexFloats)
+        {
+            (((centers[F] + rows[row + F].offsets) | rows[row + F].fill).Store(floats + (row + F) * emitLanes), ...);
+        }
+        for (; row < rowCount; row++)
+        {
+            ((centers[row % vertexFloats] + rows[row].offsets) | rows[row].fill).Store(floats + row * emitLanes);
+        }
+    }(std::make_index_sequence<vertexFloats>{});
+    for (auto v = rowCount * emitLanes / vertexFloats; v < offsets_.size(); v++)
+    {
+        circle[v] = sf::Vertex{ { centerX + offsets_[v].x, centerY + offsets_[v].y }, color_, {} };
+    }
+}
+
+void CircleMesh::Emit(const PositionView& positions, float scale, std::span<sf::Vertex> vertices, ThreadPool* threadPool) const
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    const auto vertexCount = GetVertexCountPerPlanet();
+    ParallelFor(threadPool, 0, positions.GetPlanetCount(), emitChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        const FourFloat laneScale{ scale };
+        for (auto first = begin; first < end; first += emitLanes)
+        {
+            const auto count = static_cast<int>(std::min<std::size_t>(end - first, emitLanes));
+            FourFloat xs, ys;
+            LoadCenters(positions, first, count, laneScale, xs, ys);
+            //Circle by circle so the vertex stores stay sequential
+            for (int i = 0; i < count; i++)
+            {
+                WriteCircle(xs[i], ys[i], vertices.data() + (first + i) * vertexCount);
+            }
+        }
+    });
+}
+
+std::size_t CircleMesh::EmitVisible(const PositionView& positions, float scale, const sf::FloatRect& bounds,
+    std::span<sf::Vertex> vertices, ThreadPool* threadPool) const
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    const auto planetCount = positions.GetPlanetCount();
+    const auto vertexCount = GetVertexCountPerPlanet();
+    //Circles overlapping the bounds are kept, so the test runs on the bounds grown by the radius
+    const FourFloat left{ bounds.left - radius_ }, right{ bounds.left + bounds.width + radius_ };
+    const FourFloat top{ bounds.top - radius_ }, bottom{ bounds.top + bounds.height + radius_ };
+    const auto visibleMask = [&](std::size_t first, int count, FourFloat& xs, FourFloat& ys)
+    {
+        LoadCenters(positions, first, count, FourFloat{ scale }, xs, ys);
+        const auto countMask = (1u << count) - 1u;
+        return FourFloat::InRangeMask(xs, left, right) & FourFloat::InRangeMask(ys, top, bottom) & countMask;
+    };
+
+    //Visible planets per chunk, then each chunk writes from the sum of the chunks before it
+    const auto chunkCount = (planetCount + emitChunkSize - 1) / emitChunkSize;
+    std::vector<std::size_t> chunkOffsets(chunkCount + 1);
+    ParallelFor(threadPool, 0, planetCount, emitChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t visibleCount = 0;
+        for (auto first = begin; first < end; first += emitLanes)
+        {
+            FourFloat xs, ys;
+            visibleCount += std::popcount(visibleMask(first, static_cast<int>(std::min<std::size_t>(end - first, emitLanes)), xs, ys));
+        }
+        chunkOffsets[begin / emitChunkSize + 1] = visibleCount;
+    });
+    for (std::size_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+        chunkOffsets[chunk + 1] += chunkOffsets[chunk];
+    }
+    ParallelFor(threadPool, 0, planetCount, emitChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        auto circle = chunkOffsets[begin / emitChunkSize];
+        for (auto first = begin; first < end; first += emitLanes)
+        {
+            FourFloat xs, ys;
+            for (auto mask = visibleMask(first, static_cast<int>(std::min<std::size_t>(end - first, emitLanes)), xs, ys);
+                mask != 0; mask &= mask - 1)
+            {
+                const auto i = std::countr_zero(mask);
+                WriteCircle(xs[i], ys[i], vertices.data() + circle * vertexCount);
+                circle++;
+            }
+        }
+    });
+    return chunkOffsets[chunkCount];
+}
+
+}
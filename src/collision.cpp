@@ -0,0 +1,205 @@
+#include "collision.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+constexpr std::size_t planetChunkSize = 1024;
+//Cells of the hash table per thread chunk of the prefix sum
+constexpr std::size_t cellChunkSize = 1 << 16;
+//Where the padding lanes of the sorted arrays lie, finite so its square stays a number under -ffast-math
+constexpr float farAway = 1.0e18f;
+
+struct Cell
+{
+    std::int32_t x;
+    std::int32_t y;
+};
+
+Cell GetCell(float x, float y, float inverseCellSize) noexcept
+{
+    //Clamped so planets thrown far away still get a valid integer cell
+    constexpr float limit = 1 << 30;
+    return { static_cast<std::int32_t>(std::floor(std::clamp(x * inverseCellSize, -limit, limit))),
+        static_cast<std::int32_t>(std::floor(std::clamp(y * inverseCellSize, -limit, limit))) };
+}
+
+//Row major index of the cell wrapped into the table: the grid is tiled over the plane every rowStride cells across and
+//every table size / rowStride rows down. Neighbor cells stay neighbors in the table, unlike with a scrambling hash,
+//so the planets sorted by cell are sorted by place too. Unsigned arithmetic keeps the wrapping consistent below 0.
+std::uint32_t GetCellIndex(std::int32_t x, std::int32_t y, std::uint32_t rowStride, std::uint32_t mask) noexcept
+{
+    return (static_cast<std::uint32_t>(y) * rowStride + static_cast<std::uint32_t>(x)) & mask;
+}
+}
+
+void CollisionGrid::SortByCell(const PositionView& positions, float inverseCellSize, ThreadPool* threadPool)
+{
+    const auto planetCount = positions.GetPlanetCount();
+    const auto laneCount = positions.GetLaneCount();
+    //At least 4 x 4 cells per tile, so the 3 x 3 cells around a planet never share an index
+    const auto tableSize = std::bit_ceil(std::max<std::size_t>(2 * planetCount, 16));
+    tableMask_ = static_cast<std::uint32_t>(tableSize - 1);
+    rowStride_ = 1u << (std::bit_width(tableSize) / 2);
+    cellOfPlanet_.resize(planetCount);
+    cellEnds_.assign(tableSize, 0);
+    ParallelFor(threadPool, 0, positions.GetBlockCount(), std::max<std::size_t>(planetChunkSize / laneCount, 1), [&](std::size_t begin, std::size_t end)
+    {
+        for (auto block = begin; block < end; block++)
+        {
+            const auto xs = positions.Xs(block);
+            const auto ys = positions.Ys(block);
+            const auto first = block * laneCount;
+            const auto lanes = std::min(laneCount, planetCount - first);
+            for (std::size_t lane = 0; lane < lanes; lane++)
+            {
+                const auto [x, y] = GetCell(xs[lane], ys[lane], inverseCellSize);
+                const auto cell = GetCellIndex(x, y, rowStride_, tableMask_);
+                cellOfPlanet_[first + lane] = cell;
+                std::atomic_ref(cellEnds_[cell]).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+
+    //Exclusive prefix sum of the counts: each chunk on its own, then the offsets of the chunks
+    const auto cellChunkCount = (tableSize + cellChunkSize - 1) / cellChunkSize;
+    std::vector<std::uint32_t> chunkOffsets(cellChunkCount);
+    ParallelFor(threadPool, 0, cellChunkCount, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto chunk = begin; chunk < end; chunk++)
+        {
+            std::uint32_t sum = 0;
+            for (auto cell = chunk * cellChunkSize; cell < std::min((chunk + 1) * cellChunkSize, tableSize); cell++)
+            {
+                sum += std::exchange(cellEnds_[cell], sum);
+            }
+            chunkOffsets[chunk] = sum;
+        }
+    });
+    std::exclusive_scan(chunkOffsets.begin(), chunkOffsets.end(), chunkOffsets.begin(), 0u);
+    ParallelFor(threadPool, 0, cellChunkCount, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto chunk = begin; chunk < end; chunk++)
+        {
+            for (auto cell = chunk * cellChunkSize; cell < std::min((chunk + 1) * cellChunkSize, tableSize); cell++)
+            {
+                cellEnds_[cell] += chunkOffsets[chunk];
+            }
+        }
+    });
+
+    //Scattering moves every cell begin to its end. The order inside a cell depends on the threads.
+    sortedXs_.assign(planetCount + laneWidth, farAway);
+    sortedYs_.assign(planetCount + laneWidth, farAway);
+    sortedIds_.resize(planetCount);
+    ParallelFor(threadPool, 0, planetCount, planetChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto i = begin; i < end; i++)
+        {
+            const auto slot = std::atomic_ref(cellEnds_[cellOfPlanet_[i]]).fetch_add(1, std::memory_order_relaxed);
+            const auto position = positions[i];
+            sortedXs_[slot] = position.x;
+            sortedYs_[slot] = position.y;
+            sortedIds_[slot] = static_cast<std::uint32_t>(i);
+        }
+    });
+}
+
+std::size_t CollisionGrid::FindNearest(const PositionView& positions, float distance, ThreadPool* threadPool)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    const auto planetCount = positions.GetPlanetCount();
+    nearest_.assign(planetCount, -1);
+    if (planetCount < 2 || !(distance > 0.0f))
+    {
+        return 0;
+    }
+    const auto inverseCellSize = 1.0f / distance;
+    SortByCell(positions, inverseCellSize, threadPool);
+
+    std::atomic<std::size_t> contactCount{ 0 };
+    const LaneFloat zero{ 0.0f };
+    const LaneFloat sqrDistance{ distance * distance };
+    //In sorted order, so the planets of a chunk share most of their neighbor cells
+    ParallelFor(threadPool, 0, planetCount, planetChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t chunkContacts = 0;
+        for (auto k = begin; k < end; k++)
+        {
+            const auto planet = sortedIds_[k];
+            const auto x = sortedXs_[k];
+            const auto y = sortedYs_[k];
+            const auto cell = GetCell(x, y, inverseCellSize);
+            const LaneFloat laneX{ x };
+            const LaneFloat laneY{ y };
+            float nearestSqrDistance = std::numeric_limits<float>::max();
+            std::int32_t nearest = -1;
+            const auto testRange = [&](std::uint32_t rangeBegin, std::uint32_t rangeEnd)
+            {
+                for (auto j = rangeBegin; j < rangeEnd; j += laneWidth)
+                {
+                    const auto deltaX = LaneFloat{ sortedXs_.data() + j } - laneX;
+                    const auto deltaY = LaneFloat{ sortedYs_.data() + j } - laneY;
+                    const auto sqrDistances = deltaX * deltaX + deltaY * deltaY;
+                    const auto count = std::min<std::uint32_t>(rangeEnd - j, laneWidth);
+                    auto mask = LaneFloat::InRangeMask(sqrDistances, zero, sqrDistance) & ((1u << count) - 1u);
+                    while (mask != 0)
+                    {
+                        const auto lane = std::countr_zero(mask);
+                        mask &= mask - 1;
+                        const auto other = static_cast<std::int32_t>(sortedIds_[j + lane]);
+                        const auto otherSqrDistance = sqrDistances[lane];
+                        if (other != static_cast<std::int32_t>(planet)
+                            && (otherSqrDistance < nearestSqrDistance || (otherSqrDistance == nearestSqrDistance && other < nearest)))
+                        {
+                            nearestSqrDistance = otherSqrDistance;
+                            nearest = other;
+                        }
+                    }
+                }
+            };
+            //The three cells of a row are consecutive in the table, so their planets are one range of the sorted
+            //arrays, or two when the row wraps around the end of the table
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                const auto first = GetCellIndex(cell.x - 1, cell.y + dy, rowStride_, tableMask_);
+                const auto last = GetCellIndex(cell.x + 1, cell.y + dy, rowStride_, tableMask_);
+                const auto rangeBegin = first == 0 ? 0 : cellEnds_[first - 1];
+                if (first <= last)
+                {
+                    testRange(rangeBegin, cellEnds_[last]);
+                }
+                else
+                {
+                    testRange(rangeBegin, cellEnds_[tableMask_]);
+                    testRange(0, cellEnds_[last]);
+                }
+            }
+            nearest_[planet] = nearest;
+            chunkContacts += nearest >= 0;
+        }
+        contactCount.fetch_add(chunkContacts, std::memory_order_relaxed);
+    });
+    return contactCount.load(std::memory_order_relaxed);
+}
+
+}
+}
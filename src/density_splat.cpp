@@ -0,0 +1,141 @@
+#include "density_splat.h"
+#include "thread_pool.h"
+#include "vec.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+
+namespace
+{
+constexpr int splatLanes = 4;
+constexpr std::size_t rowChunkSize = 16;
+//A pixel reaches full brightness at this many planets, with a logarithmic ramp below
+constexpr std::uint32_t saturationCount = 64;
+}
+
+DensitySplat::DensitySplat(unsigned width, unsigned height)
+{
+    Resize(width, height);
+}
+
+void DensitySplat::Resize(unsigned width, unsigned height)
+{
+    width_ = width;
+    height_ = height;
+    counts_.assign(static_cast<std::size_t>(width) * height, 0);
+    pixels_.assign(counts_.size() * 4, 0);
+    sliceCounts_.clear();
+}
+
+void DensitySplat::Accumulate(const PositionView& positions, float scale, const sf::FloatRect& bounds, ThreadPool* threadPool)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    const auto pixelCount = counts_.size();
+    const auto sliceCount = threadPool != nullptr ? threadPool->GetThreadCount() : std::size_t{ 1 };
+    sliceCounts_.resize(sliceCount);
+    const auto planetCount = positions.GetPlanetCount();
+    //Positions to pixel coordinates in one multiply add
+    const auto pixelScaleX = scale * static_cast<float>(width_) / bounds.width;
+    const auto pixelScaleY = scale * static_cast<float>(height_) / bounds.height;
+    const auto pixelOffsetX = -bounds.left * static_cast<float>(width_) / bounds.width;
+    const auto pixelOffsetY = -bounds.top * static_cast<float>(height_) / bounds.height;
+    ParallelFor(threadPool, 0, sliceCount, 1, [&](std::size_t begin, std::size_t end)
+    {
+        const FourFloat scaleX{ pixelScaleX }, scaleY{ pixelScaleY };
+        const FourFloat offsetX{ pixelOffsetX }, offsetY{ pixelOffsetY };
+        const FourFloat zero{ 0.0f };
+        //Just under the size, so the last pixel truncates inside the image
+        const FourFloat maxX{ std::nextafter(static_cast<float>(width_), 0.0f) };
+        const FourFloat maxY{ std::nextafter(static_cast<float>(height_), 0.0f) };
+        for (auto slice = begin; slice < end; slice++)
+        {
+            auto& counts = sliceCounts_[slice];
+            counts.assign(pixelCount, 0);
+            //Slices are rounded to whole lanes of planets
+            const auto first = planetCount * slice / sliceCount / splatLanes * splatLanes;
+            const auto last = slice + 1 == sliceCount ? planetCount : planetCount * (slice + 1) / sliceCount / splatLanes * splatLanes;
+            std::array<float, splatLanes> xs{}, ys{};
+            for (auto planet = first; planet < last; planet += splatLanes)
+            {
+                const auto count = static_cast<int>(std::min<std::size_t>(last - planet, splatLanes));
+                //Whole view blocks are loaded directly, narrower views are gathered planet by planet
+                FourFloat planetXs, planetYs;
+                if (positions.GetLaneCount() % splatLanes == 0)
+                {
+                    const auto block = planet / positions.GetLaneCount();
+                    const auto lane = planet % positions.GetLaneCount();
+                    planetXs = FourFloat{ positions.Xs(block).data() + lane };
+                    planetYs = FourFloat{ positions.Ys(block).data() + lane };
+                }
+                else
+                {
+                    for (int i = 0; i < count; i++)
+                    {
+                        const auto position = positions[planet + i];
+                        xs[i] = position.x;
+                        ys[i] = position.y;
+                    }
+                    planetXs = FourFloat{ xs.data() };
+                    planetYs = FourFloat{ ys.data() };
+                }
+                const auto pixelXs = planetXs * scaleX + offsetX;
+                const auto pixelYs = planetYs * scaleY + offsetY;
+                auto mask = FourFloat::InRangeMask(pixelXs, zero, maxX) & FourFloat::InRangeMask(pixelYs, zero, maxY) & ((1u << count) - 1u);
+                for (; mask != 0; mask &= mask - 1)
+                {
+                    const auto i = std::countr_zero(mask);
+                    const auto pixel = static_cast<std::size_t>(pixelYs[i]) * width_ + static_cast<std::size_t>(pixelXs[i]);
+                    counts[pixel]++;
+                }
+            }
+        }
+    });
+    ParallelFor(threadPool, 0, height_, rowChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        const auto first = begin * width_;
+        const auto last = end * width_;
+        std::fill(counts_.begin() + static_cast<std::ptrdiff_t>(first), counts_.begin() + static_cast<std::ptrdiff_t>(last), 0u);
+        for (const auto& counts : sliceCounts_)
+        {
+            for (auto pixel = first; pixel < last; pixel++)
+            {
+                counts_[pixel] += counts[pixel];
+            }
+        }
+    });
+}
+
+void DensitySplat::Shade(sf::Color color, ThreadPool* threadPool)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    //Whole RGBA pixel per count, so shading is one lookup and one 4 byte store
+    std::array<std::array<std::uint8_t, 4>, saturationCount + 1> shades{};
+    for (std::uint32_t count = 0; count <= saturationCount; count++)
+    {
+        const auto alpha = std::log2(1.0f + static_cast<float>(count)) / std::log2(1.0f + saturationCount);
+        shades[count] = { color.r, color.g, color.b, static_cast<std::uint8_t>(alpha * static_cast<float>(color.a)) };
+    }
+    ParallelFor(threadPool, 0, height_, rowChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto pixel = begin * width_; pixel < end * width_; pixel++)
+        {
+            std::memcpy(pixels_.data() + pixel * 4, shades[std::min(counts_[pixel], saturationCount)].data(), 4);
+        }
+    });
+}
+
+}
@@ -0,0 +1,182 @@
+#include "dispatch.h"
+#include "random.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <string_view>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace planets
+{
+
+namespace
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+struct CpuidRegisters
+{
+    std::uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+};
+
+CpuidRegisters Cpuid(std::uint32_t leaf, std::uint32_t subleaf) noexcept
+{
+    CpuidRegisters registers;
+#if defined(_MSC_VER)
+    int values[4]{};
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    registers = { static_cast<std::uint32_t>(values[0]), static_cast<std::uint32_t>(values[1]),
+        static_cast<std::uint32_t>(values[2]), static_cast<std::uint32_t>(values[3]) };
+#else
+    __cpuid_count(leaf, subleaf, registers.eax, registers.ebx, registers.ecx, registers.edx);
+#endif
+    return registers;
+}
+
+//Register state the os saves on context switches
+std::uint64_t ReadXcr0() noexcept
+{
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    std::uint32_t eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<std::uint64_t>(edx) << 32u) | eax;
+#endif
+}
+
+constexpr bool HasBits(std::uint32_t value, std::uint32_t bits) noexcept
+{
+    return (value & bits) == bits;
+}
+#endif
+}
+
+Isa DetectIsa() noexcept
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    const auto maxLeaf = Cpuid(0, 0).eax;
+    if (maxLeaf < 7)
+    {
+        return Isa::Sse;
+    }
+    const auto leaf1 = Cpuid(1, 0);
+    constexpr std::uint32_t fma = 1u << 12u, movbe = 1u << 22u, osxsave = 1u << 27u, avx = 1u << 28u, f16c = 1u << 29u;
+    if (!HasBits(leaf1.ecx, osxsave | avx))
+    {
+        return Isa::Sse;
+    }
+    const auto xcr0 = ReadXcr0();
+    constexpr std::uint64_t ymmState = 0x6u, zmmState = 0xE6u;
+    const auto leaf7 = Cpuid(7, 0);
+    //Matches the avx2 kernel flags in CMakeLists.txt
+    constexpr std::uint32_t bmi1 = 1u << 3u, avx2 = 1u << 5u, bmi2 = 1u << 8u;
+    if ((xcr0 & ymmState) != ymmState || !HasBits(leaf1.ecx, fma | movbe | f16c) || !HasBits(leaf7.ebx, bmi1 | avx2 | bmi2))
+    {
+        return Isa::Sse;
+    }
+    //Matches the avx512 kernel flags in CMakeLists.txt
+    constexpr std::uint32_t avx512f = 1u << 16u, avx512dq = 1u << 17u, avx512cd = 1u << 28u, avx512bw = 1u << 30u, avx512vl = 1u << 31u;
+    if ((xcr0 & zmmState) != zmmState || !HasBits(leaf7.ebx, avx512f | avx512dq | avx512cd | avx512bw | avx512vl))
+    {
+        return Isa::Avx2;
+    }
+    return Isa::Avx512;
+#else
+    return Isa::Sse;
+#endif
+}
+
+std::optional<Isa> ParseIsa(std::string_view name) noexcept
+{
+    for (const auto isa : { Isa::Sse, Isa::Avx2, Isa::Avx512 })
+    {
+        if (name == GetIsaName(isa))
+        {
+            return isa;
+        }
+    }
+    return std::nullopt;
+}
+
+std::string_view GetIsaName(Isa isa) noexcept
+{
+    switch (isa)
+    {
+    case Isa::Sse: return "sse";
+    case Isa::Avx2: return "avx2";
+    case Isa::Avx512: return "avx512";
+    }
+    return "sse";
+}
+
+int GetLaneWidth(Isa isa) noexcept
+{
+    switch (isa)
+    {
+    case Isa::Sse: return 4;
+    case Isa::Avx2: return 8;
+    case Isa::Avx512: return 16;
+    }
+    return 4;
+}
+
+Isa SelectIsa(int argc, char** argv) noexcept
+{
+    constexpr std::string_view isaArgument = "--isa=";
+    std::optional<Isa> requested;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        if (argument.starts_with(isaArgument))
+        {
+            requested = ParseIsa(argument.substr(isaArgument.size()));
+        }
+    }
+    if (!requested)
+    {
+        if (const char* environment = std::getenv("PLANETS_ISA"); environment != nullptr)
+        {
+            requested = ParseIsa(environment);
+        }
+    }
+    const auto detected = DetectIsa();
+    return requested ? std::min(*requested, detected) : detected;
+}
+
+std::unique_ptr<PlanetSystemInterface> CreatePlanetSystem(Isa isa, int width, std::size_t planetCount, ThreadPool* threadPool,
+    std::optional<std::uint64_t> seed)
+{
+    const auto planetSeed = seed ? *seed : RandomSeed();
+    switch (isa)
+    {
+    case Isa::Avx512: return avx512::CreatePlanetSystem(width, planetCount, threadPool, planetSeed);
+    case Isa::Avx2: return avx2::CreatePlanetSystem(width, planetCount, threadPool, planetSeed);
+    case Isa::Sse: break;
+    }
+    return sse::CreatePlanetSystem(width, planetCount, threadPool, planetSeed);
+}
+
+std::unique_ptr<PlanetSystemInterface> LoadPlanetSystem(Isa isa, const std::filesystem::path& path, ThreadPool* threadPool)
+{
+    auto checkpoint = OpenCheckpoint(path);
+    if (!checkpoint)
+    {
+        return nullptr;
+    }
+    switch (isa)
+    {
+    case Isa::Avx512: return avx512::LoadPlanetSystem(std::move(*checkpoint), threadPool);
+    case Isa::Avx2: return avx2::LoadPlanetSystem(std::move(*checkpoint), threadPool);
+    case Isa::Sse: break;
+    }
+    return sse::LoadPlanetSystem(std::move(*checkpoint), threadPool);
+}
+
+}
@@ -0,0 +1,91 @@
+#include "fft.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <numbers>
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+Fft::Fft(std::size_t size) : size_(size), twiddles_(std::max<std::size_t>(size, 1) - 1), bitReversal_(size)
+{
+    assert(std::has_single_bit(size));
+    //Stage with butterflies half apart reads its half twiddles from half - 1
+    for (std::size_t half = 1; half < size; half *= 2)
+    {
+        for (std::size_t k = 0; k < half; k++)
+        {
+            const auto angle = -std::numbers::pi * static_cast<double>(k) / static_cast<double>(half);
+            twiddles_[half - 1 + k] = { static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle)) };
+        }
+    }
+    const auto bitCount = std::countr_zero(size);
+    for (std::size_t i = 0; i < size; i++)
+    {
+        std::uint32_t reversed = 0;
+        for (int bit = 0; bit < bitCount; bit++)
+        {
+            reversed |= ((i >> bit) & 1u) << (bitCount - 1 - bit);
+        }
+        bitReversal_[i] = reversed;
+    }
+}
+
+void Fft::Forward(std::complex<float>* data) const noexcept
+{
+    Transform(data);
+}
+
+void Fft::Inverse(std::complex<float>* data) const noexcept
+{
+    //Swapping the real and imaginary parts around the forward transform conjugates the twiddles
+    const auto swapParts = [this, data]
+    {
+        for (std::size_t i = 0; i < size_; i++)
+        {
+            data[i] = { data[i].imag(), data[i].real() };
+        }
+    };
+    swapParts();
+    Transform(data);
+    swapParts();
+}
+
+void Fft::Transform(std::complex<float>* data) const noexcept
+{
+    for (std::size_t i = 0; i < size_; i++)
+    {
+        if (i < bitReversal_[i])
+        {
+            std::swap(data[i], data[bitReversal_[i]]);
+        }
+    }
+    //Split in real and imaginary floats so the butterflies are plain multiply adds
+    auto* values = reinterpret_cast<float*>(data);
+    for (std::size_t half = 1; half < size_; half *= 2)
+    {
+        const auto* twiddles = reinterpret_cast<const float*>(twiddles_.data() + half - 1);
+        for (std::size_t begin = 0; begin < size_; begin += 2 * half)
+        {
+            auto* evens = values + 2 * begin;
+            auto* odds = values + 2 * (begin + half);
+            for (std::size_t k = 0; k < half; k++)
+            {
+                const auto twiddleRe = twiddles[2 * k];
+                const auto twiddleIm = twiddles[2 * k + 1];
+                const auto oddRe = twiddleRe * odds[2 * k] - twiddleIm * odds[2 * k + 1];
+                const auto oddIm = twiddleRe * odds[2 * k + 1] + twiddleIm * odds[2 * k];
+                odds[2 * k] = evens[2 * k] - oddRe;
+                odds[2 * k + 1] = evens[2 * k + 1] - oddIm;
+                evens[2 * k] += oddRe;
+                evens[2 * k + 1] += oddIm;
+            }
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,306 @@
+#include "headless.h"
+#include "circle_mesh.h"
+#include "planet.h"
+#include "thread_pool.h"
+#include "trajectory.h"
+
+#include <SFML/Graphics/Rect.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace planets
+{
+
+namespace
+{
+//Same view and circles as the windowed mode at its default zoom
+constexpr float viewWidth = 1280.0f;
+constexpr float viewHeight = 720.0f;
+constexpr int circleResolution = 12;
+constexpr float circleRadius = 3.0f;
+
+template<typename T>
+bool ParseValue(std::string_view text, T& value) noexcept
+{
+    T parsed{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (error != std::errc{} || end != text.data() + text.size())
+    {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+double ElapsedMilliseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+}
+
+std::optional<HeadlessOptions> ParseHeadlessOptions(int argc, char** argv, Isa isa, std::ostream& errors)
+{
+    bool headless = false;
+    HeadlessOptions options;
+    options.width = GetLaneWidth(isa);
+    //Only reported once --headless is known to be there, the windowed mode takes no options
+    std::vector<std::string_view> unknownArguments;
+    std::vector<std::string_view> invalidArguments;
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view argument = argv[i];
+        if (argument == "--headless")
+        {
+            headless = true;
+            continue;
+        }
+        if (argument == "--collisions")
+        {
+            options.collisions = true;
+            continue;
+        }
+        const auto separator = argument.find('=');
+        if (!argument.starts_with("--") || separator == std::string_view::npos)
+        {
+            unknownArguments.push_back(argument);
+            continue;
+        }
+        const auto name = argument.substr(2, separator - 2);
+        const auto text = argument.substr(separator + 1);
+        bool valid = true;
+        if (name == "planets")
+        {
+            valid = ParseValue(text, options.planetCount) && options.planetCount > 0;
+        }
+        else if (name == "backend")
+        {
+            int width = 0;
+            valid = ParseValue(text, width) && (width == 1 || width == 4 || width == 8 || width == 16);
+            if (valid)
+            {
+                options.width = width;
+            }
+        }
+        else if (name == "steps")
+        {
+            valid = ParseValue(text, options.steps) && options.steps > 0;
+        }
+        else if (name == "warmup")
+        {
+            valid = ParseValue(text, options.warmupSteps) && options.warmupSteps >= 0;
+        }
+        else if (name == "dt")
+        {
+            float dt = 0.0f;
+            valid = ParseValue(text, dt) && std::isfinite(dt) && dt > 0.0f;
+            if (valid)
+            {
+                options.dt = dt;
+            }
+        }
+        else if (name == "integrator")
+        {
+            const auto integrator = ParseIntegrator(text);
+            valid = integrator.has_value();
+            if (valid)
+            {
+                options.integrator = *integrator;
+            }
+        }
+        else if (name == "threads")
+        {
+            valid = ParseValue(text, options.threadCount);
+        }
+        else if (name == "resume")
+        {
+            options.resume = text;
+            valid = !text.empty();
+        }
+        else if (name == "checkpoint")
+        {
+            options.checkpoint = text;
+            valid = !text.empty();
+        }
+        else if (name == "record")
+        {
+            options.record = text;
+            valid = !text.empty();
+        }
+        else if (name == "seed")
+        {
+            std::uint64_t seed = 0;
+            valid = ParseValue(text, seed);
+            if (valid)
+            {
+                options.seed = seed;
+            }
+        }
+        //Read by SelectIsa
+        else if (name != "isa")
+        {
+            unknownArguments.push_back(argument);
+            continue;
+        }
+        if (!valid)
+        {
+            invalidArguments.push_back(argument);
+        }
+    }
+    if (!headless)
+    {
+        return std::nullopt;
+    }
+    for (const auto argument : unknownArguments)
+    {
+        errors << "Unknown option " << argument << '\n';
+    }
+    for (const auto argument : invalidArguments)
+    {
+        errors << "Invalid value in " << argument << '\n';
+    }
+    options.invalidOptions = !unknownArguments.empty() || !invalidArguments.empty();
+    return options;
+}
+
+double Percentile(std::span<double> samples, double percent) noexcept
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::ranges::sort(samples);
+    const auto rank = static_cast<std::size_t>(std::ceil(percent / 100.0 * static_cast<double>(samples.size())));
+    return samples[std::clamp<std::size_t>(rank, 1, samples.size()) - 1];
+}
+
+void PrintTimings(std::span<StageTimings> stages, std::ostream& output)
+{
+    output << std::left << std::setw(10) << "stage" << std::right;
+    for (const auto* header : { "p50 ms", "p90 ms", "p99 ms", "max ms" })
+    {
+        output << std::setw(10) << header;
+    }
+    output << '\n' << std::fixed << std::setprecision(3);
+    for (auto& stage : stages)
+    {
+        output << std::left << std::setw(10) << stage.name << std::right;
+        for (const auto percent : { 50.0, 90.0, 99.0, 100.0 })
+        {
+            output << std::setw(10) << Percentile(stage.milliseconds, percent);
+        }
+        output << '\n';
+    }
+}
+
+int RunHeadless(const HeadlessOptions& options, Isa isa, std::ostream& output)
+{
+    ThreadPool threadPool(options.threadCount != 0 ? options.threadCount : std::thread::hardware_concurrency());
+    const auto planetSystem = options.resume.empty() ?
+        CreatePlanetSystem(isa, options.width, options.planetCount, &threadPool, options.seed) :
+        LoadPlanetSystem(isa, options.resume, &threadPool);
+    if (planetSystem == nullptr)
+    {
+        if (options.resume.empty())
+        {
+            output << "No planet system of width " << options.width << '\n';
+        }
+        else
+        {
+            output << "Cannot resume from " << options.resume.string() << '\n';
+        }
+        return 1;
+    }
+    const auto planetCount = planetSystem->GetPositions().GetPlanetCount();
+    const auto width = planetSystem->GetPositions().GetLaneCount();
+    planetSystem->SetIntegrator(options.integrator);
+    if (options.collisions)
+    {
+        planetSystem->SetCollisionRadius(circleRadius / pixelToMeter);
+    }
+    const auto initialEnergy = planetSystem->GetEnergy();
+    output << "Headless: " << planetCount << " planets, width " << width << ", " << GetIsaName(isa)
+        << " kernels, " << threadPool.GetThreadCount() << " threads, " << options.steps << " " << GetIntegratorName(options.integrator)
+        << " steps of " << options.dt << " s\n";
+
+    std::unique_ptr<TrajectoryRecorder> recorder;
+    if (!options.record.empty())
+    {
+        recorder = TrajectoryRecorder::Create(options.record);
+        if (recorder == nullptr)
+        {
+            output << "Cannot write " << options.record.string() << '\n';
+            return 1;
+        }
+        recorder->Record(planetSystem->GetPositions(), planetSystem->GetTime());
+    }
+
+    const CircleMesh circleMesh(circleResolution, circleRadius);
+    std::vector<sf::Vertex> vertices(planetCount * circleMesh.GetVertexCountPerPlanet());
+    const sf::FloatRect viewBounds{ 0.0f, 0.0f, viewWidth, viewHeight };
+    //The record stage is only printed when recording
+    std::array<StageTimings, 4> stages{ { { "update", {} }, { "emit", {} }, { "frame", {} }, { "record", {} } } };
+    for (auto& stage : stages)
+    {
+        stage.milliseconds.reserve(static_cast<std::size_t>(options.steps));
+    }
+    std::size_t visibleCount = 0;
+    for (int step = 0; step < options.warmupSteps + options.steps; step++)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        planetSystem->Update(options.dt);
+        const auto updated = std::chrono::steady_clock::now();
+        visibleCount = circleMesh.EmitVisible(planetSystem->GetPositions(), pixelToMeter, viewBounds, vertices, &threadPool);
+        const auto emitted = std::chrono::steady_clock::now();
+        if (recorder != nullptr)
+        {
+            recorder->Record(planetSystem->GetPositions(), planetSystem->GetTime());
+        }
+        const auto recorded = std::chrono::steady_clock::now();
+        if (step < options.warmupSteps)
+        {
+            continue;
+        }
+        stages[0].milliseconds.push_back(ElapsedMilliseconds(start, updated));
+        stages[1].milliseconds.push_back(ElapsedMilliseconds(updated, emitted));
+        stages[2].milliseconds.push_back(ElapsedMilliseconds(start, recorded));
+        stages[3].milliseconds.push_back(ElapsedMilliseconds(emitted, recorded));
+    }
+    output << visibleCount << " planets visible in the last frame, relative energy drift "
+        << std::abs(planetSystem->GetEnergy() - initialEnergy) / std::abs(initialEnergy) << '\n';
+    if (options.collisions)
+    {
+        output << planetSystem->GetPositions().GetPlanetCount() << " planets left after merging\n";
+    }
+    PrintTimings(std::span(stages).first(recorder != nullptr ? 4 : 3), output);
+    if (recorder != nullptr)
+    {
+        if (!recorder->Flush())
+        {
+            output << "Cannot write " << options.record.string() << '\n';
+            return 1;
+        }
+        output << "Recorded " << recorder->GetFrameCount() << " frames to " << options.record.string() << ", "
+            << static_cast<double>(recorder->GetWrittenBytes()) / static_cast<double>(recorder->GetFrameCount() * planetCount)
+            << " bytes per planet and frame\n";
+    }
+    if (!options.checkpoint.empty())
+    {
+        if (!planetSystem->SaveCheckpoint(options.checkpoint))
+        {
+            output << "Cannot write " << options.checkpoint.string() << '\n';
+            return 1;
+        }
+        output << "Saved " << planetSystem->GetTime() << " s of simulation to " << options.checkpoint.string() << '\n';
+    }
+    return 0;
+}
+
+}
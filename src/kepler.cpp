@@ -0,0 +1,375 @@
+#include "kepler.h"
+#include "thread_pool.h"
+#include "vec_math.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+constexpr std::size_t blockChunkSize = 64;
+//Halley iterations from the starting guesses below, converged to float precision at every eccentricity tested
+constexpr int ellipticIterationCount = 3;
+constexpr int hyperbolicIterationCount = 4;
+//Closest an orbit gets to e = 1, a parabola has no semi major axis and float cannot tell the two apart anyway
+constexpr double minEccentricityGap = 1e-6;
+//Keeps Log and the sign away from zero
+constexpr float tiny = 1e-30f;
+
+//Elements of one orbit, see KeplerSystem::OrbitBlock
+struct Orbit
+{
+    double periapsis = 1.0;
+    double semiMajorAxis = 1.0;
+    double semiMinorAxis = 1.0;
+    double eccentricity = 0.0;
+    double eccentricityGap = 1.0;
+    double meanMotion = 1.0;
+    double meanAnomaly = 0.0;
+    double periapsisX = 1.0;
+    double periapsisY = 0.0;
+    double normalX = 0.0;
+    double normalY = 1.0;
+};
+
+//Computed in double, as the eccentricity vector and the anomalies cancel out heavily near e = 1
+Orbit ComputeOrbit(Vec2f position, Vec2f velocity) noexcept
+{
+    constexpr double mu = G;
+    const double x = position.x - worldCenter.x;
+    const double y = position.y - worldCenter.y;
+    const double vx = velocity.x;
+    const double vy = velocity.y;
+    const auto radius = std::hypot(x, y);
+    const auto sqrSpeed = vx * vx + vy * vy;
+    const auto angularMomentum = x * vy - y * vx;
+    const auto radialSpeed = x * vx + y * vy;
+    const auto ex = ((sqrSpeed - mu / radius) * x - radialSpeed * vx) / mu;
+    const auto ey = ((sqrSpeed - mu / radius) * y - radialSpeed * vy) / mu;
+
+    Orbit orbit;
+    orbit.eccentricity = std::hypot(ex, ey);
+    //A circle has no periapsis, the planet starts on the one we pick
+    const auto circular = orbit.eccentricity < 1e-9;
+    orbit.periapsisX = circular ? x / radius : ex / orbit.eccentricity;
+    orbit.periapsisY = circular ? y / radius : ey / orbit.eccentricity;
+    const auto turn = angularMomentum < 0.0 ? -1.0 : 1.0;
+    orbit.normalX = -turn * orbit.periapsisY;
+    orbit.normalY = turn * orbit.periapsisX;
+    orbit.periapsis = angularMomentum * angularMomentum / mu / (1.0 + orbit.eccentricity);
+    orbit.eccentricityGap = std::max(std::abs(1.0 - orbit.eccentricity), minEccentricityGap);
+    orbit.eccentricity = orbit.eccentricity < 1.0 ? 1.0 - orbit.eccentricityGap : 1.0 + orbit.eccentricityGap;
+    orbit.semiMajorAxis = orbit.periapsis / orbit.eccentricityGap;
+    orbit.semiMinorAxis = orbit.semiMajorAxis * std::sqrt(orbit.eccentricityGap * (1.0 + orbit.eccentricity));
+    orbit.meanMotion = std::sqrt(mu / (orbit.semiMajorAxis * orbit.semiMajorAxis * orbit.semiMajorAxis));
+
+    //Half of the true anomaly, then the eccentric or hyperbolic one from tan(nu / 2)
+    const auto halfTrueAnomaly = 0.5 * std::atan2(x * orbit.normalX + y * orbit.normalY, x * orbit.periapsisX + y * orbit.periapsisY);
+    const auto ratio = std::sqrt(orbit.eccentricityGap / (1.0 + orbit.eccentricity));
+    if (orbit.eccentricity < 1.0)
+    {
+        const auto anomaly = 2.0 * std::atan(ratio * std::tan(halfTrueAnomaly));
+        orbit.meanAnomaly = anomaly - orbit.eccentricity * std::sin(anomaly);
+    }
+    else
+    {
+        const auto anomaly = 2.0 * std::atanh(ratio * std::tan(halfTrueAnomaly));
+        orbit.meanAnomaly = orbit.eccentricity * std::sinh(anomaly) - anomaly;
+    }
+    return orbit;
+}
+
+template<int N>
+FloatArray<N> Cbrt(const FloatArray<N>& x) noexcept
+{
+    return Exp(Log(x + FloatArray<N>{ tiny }) * (1.0f / 3.0f));
+}
+
+//Sign of each lane, and 0 for a zero lane
+template<int N>
+FloatArray<N> Sign(const FloatArray<N>& x) noexcept
+{
+    return x / (x.Abs() + FloatArray<N>{ tiny });
+}
+
+//x - sin(x) for x in [0, 2], from its Taylor series as the difference loses every digit near 0, where the near
+//parabolic orbits need them
+template<int N>
+FloatArray<N> IdentityMinusSin(const FloatArray<N>& x) noexcept
+{
+    const auto x2 = x * x;
+    auto polynomial = FloatArray<N>{ 1.0f / 1307674368000.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ -1.0f / 6227020800.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 39916800.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ -1.0f / 362880.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 5040.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ -1.0f / 120.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 6.0f };
+    return x * x2 * polynomial;
+}
+
+//sinh(x) - x for x in [0, 87], the Taylor series up to 2 and the exponentials past it
+template<int N>
+FloatArray<N> SinhMinusIdentity(const FloatArray<N>& x) noexcept
+{
+    const auto x2 = x * x;
+    auto polynomial = FloatArray<N>{ 1.0f / 1307674368000.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 6227020800.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 39916800.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 362880.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 5040.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 120.0f };
+    polynomial = polynomial * x2 + FloatArray<N>{ 1.0f / 6.0f };
+    const auto series = x * x2 * polynomial;
+    const auto exp = Exp(x);
+    const auto direct = (exp - FloatArray<N>{ 1.0f } / exp) * 0.5f - x;
+    //0 up to 2 and 1 from just past it, both sides agree in between
+    const auto weight = FloatArray<N>::Min(FloatArray<N>::Max((x - FloatArray<N>{ 2.0f }) * 1e6f, FloatArray<N>{ 0.0f }), FloatArray<N>{ 1.0f });
+    return series + (direct - series) * weight;
+}
+}
+
+template<int N>
+KeplerSystem<N>::KeplerSystem(std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed) : threadPool_(threadPool)
+{
+    const CounterRng rng(seed);
+    std::vector<Vec2f> positions(planetCount), velocities(planetCount);
+    for (std::size_t first = 0; first < planetCount; first += N)
+    {
+        NVec2f<N> blockPositions, blockVelocities;
+        GenerateOrbits<N>(rng, first, blockPositions, blockVelocities);
+        for (std::size_t lane = 0; lane < std::min<std::size_t>(N, planetCount - first); lane++)
+        {
+            positions[first + lane] = SimdBackend::GetLane(blockPositions, static_cast<int>(lane));
+            velocities[first + lane] = SimdBackend::GetLane(blockVelocities, static_cast<int>(lane));
+        }
+    }
+    Initialize(positions, velocities);
+}
+
+template<int N>
+KeplerSystem<N>::KeplerSystem(std::span<const Vec2f> positions, std::span<const Vec2f> velocities, ThreadPool* threadPool) :
+    threadPool_(threadPool)
+{
+    Initialize(positions, velocities);
+}
+
+template<int N>
+void KeplerSystem<N>::Initialize(std::span<const Vec2f> positions, std::span<const Vec2f> velocities)
+{
+    assert(positions.size() == velocities.size());
+    planetCount_ = positions.size();
+    std::vector<Orbit> orbits(planetCount_);
+    hyperbolicBegin_ = 0;
+    for (std::size_t i = 0; i < planetCount_; i++)
+    {
+        orbits[i] = ComputeOrbit(positions[i], velocities[i]);
+        hyperbolicBegin_ += orbits[i].eccentricity < 1.0;
+    }
+    //Elliptic orbits take the first slots, hyperbolic ones the next, each in planet order
+    slotOfPlanet_.resize(planetCount_);
+    std::vector<Orbit> slotOrbits(planetCount_);
+    std::size_t ellipticSlot = 0;
+    std::size_t hyperbolicSlot = hyperbolicBegin_;
+    for (std::size_t i = 0; i < planetCount_; i++)
+    {
+        const auto slot = orbits[i].eccentricity < 1.0 ? ellipticSlot++ : hyperbolicSlot++;
+        slotOfPlanet_[i] = static_cast<std::uint32_t>(slot);
+        slotOrbits[slot] = orbits[i];
+    }
+
+    const auto blockCount = (planetCount_ + N - 1) / N;
+    orbits_.resize(blockCount);
+    positions_.resize(blockCount, NVec2f<N>{ defaultPos });
+    //Padding lanes always go through the hyperbolic solver, so they get a hyperbola that does not choke it
+    const Orbit padding{ .semiMinorAxis = std::numbers::sqrt3, .eccentricity = 2.0 };
+    std::array<std::array<float, N>, 9> lanes{};
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        for (int lane = 0; lane < N; lane++)
+        {
+            const auto slot = block * N + lane;
+            const auto& orbit = slot < planetCount_ ? slotOrbits[slot] : padding;
+            lanes[0][lane] = static_cast<float>(orbit.periapsis);
+            lanes[1][lane] = static_cast<float>(orbit.semiMajorAxis);
+            lanes[2][lane] = static_cast<float>(orbit.semiMinorAxis);
+            lanes[3][lane] = static_cast<float>(orbit.eccentricity);
+            lanes[4][lane] = static_cast<float>(orbit.eccentricityGap);
+            orbits_[block].meanMotions[lane] = orbit.meanMotion;
+            orbits_[block].meanAnomalies[lane] = orbit.meanAnomaly;
+            lanes[5][lane] = static_cast<float>(orbit.periapsisX);
+            lanes[6][lane] = static_cast<float>(orbit.periapsisY);
+            lanes[7][lane] = static_cast<float>(orbit.normalX);
+            lanes[8][lane] = static_cast<float>(orbit.normalY);
+        }
+        auto& orbitBlock = orbits_[block];
+        orbitBlock.periapses = FloatArray<N>{ lanes[0].data() };
+        orbitBlock.semiMajorAxes = FloatArray<N>{ lanes[1].data() };
+        orbitBlock.semiMinorAxes = FloatArray<N>{ lanes[2].data() };
+        orbitBlock.eccentricities = FloatArray<N>{ lanes[3].data() };
+        orbitBlock.eccentricityGaps = FloatArray<N>{ lanes[4].data() };
+        orbitBlock.periapsisDirections = NVec2f<N>{ FloatArray<N>{ lanes[5].data() }, FloatArray<N>{ lanes[6].data() } };
+        orbitBlock.normalDirections = NVec2f<N>{ FloatArray<N>{ lanes[7].data() }, FloatArray<N>{ lanes[8].data() } };
+    }
+    SetTime(0.0);
+}
+
+template<int N>
+void KeplerSystem<N>::SetTime(double time) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    time_ = time;
+    ParallelFor(threadPool_, 0, positions_.size(), blockChunkSize, [this, time](std::size_t begin, std::size_t end)
+    {
+        for (auto block = begin; block < end; block++)
+        {
+            positions_[block] = ComputeBlock(block, time);
+        }
+    });
+}
+
+template<int N>
+NVec2f<N> KeplerSystem<N>::ComputeBlock(std::size_t block, double time) const noexcept
+{
+    const auto& orbit = orbits_[block];
+    const auto& e = orbit.eccentricities;
+    const FloatArray<N> one{ 1.0f };
+    const FloatArray<N> two{ 2.0f };
+    //M0 + n t in double, elliptic lanes brought back within [-pi, pi] before the float solvers see it: float keeps
+    //the same precision at any time this way, where its ulp of n t would grow with the jump
+    const auto begin = block * N;
+    const auto ellipticCount = static_cast<int>(std::min<std::size_t>(hyperbolicBegin_ - std::min(hyperbolicBegin_, begin), N));
+    std::array<float, N> meanAnomalies{};
+    for (int lane = 0; lane < N; lane++)
+    {
+        constexpr double twoPi = 2.0 * std::numbers::pi;
+        const auto anomaly = orbit.meanAnomalies[lane] + orbit.meanMotions[lane] * time;
+        const auto turns = lane < ellipticCount ? std::round(anomaly * (1.0 / twoPi)) : 0.0;
+        meanAnomalies[lane] = static_cast<float>(anomaly - turns * twoPi);
+    }
+    //Both solvers work on |M| and mirror the result, as the orbit is symmetric about the periapsis
+    const FloatArray<N> meanAnomaly{ meanAnomalies.data() };
+
+    //Kepler equations written as x - sin(x) or sinh(x) - x plus |1 - e| terms, which stay precise near e = 1
+    const auto computeElliptic = [&]()
+    {
+        const auto m = meanAnomaly.Abs();
+        //E - e sin(E) = m, E is within [m, m + e] and close to cbrt(6 m) for m near 0 and e near 1
+        auto anomaly = FloatArray<N>::Min(m + e * 0.85f, Cbrt(m * 6.0f));
+        //From E / 2 only: x - sin(x) there, then the versine 1 - cos(E / 2) and the double angle without a difference
+        FloatArray<N> sin, halfSin, identityMinusSin;
+        const auto computeSines = [&]()
+        {
+            const auto half = anomaly * 0.5f;
+            const auto halfIdentityMinusSin = IdentityMinusSin(half);
+            halfSin = half - halfIdentityMinusSin;
+            const auto halfSqrSin = halfSin * halfSin;
+            const auto halfVersine = halfSqrSin / (one + (one - halfSqrSin).Sqrt());
+            sin = two * halfSin * (one - halfVersine);
+            identityMinusSin = two * halfIdentityMinusSin * (one - halfVersine) + anomaly * halfVersine;
+        };
+        for (int i = 0; i < ellipticIterationCount; i++)
+        {
+            computeSines();
+            const auto oneMinusCos = two * halfSin * halfSin;
+            const auto f = identityMinusSin + orbit.eccentricityGaps * sin - m;
+            const auto derivative = oneMinusCos + orbit.eccentricityGaps * (one - oneMinusCos);
+            anomaly = anomaly - two * f * derivative / (two * derivative * derivative - f * e * sin);
+        }
+        computeSines();
+        const auto x = orbit.periapses - two * orbit.semiMajorAxes * halfSin * halfSin;
+        const auto y = orbit.semiMinorAxes * sin * Sign(meanAnomaly);
+        return orbit.periapsisDirections * x + orbit.normalDirections * y + NVec2f<N>{ worldCenter };
+    };
+    const auto computeHyperbolic = [&]()
+    {
+        const auto m = meanAnomaly.Abs();
+        //e sinh(H) - H = m, H is close to ln(2 m / e) for large m and to cbrt(6 m) for m near 0 and e near 1
+        auto anomaly = FloatArray<N>::Min(Log(m * two / e + FloatArray<N>{ 1.8f }), Cbrt(m * 6.0f));
+        //Same with sinh(x) - x at H / 2 and cosh(H / 2) - 1
+        FloatArray<N> sinh, halfSinh, sinhMinusAnomaly;
+        const auto computeSinhs = [&]()
+        {
+            const auto half = anomaly * 0.5f;
+            const auto halfSinhMinusIdentity = SinhMinusIdentity(half);
+            halfSinh = half + halfSinhMinusIdentity;
+            const auto halfSqrSinh = halfSinh * halfSinh;
+            const auto halfCoshMinusOne = halfSqrSinh / (one + (one + halfSqrSinh).Sqrt());
+            sinh = two * halfSinh * (one + halfCoshMinusOne);
+            sinhMinusAnomaly = two * halfSinhMinusIdentity * (one + halfCoshMinusOne) + anomaly * halfCoshMinusOne;
+        };
+        for (int i = 0; i < hyperbolicIterationCount; i++)
+        {
+            computeSinhs();
+            const auto coshMinusOne = two * halfSinh * halfSinh;
+            const auto f = sinhMinusAnomaly + orbit.eccentricityGaps * sinh - m;
+            const auto derivative = coshMinusOne + orbit.eccentricityGaps * (one + coshMinusOne);
+            anomaly = anomaly - two * f * derivative / (two * derivative * derivative - f * e * sinh);
+        }
+        computeSinhs();
+        const auto x = orbit.periapses - two * orbit.semiMajorAxes * halfSinh * halfSinh;
+        const auto y = orbit.semiMinorAxes * sinh * Sign(meanAnomaly);
+        return orbit.periapsisDirections * x + orbit.normalDirections * y + NVec2f<N>{ worldCenter };
+    };
+
+    if (begin + N <= hyperbolicBegin_)
+    {
+        return computeElliptic();
+    }
+    if (begin >= hyperbolicBegin_)
+    {
+        return computeHyperbolic();
+    }
+    //The one block holding both kinds
+    const auto elliptic = computeElliptic();
+    const auto hyperbolic = computeHyperbolic();
+    std::array<float, N> xs{}, ys{};
+    for (int lane = 0; lane < N; lane++)
+    {
+        const auto& position = lane < ellipticCount ? elliptic : hyperbolic;
+        xs[lane] = position.Xs()[lane];
+        ys[lane] = position.Ys()[lane];
+    }
+    return { FloatArray<N>{ xs.data() }, FloatArray<N>{ ys.data() } };
+}
+
+template<int N>
+Vec2f KeplerSystem<N>::GetPosition(int index) const
+{
+    const auto slot = slotOfPlanet_[index];
+    return SimdBackend::GetLane(positions_[slot / N], static_cast<int>(slot % N));
+}
+
+template<int N>
+Vec2f KeplerSystem<N>::ComputePosition(int index, double time) const
+{
+    const auto slot = slotOfPlanet_[index];
+    return SimdBackend::GetLane(ComputeBlock(slot / N, time), static_cast<int>(slot % N));
+}
+
+template<int N>
+PositionView KeplerSystem<N>::GetPositions() const noexcept
+{
+    return { reinterpret_cast<const float*>(positions_.data()), planetCount_, N };
+}
+
+template class KeplerSystem<4>;
+template class KeplerSystem<8>;
+template class KeplerSystem<16>;
+
+}
+}
@@ -1,10 +1,17 @@
 //
 // Created by efarhan on 1/27/23.
 //
-#include <numbers>
-
-#include "vec.h"
+#include "circle_mesh.h"
+#include "density_splat.h"
+#include "dispatch.h"
+#include "headless.h"
 #include "planet.h"
+#include "simulation_thread.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Window/Event.hpp>
@@ -12,6 +19,8 @@
 #include <SFML/System/Clock.hpp>
 #include <SFML/Graphics/View.hpp>
 #include <SFML/Graphics/CircleShape.hpp>
+#include <SFML/Graphics/Sprite.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <SFML/System/Time.hpp>
 
 #ifdef TRACY_ENABLE
@@ -24,30 +33,44 @@ constexpr unsigned int width = 1280;
 constexpr unsigned int height = 720;
 constexpr auto planetCount = 10'000;
 constexpr float zoomFactor = 1.5f;
+constexpr float simulationDt = 1.0f / 120.0f;
 constexpr auto circleResolution = 12;
 constexpr auto circleRadius = 3.0f;
-constexpr auto twoPi = 2.0f * std::numbers::pi_v<float>;
+//Under this on screen radius in pixels, the planets are drawn as a density image instead of circles
+constexpr auto minCircleRadius = 1.5f;
 
-int main()
+int main(int argc, char** argv)
 {
-    planets::PlanetSystem4 planetSystem(planetCount);
-
-	std::vector<planets::Vec2f> circleVertices;
-	circleVertices.reserve(circleResolution);
-	for (int i = 1; i < circleResolution; i++)
-	{
-		circleVertices.emplace_back(std::cos(float(i) * twoPi / circleResolution), std::sin(float(i) * twoPi / circleResolution));
-	}
-
+    const auto isa = planets::SelectIsa(argc, argv);
+    std::cout << "Using " << planets::GetIsaName(isa) << " kernels\n";
+    if (const auto headlessOptions = planets::ParseHeadlessOptions(argc, argv, isa, std::cerr))
+    {
+        if (headlessOptions->invalidOptions)
+        {
+            return 1;
+        }
+        return planets::RunHeadless(*headlessOptions, isa, std::cout);
+    }
+    //The render thread builds the vertices on its own pool while the simulation pool runs the next step, a ThreadPool
+    //takes one caller at a time. A quarter of the cores draw, the render thread being one of them.
+    const auto coreCount = std::max(std::thread::hardware_concurrency(), 2u);
+    const auto renderThreadCount = std::max(coreCount / 4, 1u);
+    planets::ThreadPool simulationPool(coreCount - renderThreadCount);
+    planets::ThreadPool renderPool(renderThreadCount);
+    const auto planetSystem = planets::CreatePlanetSystem(isa, planets::GetLaneWidth(isa), planetCount, &simulationPool);
+    planets::SimulationThread simulation(*planetSystem, simulationDt);
+
+	const planets::CircleMesh circleMesh(circleResolution, circleRadius, sf::Color::Blue);
 	sf::VertexArray circles;
 	circles.setPrimitiveType(sf::Triangles);
-	circles.resize(planetCount*(circleResolution*3));
-	for(std::size_t i = 0; i < circles.getVertexCount(); i++)
-	{
-		circles[i].color = sf::Color::Blue;
-	}
+	circles.resize(planetCount * circleMesh.GetVertexCountPerPlanet());
 
 
+    planets::DensitySplat densitySplat(width, height);
+    sf::Texture densityTexture;
+    densityTexture.create(width, height);
+    sf::Sprite densitySprite(densityTexture);
+
     sf::RenderWindow window(sf::VideoMode(width, height), "Planets");
     //window.setFramerateLimit(5);
     sf::Clock clock;
@@ -67,6 +90,9 @@ int main()
             {
                 view = sf::View({ 0,0 }, { static_cast<float>(event.size.width), static_cast<float>(event.size.height) });
                 window.setView(view);
+                densitySplat.Resize(event.size.width, event.size.height);
+                densityTexture.create(event.size.width, event.size.height);
+                densitySprite.setTexture(densityTexture, true);
             }
             if (event.type == sf::Event::MouseWheelScrolled)
             {
@@ -77,23 +103,30 @@ int main()
 #ifdef TRACY_ENABLE
         TracyCZoneEnd(eventHandle);
 #endif
-        planetSystem.Update(dt.asSeconds());
+        const auto positions = simulation.GetPositions(std::chrono::steady_clock::now());
 
 #ifdef TRACY_ENABLE
         TracyCZoneN(moveCircles, "Move Circles", true);
 #endif
-        for(int i = 0; i < planetCount; i++)
+        const auto viewCorner = view.getCenter() - view.getSize() / 2.0f;
+        const sf::FloatRect viewBounds{ viewCorner.x, viewCorner.y, view.getSize().x, view.getSize().y };
+        const auto windowSize = sf::Vector2f(window.getSize());
+        const auto useDensity = circleRadius * windowSize.x / view.getSize().x < minCircleRadius;
+        std::size_t visibleCount = 0;
+        if (useDensity)
         {
-            const auto position = planetSystem.GetPosition(i);
-        	const auto currentIndex = circleResolution*3*i;
-        	const auto pixelPosition = static_cast<sf::Vector2f>(position*planets::pixelToMeter);
-        	for(int j = 0; j < circleResolution; j++)
-        	{
-        		circles[currentIndex+j*3].position = pixelPosition;
-        		circles[currentIndex+j*3+1].position = pixelPosition+static_cast<sf::Vector2f>(circleVertices[j]*circleRadius);
-        		circles[currentIndex+j*3+2].position = pixelPosition+static_cast<sf::Vector2f>(circleVertices[(j+1)%circleResolution]*circleRadius);
-        	}
-
+            //Zoomed out, one window sized image of the planet density replaces the sub pixel circles
+            densitySplat.Accumulate(positions, planets::pixelToMeter, viewBounds, &renderPool);
+            densitySplat.Shade(sf::Color::Blue, &renderPool);
+            densityTexture.update(densitySplat.GetPixels());
+            densitySprite.setPosition(viewCorner);
+            densitySprite.setScale({ view.getSize().x / windowSize.x, view.getSize().y / windowSize.y });
+        }
+        else
+        {
+            //Only the circles inside the view are built and drawn, packed at the front of circles
+            visibleCount = circleMesh.EmitVisible(positions, planets::pixelToMeter, viewBounds,
+                { &circles[0], circles.getVertexCount() }, &renderPool);
         }
 #ifdef TRACY_ENABLE
     	TracyCZoneEnd(moveCircles);
@@ -102,7 +135,14 @@ int main()
 #endif
         window.clear();
 
-        window.draw(circles);
+        if (useDensity)
+        {
+            window.draw(densitySprite);
+        }
+        else
+        {
+            window.draw(&circles[0], visibleCount * circleMesh.GetVertexCountPerPlanet(), sf::Triangles);
+        }
 
 #ifdef TRACY_ENABLE
     	TracyCZoneEnd(draw);
@@ -0,0 +1,138 @@
+#include "nbody.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+//Tiles per chunk handed to a worker
+constexpr std::size_t tileChunkSize = 4;
+
+template<int N, int TileSize>
+void ComputeTiles(const std::vector<NVec2f<N>>& positions, const std::vector<FloatArray<N>>& masses,
+    std::vector<NVec2f<N>>& accelerations, ThreadPool* threadPool)
+{
+    const auto tileCount = positions.size() / TileSize;
+    ParallelFor(threadPool, 0, tileCount, tileChunkSize, [&](std::size_t begin, std::size_t end)
+    {
+        for (auto tile = begin; tile < end; tile++)
+        {
+            AccumulateGravityTile<N, TileSize>(positions.data() + tile * TileSize, accelerations.data() + tile * TileSize,
+                positions.data(), masses.data(), positions.size());
+        }
+    });
+}
+}
+
+template<int N>
+DirectSumSystem<N>::DirectSumSystem(std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed) noexcept :
+    threadPool_(threadPool)
+{
+    const CounterRng rng(seed);
+
+    const auto blockCount = (planetCount / N + tileSize) / tileSize * tileSize;
+    positions_.resize(blockCount, NVec2f<N>{ defaultPos });
+    velocities_.resize(blockCount, NVec2f<N>{ defaultVel });
+    accelerations_.resize(blockCount);
+    masses_.resize(blockCount, FloatArray<N>{ 0.0f });
+    std::array<float, N> planetMasses{};
+    planetMasses.fill(planetMass);
+    for (std::size_t block = 0; block * N < planetCount; block++)
+    {
+        const auto count = static_cast<int>(std::min<std::size_t>(planetCount - block * N, N));
+        NVec2f<N> positions, velocities;
+        GenerateOrbits<N>(rng, block * N, positions, velocities);
+        positions_[block] = SimdBackend::Pack<N>(positions.Xs().data(), positions.Ys().data(), count, defaultPos);
+        velocities_[block] = SimdBackend::Pack<N>(velocities.Xs().data(), velocities.Ys().data(), count, defaultVel);
+        masses_[block] = FloatArray<N>{ planetMasses.data(), count, 0.0f };
+    }
+}
+
+template<int N>
+void DirectSumSystem<N>::Update(float dt) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    ComputeMutualAccelerations();
+    ParallelFor(threadPool_, 0, positions_.size(), 1024, [this, dt](std::size_t begin, std::size_t end)
+    {
+        const NVec2f<N> nWorldCenter{ worldCenter };
+        const FloatArray<N> nDt{ dt };
+        for (auto i = begin; i < end; i++)
+        {
+            //Calculate new velocity
+            const auto delta = positions_[i] - nWorldCenter;
+            const auto accelerationValue = CalculateAcceleration(delta.SquareMagnitude());
+            const auto acceleration = (-delta).Normalized() * accelerationValue + accelerations_[i];
+            velocities_[i] += acceleration * nDt;
+            //Calculate new position
+            positions_[i] += velocities_[i] * nDt;
+        }
+    });
+}
+
+template<int N>
+Vec2f DirectSumSystem<N>::GetPosition(int index) const
+{
+    return { positions_[index / N].Xs()[index % N], positions_[index / N].Ys()[index % N] };
+}
+
+template<int N>
+Vec2f DirectSumSystem<N>::GetMutualAcceleration(int index) const
+{
+    return { accelerations_[index / N].Xs()[index % N], accelerations_[index / N].Ys()[index % N] };
+}
+
+template<int N>
+void DirectSumSystem<N>::ComputeMutualAccelerations() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    ComputeTiles<N, tileSize>(positions_, masses_, accelerations_, threadPool_);
+}
+
+template class DirectSumSystem<4>;
+template class DirectSumSystem<8>;
+template class DirectSumSystem<16>;
+
+std::vector<Vec2f> ComputeDirectAccelerations(std::span<const Vec2f> positions, ThreadPool* threadPool)
+{
+    constexpr int tileSize = DirectSumSystem<laneWidth>::tileSize;
+    const auto blockCount = (positions.size() / laneWidth + tileSize) / tileSize * tileSize;
+    std::vector<LaneVec2f> blocks(blockCount, LaneVec2f{ defaultPos });
+    std::vector<LaneFloat> masses(blockCount, LaneFloat{ 0.0f });
+    std::vector<LaneVec2f> accelerations(blockCount);
+    for (std::size_t block = 0; block * laneWidth < positions.size(); block++)
+    {
+        const auto count = static_cast<int>(std::min<std::size_t>(positions.size() - block * laneWidth, laneWidth));
+        std::array<Vec2f, laneWidth> blockPositions;
+        blockPositions.fill(defaultPos);
+        std::copy_n(positions.begin() + static_cast<std::ptrdiff_t>(block * laneWidth), count, blockPositions.begin());
+        blocks[block] = LaneVec2f{ blockPositions };
+        std::array<float, laneWidth> blockMasses{};
+        std::fill_n(blockMasses.begin(), count, planetMass);
+        masses[block] = LaneFloat{ blockMasses.data() };
+    }
+    ComputeTiles<laneWidth, tileSize>(blocks, masses, accelerations, threadPool);
+
+    std::vector<Vec2f> result(positions.size());
+    for (std::size_t i = 0; i < positions.size(); i++)
+    {
+        result[i] = { accelerations[i / laneWidth].Xs()[i % laneWidth], accelerations[i / laneWidth].Ys()[i % laneWidth] };
+    }
+    return result;
+}
+
+}
+}
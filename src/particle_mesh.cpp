@@ -0,0 +1,294 @@
+#include "particle_mesh.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+inline namespace PLANETS_ISA
+{
+
+namespace
+{
+//Side of the mesh, wide enough for the initial ring and the planets it throws out
+constexpr float meshExtent = 4.0f * outerRaidus;
+constexpr std::size_t blockChunkSize = 1024;
+constexpr std::size_t rowChunkSize = 8;
+}
+
+ParticleMeshSystem::ParticleMeshSystem(std::size_t planetCount, int gridSize, ThreadPool* threadPool, std::uint64_t seed) :
+    threadPool_(threadPool), planetCount_(planetCount), gridSize_(static_cast<std::size_t>(gridSize)),
+    fft_(2 * static_cast<std::size_t>(gridSize))
+{
+    const CounterRng rng(seed);
+
+    const auto blockCount = (planetCount + laneWidth - 1) / laneWidth;
+    positions_.resize(blockCount, LaneVec2f{ defaultPos });
+    velocities_.resize(blockCount, LaneVec2f{ defaultVel });
+    accelerations_.resize(blockCount, LaneVec2f{ Vec2f::zero() });
+    for (std::size_t block = 0; block < blockCount; block++)
+    {
+        const auto count = static_cast<int>(std::min<std::size_t>(planetCount - block * laneWidth, laneWidth));
+        LaneVec2f positions, velocities;
+        GenerateOrbits<laneWidth>(rng, block * laneWidth, positions, velocities);
+        positions_[block] = SimdBackend::Pack<laneWidth>(positions.Xs().data(), positions.Ys().data(), count, defaultPos);
+        velocities_[block] = SimdBackend::Pack<laneWidth>(velocities.Xs().data(), velocities.Ys().data(), count, defaultVel);
+    }
+
+    cellSize_ = meshExtent / static_cast<float>(gridSize_);
+    gridCorner_ = worldCenter - Vec2f::one() * (meshExtent * 0.5f);
+    const auto paddedSize = 2 * gridSize_;
+    mesh_.resize(paddedSize * paddedSize);
+
+    //Force of a unit mass at node offset (dx, dy) wrapped around the padded mesh, the spectrum is scaled for the inverse FFT
+    kernel_.resize(paddedSize * paddedSize);
+    const auto sqrSoftening = gravitySoftening * gravitySoftening;
+    const auto halfExtent = static_cast<std::ptrdiff_t>(gridSize_) - 1;
+    for (auto dy = -halfExtent; dy <= halfExtent; dy++)
+    {
+        for (auto dx = -halfExtent; dx <= halfExtent; dx++)
+        {
+            if (dx == 0 && dy == 0)
+            {
+                continue;
+            }
+            //The source sits at -(dx, dy) from the node
+            const auto delta = Vec2f{ static_cast<float>(-dx), static_cast<float>(-dy) } * cellSize_;
+            const auto sqrDistance = delta.SquareMagnitude() + sqrSoftening;
+            const auto force = delta * (G / (sqrDistance * std::sqrt(sqrDistance)));
+            const auto row = static_cast<std::size_t>((dy + static_cast<std::ptrdiff_t>(paddedSize))) % paddedSize;
+            const auto column = static_cast<std::size_t>((dx + static_cast<std::ptrdiff_t>(paddedSize))) % paddedSize;
+            kernel_[row * paddedSize + column] = { force.x, force.y };
+        }
+    }
+    for (std::size_t row = 0; row < paddedSize; row++)
+    {
+        fft_.Forward(kernel_.data() + row * paddedSize);
+    }
+    //Transposed, so the column transforms run on contiguous rows
+    const auto scale = 1.0f / static_cast<float>(paddedSize * paddedSize);
+    std::vector<std::complex<float>> transposed(kernel_.size());
+    for (std::size_t row = 0; row < paddedSize; row++)
+    {
+        for (std::size_t column = 0; column < paddedSize; column++)
+        {
+            transposed[column * paddedSize + row] = kernel_[row * paddedSize + column] * scale;
+        }
+    }
+    kernel_.swap(transposed);
+    for (std::size_t column = 0; column < paddedSize; column++)
+    {
+        fft_.Forward(kernel_.data() + column * paddedSize);
+    }
+}
+
+void ParticleMeshSystem::Update(float dt) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    ComputeMutualAccelerations();
+    ParallelFor(threadPool_, 0, positions_.size(), blockChunkSize, [this, dt](std::size_t begin, std::size_t end)
+    {
+        const LaneVec2f laneWorldCenter{ worldCenter };
+        const LaneFloat laneDt{ dt };
+        for (auto i = begin; i < end; i++)
+        {
+            //Calculate new velocity
+            const auto delta = positions_[i] - laneWorldCenter;
+            const auto accelerationValue = CalculateAcceleration(delta.SquareMagnitude());
+            const auto acceleration = (-delta).Normalized() * accelerationValue + accelerations_[i];
+            velocities_[i] += acceleration * laneDt;
+            //Calculate new position
+            positions_[i] += velocities_[i] * laneDt;
+        }
+    });
+}
+
+Vec2f ParticleMeshSystem::GetPosition(int index) const
+{
+    return { positions_[index / laneWidth].Xs()[index % laneWidth], positions_[index / laneWidth].Ys()[index % laneWidth] };
+}
+
+Vec2f ParticleMeshSystem::GetMutualAcceleration(int index) const
+{
+    return { accelerations_[index / laneWidth].Xs()[index % laneWidth], accelerations_[index / laneWidth].Ys()[index % laneWidth] };
+}
+
+void ParticleMeshSystem::ComputeMutualAccelerations() noexcept
+{
+    Deposit();
+    SolveField();
+    Interpolate();
+}
+
+void ParticleMeshSystem::Deposit() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    //Each slice scatters its blocks in a private grid, the grids are summed row by row into the mesh
+    const auto sliceCount = threadPool_ != nullptr ? threadPool_->GetThreadCount() : std::size_t{ 1 };
+    sliceDensities_.resize(sliceCount);
+    ParallelFor(threadPool_, 0, sliceCount, 1, [this, sliceCount](std::size_t begin, std::size_t end)
+    {
+        const LaneVec2f laneCorner{ gridCorner_ };
+        const LaneFloat inverseCellSize{ 1.0f / cellSize_ };
+        const auto lastNode = static_cast<float>(gridSize_ - 1);
+        for (auto slice = begin; slice < end; slice++)
+        {
+            auto& density = sliceDensities_[slice];
+            density.assign(gridSize_ * gridSize_, 0.0f);
+            const auto blockBegin = positions_.size() * slice / sliceCount;
+            const auto blockEnd = positions_.size() * (slice + 1) / sliceCount;
+            for (auto block = blockBegin; block < blockEnd; block++)
+            {
+                const auto nodes = (positions_[block] - laneCorner) * inverseCellSize;
+                const auto count = static_cast<int>(std::min<std::size_t>(planetCount_ - block * laneWidth, laneWidth));
+                for (int lane = 0; lane < count; lane++)
+                {
+                    const auto nodeX = std::floor(nodes.Xs()[lane]);
+                    const auto nodeY = std::floor(nodes.Ys()[lane]);
+                    if (!(nodeX >= 0.0f && nodeY >= 0.0f && nodeX < lastNode && nodeY < lastNode))
+                    {
+                        continue;
+                    }
+                    const auto fx = nodes.Xs()[lane] - nodeX;
+                    const auto fy = nodes.Ys()[lane] - nodeY;
+                    const auto node = static_cast<std::size_t>(nodeY) * gridSize_ + static_cast<std::size_t>(nodeX);
+                    density[node] += (1.0f - fx) * (1.0f - fy) * planetMass;
+                    density[node + 1] += fx * (1.0f - fy) * planetMass;
+                    density[node + gridSize_] += (1.0f - fx) * fy * planetMass;
+                    density[node + gridSize_ + 1] += fx * fy * planetMass;
+                }
+            }
+        }
+    });
+    const auto paddedSize = 2 * gridSize_;
+    ParallelFor(threadPool_, 0, paddedSize, rowChunkSize, [this, paddedSize](std::size_t begin, std::size_t end)
+    {
+        for (auto row = begin; row < end; row++)
+        {
+            auto* meshRow = mesh_.data() + row * paddedSize;
+            std::fill_n(meshRow, paddedSize, std::complex<float>{});
+            if (row >= gridSize_)
+            {
+                continue;
+            }
+            for (const auto& density : sliceDensities_)
+            {
+                for (std::size_t column = 0; column < gridSize_; column++)
+                {
+                    meshRow[column] += density[row * gridSize_ + column];
+                }
+            }
+        }
+    });
+}
+
+void ParticleMeshSystem::SolveField() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    //Only the first gridSize rows hold mass and only they are read back, the other rows skip their row transform
+    const auto paddedSize = 2 * gridSize_;
+    ParallelFor(threadPool_, 0, gridSize_, rowChunkSize, [this, paddedSize](std::size_t begin, std::size_t end)
+    {
+        for (auto row = begin; row < end; row++)
+        {
+            fft_.Forward(mesh_.data() + row * paddedSize);
+        }
+    });
+    //Columns go through a scratch panel a few columns wide, so the copies read whole cache lines
+    ParallelFor(threadPool_, 0, paddedSize, rowChunkSize, [this, paddedSize](std::size_t begin, std::size_t end)
+    {
+        std::vector<std::complex<float>> panel((end - begin) * paddedSize);
+        for (std::size_t row = 0; row < paddedSize; row++)
+        {
+            for (auto column = begin; column < end; column++)
+            {
+                panel[(column - begin) * paddedSize + row] = mesh_[row * paddedSize + column];
+            }
+        }
+        for (auto column = begin; column < end; column++)
+        {
+            auto* panelColumn = panel.data() + (column - begin) * paddedSize;
+            const auto* kernelColumn = kernel_.data() + column * paddedSize;
+            fft_.Forward(panelColumn);
+            for (std::size_t row = 0; row < paddedSize; row++)
+            {
+                panelColumn[row] *= kernelColumn[row];
+            }
+            fft_.Inverse(panelColumn);
+        }
+        //Only the first gridSize rows are read back
+        for (std::size_t row = 0; row < gridSize_; row++)
+        {
+            for (auto column = begin; column < end; column++)
+            {
+                mesh_[row * paddedSize + column] = panel[(column - begin) * paddedSize + row];
+            }
+        }
+    });
+    ParallelFor(threadPool_, 0, gridSize_, rowChunkSize, [this, paddedSize](std::size_t begin, std::size_t end)
+    {
+        for (auto row = begin; row < end; row++)
+        {
+            fft_.Inverse(mesh_.data() + row * paddedSize);
+        }
+    });
+}
+
+void ParticleMeshSystem::Interpolate() noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    const auto paddedSize = 2 * gridSize_;
+    ParallelFor(threadPool_, 0, positions_.size(), blockChunkSize, [this, paddedSize](std::size_t begin, std::size_t end)
+    {
+        const LaneVec2f laneCorner{ gridCorner_ };
+        const LaneFloat inverseCellSize{ 1.0f / cellSize_ };
+        const LaneFloat one{ 1.0f };
+        const auto lastNode = static_cast<float>(gridSize_ - 1);
+        //Field at the four surrounding nodes, gathered lane by lane then weighted on the whole block
+        std::array<std::array<float, laneWidth>, 4> fieldXs{}, fieldYs{};
+        std::array<float, laneWidth> nodeXs{}, nodeYs{};
+        for (auto block = begin; block < end; block++)
+        {
+            const auto nodes = (positions_[block] - laneCorner) * inverseCellSize;
+            for (int lane = 0; lane < laneWidth; lane++)
+            {
+                nodeXs[lane] = std::floor(nodes.Xs()[lane]);
+                nodeYs[lane] = std::floor(nodes.Ys()[lane]);
+                const auto inside = nodeXs[lane] >= 0.0f && nodeYs[lane] >= 0.0f && nodeXs[lane] < lastNode && nodeYs[lane] < lastNode;
+                const auto node = inside ? static_cast<std::size_t>(nodeYs[lane]) * paddedSize + static_cast<std::size_t>(nodeXs[lane]) : 0;
+                const std::array<std::size_t, 4> corners{ node, node + 1, node + paddedSize, node + paddedSize + 1 };
+                for (int corner = 0; corner < 4; corner++)
+                {
+                    const auto field = inside ? mesh_[corners[corner]] : std::complex<float>{};
+                    fieldXs[corner][lane] = field.real();
+                    fieldYs[corner][lane] = field.imag();
+                }
+            }
+            const auto fx = LaneFloat{ nodes.Xs().data() } - LaneFloat{ nodeXs.data() };
+            const auto fy = LaneFloat{ nodes.Ys().data() } - LaneFloat{ nodeYs.data() };
+            const std::array<LaneFloat, 4> weights{ (one - fx) * (one - fy), fx * (one - fy), (one - fx) * fy, fx * fy };
+            LaneFloat ax{ 0.0f }, ay{ 0.0f };
+            for (int corner = 0; corner < 4; corner++)
+            {
+                ax = ax + weights[corner] * LaneFloat{ fieldXs[corner].data() };
+                ay = ay + weights[corner] * LaneFloat{ fieldYs[corner].data() };
+            }
+            accelerations_[block] = LaneVec2f{ ax, ay };
+        }
+    });
+}
+
+}
+}
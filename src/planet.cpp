@@ -1,7 +1,12 @@
 #include "planet.h"
+#include "dispatch.h"
+#include "thread_pool.h"
 
-#include <numbers>
-#include <random>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <utility>
 
 #ifdef TRACY_ENABLE
 #include <tracy/Tracy.hpp>
@@ -9,202 +14,669 @@
 
 namespace planets
 {
+inline namespace PLANETS_ISA
+{
+
+//Blocks of positions and velocities handed to a worker at once, sized to stay in L1
+constexpr std::size_t updateChunkBytes = 32 * 1024;
+//A multiple of Unroll, so every chunk holds whole groups
+template<typename Vec, int Unroll>
+constexpr std::size_t updateChunkSize = std::max<std::size_t>(updateChunkBytes / (sizeof(Vec) * 2) / Unroll, 1) * Unroll;
+
+//Yoshida's fourth order composition of leapfrog, drift weights c and kick weights d.
+//In double so the double backend gets them to its own precision.
+constexpr double yoshidaW1 = 1.3512071919596578;
+constexpr double yoshidaW0 = -1.7024143839193153;
+constexpr std::array<double, 4> yoshidaDrifts{ yoshidaW1 / 2.0, (yoshidaW0 + yoshidaW1) / 2.0, (yoshidaW0 + yoshidaW1) / 2.0, yoshidaW1 / 2.0 };
+constexpr std::array<double, 3> yoshidaKicks{ yoshidaW1, yoshidaW0, yoshidaW1 };
+
+namespace
+{
+//x and y of one lane, without the rounding to float of Backend::GetLane
+std::array<double, 2> GetLaneDouble(const Vec2f& v, int) noexcept
+{
+    return { v.x, v.y };
+}
 
-constexpr auto pi = std::numbers::pi_v<float>;
+template<typename T, int N>
+std::array<double, 2> GetLaneDouble(const NVec2<T, N>& v, int lane) noexcept
+{
+    return { v.Xs()[lane], v.Ys()[lane] };
+}
 
-PlanetSystem::PlanetSystem(std::size_t planetCount) noexcept
+//Pull of an attractor of gm = G * mass at center on the lanes of position, gm (center - position) / |center - position|^3
+template<GravityAccuracy Accuracy, typename Vec, typename Float>
+inline Vec CalculatePull(const Vec& position, const Vec& center, const Float& gm) noexcept
 {
-    planets_.reserve(planetCount);
-    std::random_device rd;  // Will be used to obtain a seed for the random number engine
-    std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-    std::uniform_real_distribution<float> disRadius(innerRadius, outerRaidus);
-    std::uniform_real_distribution<float> disAngle(0, pi);
+    const auto delta = center - position;
+    return delta * (gm * InverseCube<Accuracy>(delta.SquareMagnitude()));
+}
 
-    for(std::size_t i = 0; i < planetCount; i++)
+//x of planet index in blocks of Width xs then Width ys, its y is Width lanes further
+template<int Width, typename Scalar>
+Scalar* GetLaneX(Scalar* blocks, std::size_t index) noexcept
+{
+    return blocks + index / Width * 2 * Width + index % Width;
+}
+}
+
+template<int Width, typename Backend, int Unroll>
+BasicPlanetSystem<Width, Backend, Unroll>::BasicPlanetSystem(std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed) noexcept :
+    threadPool_(threadPool), planetCount_(planetCount), seed_(seed)
+{
+    static_assert(sizeof(Vec) == 2 * Width * sizeof(typename Backend::Scalar), "PositionView reads the blocks as Width xs then Width ys");
+    const auto blockCount = ((planetCount + Width - 1) / Width + Unroll - 1) / Unroll * Unroll;
+    positions_.resize(blockCount, Vec{ defaultPos });
+    velocities_.resize(blockCount, Vec{ defaultVel });
+    //Generated straight into the blocks, the tail block gets the default lanes past planetCount
+    const CounterRng rng(seed);
+    ParallelFor(threadPool_, 0, (planetCount + Width - 1) / Width, updateChunkSize<Vec, Unroll>, [&](std::size_t begin, std::size_t end)
     {
-        const auto radius = disRadius(gen);
-        const auto angle = disAngle(gen);
+        for (auto i = begin; i < end; i++)
+        {
+            NVec2f<Width> positions, velocities;
+            GenerateOrbits<Width>(rng, i * Width, positions, velocities);
+            const auto count = static_cast<int>(std::min<std::size_t>(planetCount - i * Width, Width));
+            positions_[i] = Backend::template Pack<Width>(positions.Xs().data(), positions.Ys().data(), count, defaultPos);
+            velocities_[i] = Backend::template Pack<Width>(velocities.Xs().data(), velocities.Ys().data(), count, defaultVel);
+        }
+    });
+}
 
-        Planet planet;
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::Update(float dt, int steps) noexcept
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    time_ += static_cast<double>(dt) * steps;
+    //Standing attractors pull from laneAttractors_ on every step, moving ones are sampled once per step when the step
+    //kicks: at its middle, or at its end for velocity Verlet, whose closing kick is the opening kick of the next step
+    if (attractorsMove_)
+    {
+        const auto sampleTime = integrator_ == Integrator::VelocityVerlet ? 1.0f : 0.5f;
+        stepAttractors_.clear();
+        for (int step = 0; step < steps; step++)
+        {
+            for (std::size_t i = 0; i < attractors_.size(); i++)
+            {
+                const auto& attractor = attractors_[i];
+                const auto position = attractor.position + attractor.velocity * (dt * (static_cast<float>(step) + sampleTime));
+                stepAttractors_.push_back({ Vec{ Vec2f{ position.x, position.y } }, laneAttractors_[i].gm });
+            }
+        }
+    }
+    if (integrator_ == Integrator::VelocityVerlet && accelerations_.empty())
+    {
+        accelerations_.resize(positions_.size());
+        ParallelFor(threadPool_, 0, positions_.size(), updateChunkBytes / sizeof(Vec), [this](std::size_t begin, std::size_t end)
+        {
+            ComputeAccelerations(begin, end);
+        });
+    }
+    ParallelFor(threadPool_, 0, velocities_.size(), updateChunkSize<Vec, Unroll>, [this, dt, steps](std::size_t begin, std::size_t end)
+    {
+        UpdateBlocks(dt, steps, begin, end);
+    });
+    if (attractorsMove_)
+    {
+        for (std::size_t i = 0; i < attractors_.size(); i++)
+        {
+            auto& attractor = attractors_[i];
+            attractor.position += attractor.velocity * (dt * static_cast<float>(steps));
+            laneAttractors_[i].position = Vec{ Vec2f{ attractor.position.x, attractor.position.y } };
+        }
+    }
+    if (collisionRadius_ > 0.0f)
+    {
+        MergeCollisions();
+    }
+}
 
-        const auto v = Vec2f::up().Rotate(angle) * radius;
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::UpdateBlocks(float dt, int steps, std::size_t begin, std::size_t end) noexcept
+{
+    //Each L1 sized chunk takes all its steps before the next is loaded, planets do not interact.
+    //Stepping whole chunks rather than one group at a time keeps the groups independent chains the cpu can overlap.
+    for (auto chunkBegin = begin; chunkBegin < end; chunkBegin += updateChunkSize<Vec, Unroll>)
+    {
+        const auto chunkEnd = std::min(chunkBegin + updateChunkSize<Vec, Unroll>, end);
+        for (int step = 0; step < steps; step++)
+        {
+            const auto stepBlocks = [&]<std::size_t AttractorCount>(std::span<const LaneAttractor, AttractorCount> attractors)
+            {
+                switch (integrator_)
+                {
+                case Integrator::Euler: StepBlocks<Integrator::Euler>(dt, attractors, chunkBegin, chunkEnd); break;
+                case Integrator::Leapfrog: StepBlocks<Integrator::Leapfrog>(dt, attractors, chunkBegin, chunkEnd); break;
+                case Integrator::VelocityVerlet: StepBlocks<Integrator::VelocityVerlet>(dt, attractors, chunkBegin, chunkEnd); break;
+                case Integrator::Yoshida4: StepBlocks<Integrator::Yoshida4>(dt, attractors, chunkBegin, chunkEnd); break;
+                }
+            };
+            const auto attractors = attractorsMove_ ?
+                std::span<const LaneAttractor>(stepAttractors_).subspan(step * laneAttractors_.size(), laneAttractors_.size()) :
+                std::span<const LaneAttractor>(laneAttractors_);
+            //The single star of the default scenario gets kernels without a loop over the attractors
+            if (attractors.size() == 1)
+            {
+                stepBlocks(attractors.template first<1>());
+            }
+            else
+            {
+                stepBlocks(attractors);
+            }
+        }
+    }
+}
 
-        planet.position = v + worldCenter;
-        planet.velocity = (planet.position-worldCenter).Perpendicular().Normalized() * std::sqrt(CalculateAcceleration(radius) * radius);
-        planets_.push_back(planet);
+template<int Width, typename Backend, int Unroll>
+template<Integrator I, std::size_t AttractorCount>
+void BasicPlanetSystem<Width, Backend, Unroll>::StepBlocks(float dt, std::span<const LaneAttractor, AttractorCount> attractors,
+    std::size_t begin, std::size_t end) noexcept
+{
+    const Float laneDt{ dt };
+    for (std::size_t i = begin; i < end; i += Unroll)
+    {
+        //Expanded at compile time, every block of the group is an independent chain the cpu can overlap
+        [&]<std::size_t... U>(std::index_sequence<U...>)
+        {
+            std::array<Vec, Unroll> positions{ positions_[i + U]... };
+            std::array<Vec, Unroll> velocities{ velocities_[i + U]... };
+            //The symplectic schemes use the exact inverse cube, the rsqrt estimate of Normalized would cap their accuracy
+            using Scalar = typename Backend::Scalar;
+            const auto drift = [&](double weight)
+            {
+                const Float laneStep{ static_cast<Scalar>(weight) * static_cast<Scalar>(dt) };
+                ((positions[U] += velocities[U] * laneStep), ...);
+            };
+            //Every attractor is loaded once for the whole group, whose blocks stay independent chains
+            const auto attract = [&]<GravityAccuracy Accuracy = GravityAccuracy::Exact>()
+            {
+                std::array<Vec, Unroll> accelerations{};
+                for (const auto& attractor : attractors)
+                {
+                    ((accelerations[U] += CalculatePull<Accuracy>(positions[U], attractor.position, attractor.gm)), ...);
+                }
+                return accelerations;
+            };
+            const auto kick = [&](double weight)
+            {
+                const Float laneStep{ static_cast<Scalar>(weight) * static_cast<Scalar>(dt) };
+                const auto accelerations = attract();
+                ((velocities[U] += accelerations[U] * laneStep), ...);
+            };
+            if constexpr (I == Integrator::Euler)
+            {
+                //Calculate new velocity, first order already dominates the error of one Newton-Raphson iteration.
+                //Plain floats keep the exact form, the compiler pairs x and y in one register only without the rsqrt intrinsic.
+                constexpr auto accuracy = std::is_same_v<Backend, ScalarBackend> ? GravityAccuracy::Exact : GravityAccuracy::Refined;
+                const auto accelerations = attract.template operator()<accuracy>();
+                ((velocities[U] += accelerations[U] * laneDt), ...);
+                //Calculate new position
+                ((positions[U] += velocities[U] * laneDt), ...);
+            }
+            else if constexpr (I == Integrator::Leapfrog)
+            {
+                drift(0.5f);
+                kick(1.0f);
+                drift(0.5f);
+            }
+            else if constexpr (I == Integrator::VelocityVerlet)
+            {
+                const Float laneHalfDt{ 0.5f * dt };
+                std::array<Vec, Unroll> accelerations{ accelerations_[i + U]... };
+                ((velocities[U] += accelerations[U] * laneHalfDt), ...);
+                drift(1.0f);
+                accelerations = attract();
+                ((velocities[U] += accelerations[U] * laneHalfDt), ...);
+                ((accelerations_[i + U] = accelerations[U]), ...);
+            }
+            else
+            {
+                drift(yoshidaDrifts[0]);
+                kick(yoshidaKicks[0]);
+                drift(yoshidaDrifts[1]);
+                kick(yoshidaKicks[1]);
+                drift(yoshidaDrifts[2]);
+                kick(yoshidaKicks[2]);
+                drift(yoshidaDrifts[3]);
+            }
+            ((positions_[i + U] = positions[U]), ...);
+            ((velocities_[i + U] = velocities[U]), ...);
+        }(std::make_index_sequence<Unroll>{});
+    }
+}
 
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::ComputeAccelerations(std::size_t begin, std::size_t end) noexcept
+{
+    for (auto i = begin; i < end; i++)
+    {
+        Vec acceleration{};
+        for (const auto& attractor : laneAttractors_)
+        {
+            acceleration += CalculatePull<GravityAccuracy::Exact>(positions_[i], attractor.position, attractor.gm);
+        }
+        accelerations_[i] = acceleration;
     }
 }
 
-void PlanetSystem::Update(float dt) noexcept
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::MergeCollisions()
 {
 #ifdef TRACY_ENABLE
     ZoneScoped;
 #endif
-    for (auto& planet : planets_)
+    if (collisionGrid_.FindNearest(GetPositions(), 2.0f * collisionRadius_, threadPool_) == 0)
+    {
+        return;
+    }
+    //Union find over the nearest neighbor links, every cluster is rooted at its lowest index
+    const auto nearest = collisionGrid_.GetNearest();
+    std::vector<std::uint32_t> roots(planetCount_);
+    std::iota(roots.begin(), roots.end(), 0u);
+    const auto find = [&roots](std::uint32_t i)
+    {
+        while (roots[i] != i)
+        {
+            roots[i] = roots[roots[i]];
+            i = roots[i];
+        }
+        return i;
+    };
+    for (std::uint32_t i = 0; i < planetCount_; i++)
     {
-        //Calculate new velocity
-        const auto delta = (planet.position - worldCenter);
-        const auto sqrRadius = delta.SquareMagnitude();
-        const auto accelerationValue = CalculateAcceleration(sqrRadius);
-        const auto acceleration = -delta.Normalized()*accelerationValue;
-        planet.velocity += acceleration * dt;
-        //Calculate new position
-        planet.position += planet.velocity * dt;
+        if (nearest[i] >= 0)
+        {
+            const auto a = find(i);
+            const auto b = find(static_cast<std::uint32_t>(nearest[i]));
+            roots[std::max(a, b)] = std::min(a, b);
+        }
     }
+
+    //Mass weighted sums of each cluster, in double so large clusters do not lose their small members
+    struct Cluster
+    {
+        std::uint32_t root;
+        double mass, x, y, vx, vy;
+    };
+    using Scalar = typename Backend::Scalar;
+    auto* positions = reinterpret_cast<Scalar*>(positions_.data());
+    auto* velocities = reinterpret_cast<Scalar*>(velocities_.data());
+    if (masses_.empty())
+    {
+        masses_.assign(planetCount_, planetMass);
+    }
+    const auto add = [&](Cluster& cluster, std::uint32_t i)
+    {
+        const double mass = masses_[i];
+        const auto* position = GetLaneX<Width>(positions, i);
+        const auto* velocity = GetLaneX<Width>(velocities, i);
+        cluster.mass += mass;
+        cluster.x += mass * position[0];
+        cluster.y += mass * position[Width];
+        cluster.vx += mass * velocity[0];
+        cluster.vy += mass * velocity[Width];
+    };
+    std::vector<Cluster> clusters;
+    std::vector<std::int32_t> clusterOfRoot(planetCount_, -1);
+    std::vector<std::uint32_t> merged;
+    //Ascending, so a root is still untouched when its first member comes
+    for (std::uint32_t i = 0; i < planetCount_; i++)
+    {
+        const auto root = find(i);
+        if (root == i)
+        {
+            continue;
+        }
+        if (clusterOfRoot[root] < 0)
+        {
+            clusterOfRoot[root] = static_cast<std::int32_t>(clusters.size());
+            add(clusters.emplace_back(Cluster{ root, 0.0, 0.0, 0.0, 0.0, 0.0 }), root);
+        }
+        add(clusters[clusterOfRoot[root]], i);
+        merged.push_back(i);
+    }
+    for (const auto& cluster : clusters)
+    {
+        auto* position = GetLaneX<Width>(positions, cluster.root);
+        auto* velocity = GetLaneX<Width>(velocities, cluster.root);
+        position[0] = static_cast<Scalar>(cluster.x / cluster.mass);
+        position[Width] = static_cast<Scalar>(cluster.y / cluster.mass);
+        velocity[0] = static_cast<Scalar>(cluster.vx / cluster.mass);
+        velocity[Width] = static_cast<Scalar>(cluster.vy / cluster.mass);
+        masses_[cluster.root] = static_cast<float>(cluster.mass);
+    }
+
+    //From the back, so the last planet moved into a hole is never one still to be removed
+    for (auto i = merged.rbegin(); i != merged.rend(); ++i)
+    {
+        const auto last = planetCount_ - 1;
+        if (*i != last)
+        {
+            for (auto* blocks : { positions, velocities })
+            {
+                GetLaneX<Width>(blocks, *i)[0] = GetLaneX<Width>(blocks, last)[0];
+                GetLaneX<Width>(blocks, *i)[Width] = GetLaneX<Width>(blocks, last)[Width];
+            }
+            masses_[*i] = masses_[last];
+        }
+        planetCount_--;
+    }
+    masses_.resize(planetCount_);
+    const auto blockCount = ((planetCount_ + Width - 1) / Width + Unroll - 1) / Unroll * Unroll;
+    positions_.resize(blockCount, Vec{ defaultPos });
+    velocities_.resize(blockCount, Vec{ defaultVel });
+    positions = reinterpret_cast<Scalar*>(positions_.data());
+    velocities = reinterpret_cast<Scalar*>(velocities_.data());
+    for (auto i = planetCount_; i < blockCount * Width; i++)
+    {
+        GetLaneX<Width>(positions, i)[0] = defaultPos.x;
+        GetLaneX<Width>(positions, i)[Width] = defaultPos.y;
+        GetLaneX<Width>(velocities, i)[0] = defaultVel.x;
+        GetLaneX<Width>(velocities, i)[Width] = defaultVel.y;
+    }
+    //Recomputed by the next Update for the merged positions
+    accelerations_.clear();
 }
 
-Vec2f PlanetSystem::GetPosition(int index) const
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::SetIntegrator(Integrator integrator) noexcept
 {
-    return planets_[index].position;
+    integrator_ = integrator;
+    //Recomputed by the next Update, the positions may have moved since
+    accelerations_.clear();
 }
 
-PlanetSystem4::PlanetSystem4(std::size_t planetCount) noexcept
+template<int Width, typename Backend, int Unroll>
+Vec2f BasicPlanetSystem<Width, Backend, Unroll>::GetPosition(int index) const
 {
-    std::random_device rd;  // Will be used to obtain a seed for the random number engine
-    std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-    std::uniform_real_distribution<float> disRadius(innerRadius, outerRaidus);
-    std::uniform_real_distribution<float> disAngle(0, pi);
-    std::vector<Planet> planets;
-    planets.reserve(planetCount);
-    for (std::size_t i = 0; i < planetCount; i++)
-    {
-        const auto radius = disRadius(gen);
-        const auto angle = disAngle(gen);
+    return Backend::GetLane(positions_[index / Width], index % Width);
+}
 
-        Planet planet;
+template<int Width, typename Backend, int Unroll>
+Vec2f BasicPlanetSystem<Width, Backend, Unroll>::GetVelocity(int index) const
+{
+    return Backend::GetLane(velocities_[index / Width], index % Width);
+}
 
-        const auto v = Vec2f::up().Rotate(angle) * radius;
+template<int Width, typename Backend, int Unroll>
+float BasicPlanetSystem<Width, Backend, Unroll>::GetMass(int index) const
+{
+    return masses_.empty() ? planetMass : masses_[index];
+}
 
-        planet.position = v + worldCenter;
-        planet.velocity = (planet.position - worldCenter).Perpendicular().Normalized() * std::sqrt(CalculateAcceleration(radius) * radius);
-        planets.push_back(planet);
+template<int Width, typename Backend, int Unroll>
+double BasicPlanetSystem<Width, Backend, Unroll>::GetEnergy() const noexcept
+{
+    //From the lanes themselves, converted to floats they would hide the drift of the double backend
+    double energy = 0.0;
+    for (std::size_t i = 0; i < planetCount_; i++)
+    {
+        const auto lane = static_cast<int>(i % Width);
+        const auto [x, y] = GetLaneDouble(positions_[i / Width], lane);
+        const auto [vx, vy] = GetLaneDouble(velocities_[i / Width], lane);
+        energy += 0.5 * (vx * vx + vy * vy);
+        for (const auto& attractor : attractors_)
+        {
+            const auto dx = x - attractor.position.x;
+            const auto dy = y - attractor.position.y;
+            energy -= G * attractor.mass / std::sqrt(dx * dx + dy * dy);
+        }
+    }
+    return energy;
+}
 
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::SetAttractors(std::span<const Attractor> attractors)
+{
+    attractors_.assign(attractors.begin(), attractors.end());
+    laneAttractors_.clear();
+    attractorsMove_ = false;
+    for (const auto& attractor : attractors_)
+    {
+        laneAttractors_.push_back({ Vec{ Vec2f{ attractor.position.x, attractor.position.y } }, Float{ G * attractor.mass } });
+        attractorsMove_ |= attractor.velocity != sf::Vector2f{};
     }
-    positions_.resize(planetCount / 4 + 1);
-    velocities_.resize(planetCount / 4 + 1);
-    for(std::size_t i = 0; i < planetCount/4+1; i++)
+    //Recomputed by the next Update for the new attractors
+    accelerations_.clear();
+}
+
+template<int Width, typename Backend, int Unroll>
+PositionView BasicPlanetSystem<Width, Backend, Unroll>::GetPositions() const noexcept
+{
+    if constexpr (std::is_same_v<typename Backend::Scalar, float>)
     {
-        const std::array<Vec2f, 4> posTmp = {
-            {
-                i*4<planetCount?planets[i * 4].position:defaultPos,
-                i*4+1<planetCount?planets[i * 4 + 1].position : defaultPos,
-                i*4+2<planetCount?planets[i * 4 + 2].position : defaultPos,
-                i*4+3<planetCount?planets[i * 4 + 3].position : defaultPos
-            } };
-        positions_[i] = FourVec2f{ posTmp };
-        const std::array<Vec2f, 4> velTmp = {
+        return { reinterpret_cast<const float*>(positions_.data()), planetCount_, Width };
+    }
+    else
     {
-        i * 4 < planetCount ? planets[i * 4].velocity : defaultVel,
-        i * 4 + 1 < planetCount ? planets[i * 4 + 1].velocity : defaultVel,
-        i * 4 + 2 < planetCount ? planets[i * 4 + 2].velocity : defaultVel,
-        i * 4 + 3 < planetCount ? planets[i * 4 + 3].velocity : defaultVel
-    } };
-        velocities_[i] = FourVec2f{ velTmp };
+        //Same layout as the float blocks, Width xs then Width ys
+        const auto* lanes = reinterpret_cast<const typename Backend::Scalar*>(positions_.data());
+        floatPositions_.resize(positions_.size() * 2 * Width);
+        std::transform(lanes, lanes + floatPositions_.size(), floatPositions_.begin(), [](auto value)
+        {
+            return static_cast<float>(value);
+        });
+        return { floatPositions_.data(), planetCount_, Width };
     }
 }
 
-void PlanetSystem4::Update(float dt) noexcept
+template<int Width, typename Backend, int Unroll>
+void BasicPlanetSystem<Width, Backend, Unroll>::WritePositions(std::span<sf::Vector2f> positions, float scale) const noexcept
 {
 #ifdef TRACY_ENABLE
     ZoneScoped;
 #endif
-    for (std::size_t i = 0; i < velocities_.size(); i++)
+    const auto blockCount = (planetCount_ + Width - 1) / Width;
+    ParallelFor(threadPool_, 0, blockCount, updateChunkBytes / sizeof(Vec), [this, positions, scale](std::size_t begin, std::size_t end)
+    {
+        const Float laneScale{ scale };
+        for (auto block = begin; block < end; block++)
+        {
+            const auto scaled = positions_[block] * laneScale;
+            const auto count = std::min<std::size_t>(planetCount_ - block * Width, Width);
+            for (std::size_t lane = 0; lane < count; lane++)
+            {
+                positions[block * Width + lane] = static_cast<sf::Vector2f>(Backend::GetLane(scaled, static_cast<int>(lane)));
+            }
+        }
+    });
+}
+
+template<int Width, typename Backend, int Unroll>
+bool BasicPlanetSystem<Width, Backend, Unroll>::SaveCheckpoint(const std::filesystem::path& path) const
+{
+    CheckpointHeader header;
+    header.width = Width;
+    header.scalarSize = sizeof(typename Backend::Scalar);
+    header.integrator = static_cast<std::uint32_t>(integrator_);
+    header.planetCount = planetCount_;
+    header.blockCount = positions_.size();
+    header.seed = seed_;
+    header.time = time_;
+    header.collisionRadius = collisionRadius_;
+    std::vector<float> attractors;
+    for (const auto& attractor : attractors_)
     {
-        //Calculate new velocity
-        const auto fourWorldCenter = FourVec2f{ worldCenter };
-        const auto sqrRadius = (positions_[i] - fourWorldCenter).SquareMagnitude();
-        const auto accelerationValue = CalculateAcceleration(sqrRadius);
-        const auto acceleration = (fourWorldCenter - positions_[i]).Normalized() * accelerationValue;
-        const auto fourDt = FourFloat{dt};
-        velocities_[i] += acceleration * fourDt;
-        //Calculate new position
-        positions_ [i] += velocities_[i] * fourDt;
+        attractors.insert(attractors.end(), { attractor.position.x, attractor.position.y, attractor.velocity.x, attractor.velocity.y, attractor.mass });
     }
+    return WriteCheckpoint(path, header, positions_.GetBytes(), velocities_.GetBytes(), attractors, masses_);
 }
 
-Vec2f PlanetSystem4::GetPosition(int index) const
+template<int Width, typename Backend, int Unroll>
+std::optional<BasicPlanetSystem<Width, Backend, Unroll>> BasicPlanetSystem<Width, Backend, Unroll>::LoadCheckpoint(
+    const std::filesystem::path& path, ThreadPool* threadPool)
 {
-    return { positions_[index / 4].Xs()[index % 4], positions_[index / 4].Ys()[index % 4] };
+    auto checkpoint = OpenCheckpoint(path);
+    if (!checkpoint)
+    {
+        return std::nullopt;
+    }
+    return LoadCheckpoint(std::move(*checkpoint), threadPool);
+}
+
+template<int Width, typename Backend, int Unroll>
+std::optional<BasicPlanetSystem<Width, Backend, Unroll>> BasicPlanetSystem<Width, Backend, Unroll>::LoadCheckpoint(
+    Checkpoint checkpoint, ThreadPool* threadPool)
+{
+    const auto& header = checkpoint.header;
+    if (header.width != Width || header.scalarSize != sizeof(typename Backend::Scalar)
+        || header.integrator > static_cast<std::uint32_t>(Integrator::Yoshida4))
+    {
+        return std::nullopt;
+    }
+    BasicPlanetSystem planetSystem;
+    planetSystem.threadPool_ = threadPool;
+    planetSystem.planetCount_ = header.planetCount;
+    planetSystem.integrator_ = static_cast<Integrator>(header.integrator);
+    planetSystem.time_ = header.time;
+    planetSystem.seed_ = header.seed;
+    planetSystem.positions_ = BlockStorage<Vec>(checkpoint.file, checkpoint.positions);
+    planetSystem.velocities_ = BlockStorage<Vec>(checkpoint.file, checkpoint.velocities);
+    std::vector<Attractor> attractors;
+    for (std::size_t i = 0; i < checkpoint.attractors.size(); i += checkpointAttractorFloats)
+    {
+        const auto* values = checkpoint.attractors.data() + i;
+        attractors.push_back({ { values[0], values[1] }, { values[2], values[3] }, values[4] });
+    }
+    planetSystem.SetAttractors(attractors);
+    planetSystem.collisionRadius_ = header.collisionRadius;
+    planetSystem.masses_.assign(checkpoint.masses.begin(), checkpoint.masses.end());
+    //Written with another Unroll, padded in a copy
+    const auto blockCount = ((header.planetCount + Width - 1) / Width + Unroll - 1) / Unroll * Unroll;
+    if (header.blockCount != blockCount)
+    {
+        planetSystem.positions_.resize(blockCount, Vec{ defaultPos });
+        planetSystem.velocities_.resize(blockCount, Vec{ defaultVel });
+    }
+    return planetSystem;
 }
 
-PlanetSystem8::PlanetSystem8(std::size_t planetCount) noexcept
+template class BasicPlanetSystem<1, ScalarBackend, 1>;
+template class BasicPlanetSystem<1, ScalarBackend, 2>;
+template class BasicPlanetSystem<1, ScalarBackend, 4>;
+template class BasicPlanetSystem<4, SimdBackend, 1>;
+template class BasicPlanetSystem<4, SimdBackend, 2>;
+template class BasicPlanetSystem<4, SimdBackend, 4>;
+template class BasicPlanetSystem<8, SimdBackend, 1>;
+template class BasicPlanetSystem<8, SimdBackend, 2>;
+template class BasicPlanetSystem<8, SimdBackend, 4>;
+template class BasicPlanetSystem<16, SimdBackend, 1>;
+template class BasicPlanetSystem<16, SimdBackend, 2>;
+template class BasicPlanetSystem<16, SimdBackend, 4>;
+template class BasicPlanetSystem<4, SimdDoubleBackend, 1>;
+template class BasicPlanetSystem<4, SimdDoubleBackend, 2>;
+template class BasicPlanetSystem<8, SimdDoubleBackend, 1>;
+template class BasicPlanetSystem<8, SimdDoubleBackend, 2>;
+
+namespace
 {
-    std::random_device rd;  // Will be used to obtain a seed for the random number engine
-    std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-    std::uniform_real_distribution<float> disRadius(innerRadius, outerRaidus);
-    std::uniform_real_distribution<float> disAngle(0, pi);
+template<typename T>
+class PlanetSystemAdapter final : public PlanetSystemInterface
+{
+public:
+    PlanetSystemAdapter(std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed) noexcept :
+        planetSystem_(planetCount, threadPool, seed)
+    {
+    }
+
+    explicit PlanetSystemAdapter(T planetSystem) noexcept : planetSystem_(std::move(planetSystem))
+    {
+    }
 
-    std::vector<Planet> planets;
-    planets.reserve(planetCount);
+    void Update(float dt) noexcept override
+    {
+        planetSystem_.Update(dt);
+    }
 
-    for (std::size_t i = 0; i < planetCount; i++)
+    void Update(float dt, int steps) noexcept override
     {
-        const auto radius = disRadius(gen);
-        const auto angle = disAngle(gen);
+        planetSystem_.Update(dt, steps);
+    }
 
-        Planet planet;
-        
+    [[nodiscard]] sf::Vector2f GetPosition(int index) const override
+    {
+        return static_cast<sf::Vector2f>(planetSystem_.GetPosition(index));
+    }
 
-        const auto v = Vec2f::up().Rotate(angle) * radius;
+    [[nodiscard]] PositionView GetPositions() const noexcept override
+    {
+        return planetSystem_.GetPositions();
+    }
 
-        planet.position = v + worldCenter;
-        planet.velocity = (planet.position - worldCenter).Perpendicular().Normalized() * std::sqrt(CalculateAcceleration(radius) * radius);
-        planets.push_back(planet);
+    void WritePositions(std::span<sf::Vector2f> positions, float scale) const noexcept override
+    {
+        planetSystem_.WritePositions(positions, scale);
     }
-    positions_.resize(planetCount / 8 + 1);
-    velocities_.resize(planetCount / 8 + 1);
-    for(std::size_t i = 0; i < planetCount/8+1; i++)
+
+    void SetIntegrator(Integrator integrator) noexcept override
     {
-        const std::array<Vec2f, 8> posTmp = {
-                {
-                        i*8<planetCount?planets[i * 8].position:defaultPos,
-                        i*8+1<planetCount?planets[i * 8 + 1].position : defaultPos,
-                        i*8+2<planetCount?planets[i * 8 + 2].position : defaultPos,
-                        i*8+3<planetCount?planets[i * 8 + 3].position : defaultPos,
-                        i*8+4<planetCount?planets[i * 8 + 4].position : defaultPos,
-                        i*8+5<planetCount?planets[i * 8 + 5].position : defaultPos,
-                        i*8+6<planetCount?planets[i * 8 + 6].position : defaultPos,
-                        i*8+7<planetCount?planets[i * 8 + 7].position : defaultPos,
-                } };
-        positions_[i] = EightVec2f{ posTmp };
-        const std::array<Vec2f, 8> velTmp = {
-                {
-                        i * 8 < planetCount ? planets[i * 8].velocity : defaultVel,
-                        i * 8 + 1 < planetCount ? planets[i * 8 + 1].velocity : defaultVel,
-                        i * 8 + 2 < planetCount ? planets[i * 8 + 2].velocity : defaultVel,
-                        i * 8 + 3 < planetCount ? planets[i * 8 + 3].velocity : defaultVel,
-                        i * 8 + 4 < planetCount ? planets[i * 8 + 4].velocity : defaultVel,
-                        i * 8 + 5 < planetCount ? planets[i * 8 + 5].velocity : defaultVel,
-                        i * 8 + 6 < planetCount ? planets[i * 8 + 6].velocity : defaultVel,
-                        i * 8 + 7 < planetCount ? planets[i * 8 + 7].velocity : defaultVel,
-                } };
-        velocities_[i] = EightVec2f{ velTmp };
+        planetSystem_.SetIntegrator(integrator);
     }
+
+    [[nodiscard]] double GetEnergy() const noexcept override
+    {
+        return planetSystem_.GetEnergy();
+    }
+
+    [[nodiscard]] double GetTime() const noexcept override
+    {
+        return planetSystem_.GetTime();
+    }
+
+    void SetCollisionRadius(float radius) noexcept override
+    {
+        planetSystem_.SetCollisionRadius(radius);
+    }
+
+    void SetAttractors(std::span<const Attractor> attractors) override
+    {
+        planetSystem_.SetAttractors(attractors);
+    }
+
+    bool SaveCheckpoint(const std::filesystem::path& path) const override
+    {
+        return planetSystem_.SaveCheckpoint(path);
+    }
+private:
+    T planetSystem_;
+};
+
+template<typename T>
+std::unique_ptr<PlanetSystemInterface> AdaptCheckpoint(Checkpoint checkpoint, ThreadPool* threadPool)
+{
+    auto planetSystem = T::LoadCheckpoint(std::move(checkpoint), threadPool);
+    if (!planetSystem)
+    {
+        return nullptr;
+    }
+    return std::make_unique<PlanetSystemAdapter<T>>(std::move(*planetSystem));
+}
 }
 
-void PlanetSystem8::Update(float dt) noexcept
+std::unique_ptr<PlanetSystemInterface> CreatePlanetSystem(int width, std::size_t planetCount, ThreadPool* threadPool, std::uint64_t seed)
 {
-#ifdef TRACY_ENABLE
-    ZoneScoped;
-#endif
-    for (std::size_t i = 0; i < velocities_.size(); i++)
+    switch (width)
     {
-        //Calculate new velocity
-        const auto eightWorldCenter = EightVec2f {worldCenter };
-        const auto delta = (positions_[i] - eightWorldCenter);
-        const auto sqrRadius = delta.SquareMagnitude();
-        const auto accelerationValue = CalculateAcceleration(sqrRadius);
-        const auto acceleration = (-delta).Normalized() * accelerationValue;
-        const auto eightDt = EightFloat{dt};
-        velocities_[i] += acceleration * eightDt;
-        //Calculate new position
-        positions_ [i] += velocities_[i] * eightDt;
+    case 1: return std::make_unique<PlanetSystemAdapter<PlanetSystem>>(planetCount, threadPool, seed);
+    case 4: return std::make_unique<PlanetSystemAdapter<PlanetSystem4>>(planetCount, threadPool, seed);
+    case 8: return std::make_unique<PlanetSystemAdapter<PlanetSystem8>>(planetCount, threadPool, seed);
+    case 16: return std::make_unique<PlanetSystemAdapter<PlanetSystem16>>(planetCount, threadPool, seed);
+    default: return nullptr;
     }
 }
 
-Vec2f PlanetSystem8::GetPosition(int index) const
+std::unique_ptr<PlanetSystemInterface> LoadPlanetSystem(Checkpoint checkpoint, ThreadPool* threadPool)
 {
-    return { positions_[index / 8].Xs()[index % 8], positions_[index / 8].Ys()[index % 8] };
+    switch (checkpoint.header.width)
+    {
+    case 1: return AdaptCheckpoint<PlanetSystem>(std::move(checkpoint), threadPool);
+    case 4: return AdaptCheckpoint<PlanetSystem4>(std::move(checkpoint), threadPool);
+    case 8: return AdaptCheckpoint<PlanetSystem8>(std::move(checkpoint), threadPool);
+    case 16: return AdaptCheckpoint<PlanetSystem16>(std::move(checkpoint), threadPool);
+    default: return nullptr;
+    }
+}
 }
 }
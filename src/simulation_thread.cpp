@@ -0,0 +1,116 @@
+#include "simulation_thread.h"
+#include "dispatch.h"
+
+#include <algorithm>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+
+namespace
+{
+//Steps that may be run back to back to catch up with the wall clock, after that the simulation slows down instead
+constexpr int maxCatchUpSteps = 4;
+}
+
+void PositionSnapshot::Assign(const PositionView& positions)
+{
+    const auto source = positions.GetData();
+    data.assign(source.begin(), source.end());
+    planetCount = positions.GetPlanetCount();
+    laneCount = positions.GetLaneCount();
+}
+
+void SnapshotBuffer::Publish() noexcept
+{
+    back_ = middle_.exchange(back_ | freshBit, std::memory_order_acq_rel) & ~freshBit;
+}
+
+bool SnapshotBuffer::Acquire() noexcept
+{
+    if ((middle_.load(std::memory_order_relaxed) & freshBit) == 0)
+    {
+        return false;
+    }
+    //The old previous goes to the writer, the old front becomes the previous
+    const auto fresh = middle_.exchange(previous_, std::memory_order_acq_rel) & ~freshBit;
+    previous_ = front_;
+    front_ = fresh;
+    return true;
+}
+
+SimulationThread::SimulationThread(PlanetSystemInterface& planetSystem, float fixedDt) :
+    planetSystem_(planetSystem), fixedDt_(fixedDt)
+{
+    //The initial positions are there before the first step
+    PublishSnapshot(std::chrono::steady_clock::now(), 0);
+    snapshots_.Acquire();
+    thread_ = std::jthread([this](std::stop_token stopToken) { Run(std::move(stopToken)); });
+}
+
+PositionView SimulationThread::GetPositions(std::chrono::steady_clock::time_point now)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    snapshots_.Acquire();
+    const auto& current = snapshots_.GetFront();
+    const auto& previous = snapshots_.GetPrevious();
+    if (previous.data.size() != current.data.size() || current.time <= previous.time)
+    {
+        return current.GetView();
+    }
+    //One step behind, so there is usually a snapshot on both sides of the rendered time
+    const auto renderTime = now - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(fixedDt_));
+    const auto alpha = std::chrono::duration<float>(renderTime - previous.time) / std::chrono::duration<float>(current.time - previous.time);
+    interpolated_.resize(current.data.size());
+    Interpolate(previous.data, current.data, std::clamp(alpha, 0.0f, 1.0f), interpolated_);
+    return { interpolated_.data(), current.planetCount, current.laneCount };
+}
+
+void SimulationThread::Run(std::stop_token stopToken)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto fixedStep = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(fixedDt_));
+    auto next = snapshots_.GetFront().time;
+    std::uint64_t step = 0;
+    while (!stopToken.stop_requested())
+    {
+        planetSystem_.Update(fixedDt_);
+        next += fixedStep;
+        step++;
+        PublishSnapshot(next, step);
+        stepCount_.store(step, std::memory_order_relaxed);
+        const auto now = Clock::now();
+        if (now > next + maxCatchUpSteps * fixedStep)
+        {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
+
+void SimulationThread::PublishSnapshot(std::chrono::steady_clock::time_point time, std::uint64_t step)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    auto& snapshot = snapshots_.GetBack();
+    snapshot.Assign(planetSystem_.GetPositions());
+    snapshot.time = time;
+    snapshot.step = step;
+    snapshots_.Publish();
+}
+
+void Interpolate(std::span<const float> previous, std::span<const float> current, float alpha, std::span<float> result) noexcept
+{
+    for (std::size_t i = 0; i < result.size(); i++)
+    {
+        result[i] = previous[i] + (current[i] - previous[i]) * alpha;
+    }
+}
+
+}
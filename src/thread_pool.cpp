@@ -0,0 +1,184 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace planets
+{
+
+namespace
+{
+constexpr std::uint64_t PackRange(std::uint64_t begin, std::uint64_t end) noexcept
+{
+    return (end << 32u) | begin;
+}
+
+constexpr std::uint32_t RangeBegin(std::uint64_t range) noexcept
+{
+    return static_cast<std::uint32_t>(range);
+}
+
+constexpr std::uint32_t RangeEnd(std::uint64_t range) noexcept
+{
+    return static_cast<std::uint32_t>(range >> 32u);
+}
+}
+
+ThreadPool::ThreadPool(std::size_t threadCount) : slices_(std::max<std::size_t>(threadCount, 1))
+{
+    workers_.reserve(slices_.size() - 1);
+    for (std::size_t i = 1; i < slices_.size(); i++)
+    {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    startCondition_.notify_all();
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::ParallelFor(std::size_t begin, std::size_t end, std::size_t chunkSize,
+    const std::function<void(std::size_t, std::size_t)>& func)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    const auto chunkCount = (end - begin + chunkSize - 1) / chunkSize;
+    if (workers_.empty() || chunkCount == 1)
+    {
+        for (auto chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize)
+        {
+            func(chunkBegin, std::min(chunkBegin + chunkSize, end));
+        }
+        return;
+    }
+    {
+        std::unique_lock lock(mutex_);
+        //A worker woken late by the previous job might still be scanning the slices
+        doneCondition_.wait(lock, [this] { return busyWorkers_ == 0; });
+        func_ = &func;
+        begin_ = begin;
+        end_ = end;
+        chunkSize_ = chunkSize;
+        const auto sliceCount = slices_.size();
+        for (std::size_t i = 0; i < sliceCount; i++)
+        {
+            const auto sliceBegin = chunkCount * i / sliceCount;
+            const auto sliceEnd = chunkCount * (i + 1) / sliceCount;
+            slices_[i].range.store(PackRange(sliceBegin, sliceEnd), std::memory_order_relaxed);
+        }
+        jobEpoch_++;
+    }
+    startCondition_.notify_all();
+
+    RunChunks(0);
+
+    std::unique_lock lock(mutex_);
+    doneCondition_.wait(lock, [this] { return busyWorkers_ == 0; });
+}
+
+void ThreadPool::WorkerLoop(std::size_t workerIndex)
+{
+    std::uint64_t seenEpoch = 0;
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex_);
+            startCondition_.wait(lock, [this, seenEpoch] { return stop_ || jobEpoch_ != seenEpoch; });
+            if (stop_)
+            {
+                return;
+            }
+            seenEpoch = jobEpoch_;
+            busyWorkers_++;
+        }
+        RunChunks(workerIndex);
+        {
+            std::scoped_lock lock(mutex_);
+            busyWorkers_--;
+        }
+        doneCondition_.notify_all();
+    }
+}
+
+void ThreadPool::RunChunks(std::size_t workerIndex)
+{
+    const auto runChunk = [this](std::uint32_t chunk)
+    {
+        const auto chunkBegin = begin_ + chunk * chunkSize_;
+        (*func_)(chunkBegin, std::min(chunkBegin + chunkSize_, end_));
+    };
+    std::uint32_t chunk = 0;
+    while (PopFront(workerIndex, chunk))
+    {
+        runChunk(chunk);
+    }
+    const auto sliceCount = slices_.size();
+    for (std::size_t offset = 1; offset < sliceCount; offset++)
+    {
+        const auto victim = (workerIndex + offset) % sliceCount;
+        while (PopBack(victim, chunk))
+        {
+            runChunk(chunk);
+        }
+    }
+}
+
+bool ThreadPool::PopFront(std::size_t sliceIndex, std::uint32_t& chunk) noexcept
+{
+    auto& range = slices_[sliceIndex].range;
+    auto current = range.load(std::memory_order_relaxed);
+    while (RangeBegin(current) < RangeEnd(current))
+    {
+        if (range.compare_exchange_weak(current, PackRange(RangeBegin(current) + 1ull, RangeEnd(current)),
+            std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            chunk = RangeBegin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::PopBack(std::size_t sliceIndex, std::uint32_t& chunk) noexcept
+{
+    auto& range = slices_[sliceIndex].range;
+    auto current = range.load(std::memory_order_relaxed);
+    while (RangeBegin(current) < RangeEnd(current))
+    {
+        if (range.compare_exchange_weak(current, PackRange(RangeBegin(current), RangeEnd(current) - 1ull),
+            std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            chunk = RangeEnd(current) - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ParallelFor(ThreadPool* threadPool, std::size_t begin, std::size_t end, std::size_t chunkSize,
+    const std::function<void(std::size_t, std::size_t)>& func)
+{
+    if (threadPool != nullptr)
+    {
+        threadPool->ParallelFor(begin, end, chunkSize, func);
+        return;
+    }
+    chunkSize = std::max<std::size_t>(chunkSize, 1);
+    for (auto chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize)
+    {
+        func(chunkBegin, std::min(chunkBegin + chunkSize, end));
+    }
+}
+
+}
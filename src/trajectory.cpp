@@ -0,0 +1,297 @@
+#include "trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#ifdef TRACY_ENABLE
+#include <tracy/Tracy.hpp>
+#endif
+
+namespace planets
+{
+
+namespace
+{
+//Prediction lastWeight * last - beforeLastWeight * beforeLast: nothing, the last frame or the linear extrapolation.
+//Unsigned arithmetic so a prediction out of range wraps the same way on both sides.
+struct Prediction
+{
+    std::uint32_t lastWeight = 0;
+    std::uint32_t beforeLastWeight = 0;
+
+    explicit Prediction(std::size_t history) noexcept :
+        lastWeight(static_cast<std::uint32_t>(std::min<std::size_t>(history, 2))),
+        beforeLastWeight(history >= 2 ? 1 : 0)
+    {
+    }
+
+    std::uint32_t operator()(std::int32_t last, std::int32_t beforeLast) const noexcept
+    {
+        return lastWeight * static_cast<std::uint32_t>(last) - beforeLastWeight * static_cast<std::uint32_t>(beforeLast);
+    }
+};
+
+//Rounded half away from zero with a truncating conversion, which has a vector form on every isa
+std::int32_t Quantize(float coordinate, float scale) noexcept
+{
+    //Largest float below 2^31
+    constexpr float limit = 2147483520.0f;
+    const auto scaled = std::clamp(coordinate * scale, -limit, limit);
+    return static_cast<std::int32_t>(scaled + std::copysign(0.5f, scaled));
+}
+
+//data must have room for 5 bytes, returns the end of the written bytes
+std::uint8_t* WriteVarint(std::uint32_t value, std::uint8_t* data) noexcept
+{
+    while (value >= 0x80)
+    {
+        *data++ = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *data++ = static_cast<std::uint8_t>(value);
+    return data;
+}
+
+bool ReadVarint(const std::uint8_t*& data, const std::uint8_t* end, std::uint32_t& value) noexcept
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && data != end; shift += 7)
+    {
+        const auto byte = *data++;
+        value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+//Small residuals of either sign become small unsigned values
+constexpr std::uint32_t ZigZag(std::uint32_t value) noexcept
+{
+    return (value << 1) ^ (0u - (value >> 31));
+}
+
+constexpr std::uint32_t UnZigZag(std::uint32_t value) noexcept
+{
+    return (value >> 1) ^ (0u - (value & 1));
+}
+
+void ResetHistory(std::size_t coordinateCount, std::size_t& history, std::vector<std::int32_t>& previous,
+    std::vector<std::int32_t>& current)
+{
+    if (current.size() != coordinateCount)
+    {
+        history = 0;
+        previous.assign(coordinateCount, 0);
+        current.assign(coordinateCount, 0);
+    }
+}
+
+//Bytes between the read position and the end of the file, the read position is left where it was
+std::uint64_t RemainingBytes(std::ifstream& input)
+{
+    const auto position = input.tellg();
+    input.seekg(0, std::ios::end);
+    const auto end = input.tellg();
+    input.seekg(position);
+    return position < 0 || end < position ? 0 : static_cast<std::uint64_t>(end - position);
+}
+}
+
+std::span<const std::uint8_t> TrajectoryEncoder::Encode(const PositionView& positions)
+{
+    const auto planetCount = positions.GetPlanetCount();
+    const auto laneCount = positions.GetLaneCount();
+    ResetHistory(planetCount * 2, history_, previous_, current_);
+    residuals_.resize(planetCount * 2);
+    //Lanes of a block are contiguous in both layouts, so this pass vectorizes.
+    //The new frame overwrites the one before last in place, which is no longer needed once read.
+    const Prediction predict(history_);
+    const auto encode = [&](std::span<const float> coordinates, std::size_t first, std::size_t count)
+    {
+        for (std::size_t i = first; i < first + count; i++)
+        {
+            const auto quantized = Quantize(coordinates[i - first], scale_);
+            residuals_[i] = ZigZag(static_cast<std::uint32_t>(quantized) - predict(current_[i], previous_[i]));
+            previous_[i] = quantized;
+        }
+    };
+    for (std::size_t block = 0; block < positions.GetBlockCount(); block++)
+    {
+        const auto first = block * laneCount;
+        const auto lanes = std::min(laneCount, planetCount - first);
+        encode(positions.Xs(block), first, lanes);
+        encode(positions.Ys(block), planetCount + first, lanes);
+    }
+    std::swap(previous_, current_);
+    history_ = std::min<std::size_t>(history_ + 1, 2);
+
+    //Only ever grown, so it is not cleared again for every frame
+    if (payload_.size() < residuals_.size() * 5)
+    {
+        payload_.resize(residuals_.size() * 5);
+    }
+    auto* data = payload_.data();
+    for (const auto residual : residuals_)
+    {
+        data = WriteVarint(residual, data);
+    }
+    return { payload_.data(), data };
+}
+
+std::unique_ptr<TrajectoryRecorder> TrajectoryRecorder::Create(const std::filesystem::path& path, double quantum, std::size_t queueCapacity)
+{
+    if (!(quantum > 0.0) || queueCapacity == 0)
+    {
+        return nullptr;
+    }
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    TrajectoryHeader header;
+    header.quantum = quantum;
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!output)
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<TrajectoryRecorder>(new TrajectoryRecorder(std::move(output), quantum, queueCapacity));
+}
+
+TrajectoryRecorder::TrajectoryRecorder(std::ofstream output, double quantum, std::size_t queueCapacity) :
+    output_(std::move(output)), encoder_(quantum), writtenBytes_(sizeof(TrajectoryHeader)),
+    snapshots_(queueCapacity), times_(queueCapacity)
+{
+    thread_ = std::jthread([this](std::stop_token stopToken) { Run(std::move(stopToken)); });
+}
+
+void TrajectoryRecorder::Record(const PositionView& positions, double time)
+{
+#ifdef TRACY_ENABLE
+    ZoneScoped;
+#endif
+    std::unique_lock lock(mutex_);
+    freeCondition_.wait(lock, [&] { return head_ - tail_ < snapshots_.size(); });
+    const auto slot = head_ % snapshots_.size();
+    lock.unlock();
+    //The writer never touches a slot between tail_ and head_ wrapping around to it
+    snapshots_[slot].Assign(positions);
+    times_[slot] = time;
+    lock.lock();
+    head_++;
+    lock.unlock();
+    queuedCondition_.notify_one();
+    frameCount_++;
+}
+
+bool TrajectoryRecorder::Flush()
+{
+    std::unique_lock lock(mutex_);
+    freeCondition_.wait(lock, [&] { return tail_ == head_; });
+    if (!output_.flush())
+    {
+        failed_.store(true, std::memory_order_relaxed);
+    }
+    return !failed_.load(std::memory_order_relaxed);
+}
+
+void TrajectoryRecorder::Run(std::stop_token stopToken)
+{
+    while (true)
+    {
+        std::unique_lock lock(mutex_);
+        //Only false once stopped with nothing left in the queue
+        if (!queuedCondition_.wait(lock, stopToken, [&] { return head_ != tail_; }))
+        {
+            break;
+        }
+        const auto slot = tail_ % snapshots_.size();
+        lock.unlock();
+        if (!failed_.load(std::memory_order_relaxed))
+        {
+#ifdef TRACY_ENABLE
+            ZoneScopedN("TrajectoryRecorder::Write");
+#endif
+            const auto positions = snapshots_[slot].GetView();
+            const auto payload = encoder_.Encode(positions);
+            const TrajectoryFrameHeader frameHeader{ times_[slot], positions.GetPlanetCount(), payload.size() };
+            output_.write(reinterpret_cast<const char*>(&frameHeader), sizeof(frameHeader));
+            output_.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+            if (!output_)
+            {
+                failed_.store(true, std::memory_order_relaxed);
+            }
+            writtenBytes_.fetch_add(sizeof(frameHeader) + payload.size(), std::memory_order_relaxed);
+        }
+        lock.lock();
+        tail_++;
+        lock.unlock();
+        freeCondition_.notify_all();
+    }
+    output_.flush();
+}
+
+std::unique_ptr<TrajectoryReader> TrajectoryReader::Open(const std::filesystem::path& path)
+{
+    std::ifstream input(path, std::ios::binary);
+    TrajectoryHeader header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != trajectoryMagic
+        || header.version != trajectoryVersion || !(header.quantum > 0.0))
+    {
+        return nullptr;
+    }
+    return std::unique_ptr<TrajectoryReader>(new TrajectoryReader(std::move(input), header.quantum));
+}
+
+bool TrajectoryReader::Next(TrajectoryFrame& frame)
+{
+    TrajectoryFrameHeader header;
+    if (!input_.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    //The payload fits in what is left of the file, with at least one and at most five bytes per coordinate. Checked
+    //before anything is sized from the header, so a corrupt count can neither overflow nor allocate past the file.
+    if (header.payloadSize > RemainingBytes(input_) || header.planetCount > header.payloadSize / 2)
+    {
+        return false;
+    }
+    const auto coordinateCount = static_cast<std::size_t>(header.planetCount * 2);
+    if (header.payloadSize > coordinateCount * 5)
+    {
+        return false;
+    }
+    payload_.resize(header.payloadSize);
+    if (!input_.read(reinterpret_cast<char*>(payload_.data()), static_cast<std::streamsize>(payload_.size())))
+    {
+        return false;
+    }
+    ResetHistory(coordinateCount, history_, previous_, current_);
+    const Prediction predict(history_);
+    const auto* data = payload_.data();
+    const auto* end = data + payload_.size();
+    for (std::size_t i = 0; i < coordinateCount; i++)
+    {
+        std::uint32_t residual = 0;
+        if (!ReadVarint(data, end, residual))
+        {
+            return false;
+        }
+        previous_[i] = static_cast<std::int32_t>(predict(current_[i], previous_[i]) + UnZigZag(residual));
+    }
+    std::swap(previous_, current_);
+    history_ = std::min<std::size_t>(history_ + 1, 2);
+
+    frame.time = header.time;
+    const auto planetCount = static_cast<std::size_t>(header.planetCount);
+    frame.positions.resize(planetCount);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        frame.positions[i] = { static_cast<float>(current_[i] * quantum_), static_cast<float>(current_[planetCount + i] * quantum_) };
+    }
+    return true;
+}
+
+}
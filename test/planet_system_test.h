@@ -0,0 +1,44 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include "planet.h"
+#include "thread_pool.h"
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+//Helpers shared by the tests running on every BasicPlanetSystem variant
+namespace planets::test
+{
+
+//Every float and double lane width, in the order the tests run them
+using PlanetSystems = std::tuple<PlanetSystem, PlanetSystem4, PlanetSystem8, PlanetSystem16, DoublePlanetSystem4, DoublePlanetSystem8>;
+
+//Calls expect.template operator()<T>(ThreadPool*) for every T of PlanetSystems, every other one with threadPool
+//and the others without a thread pool, so both paths are covered
+template<typename F>
+void ForEachPlanetSystem(ThreadPool& threadPool, F&& expect)
+{
+    [&]<std::size_t... I>(std::index_sequence<I...>)
+    {
+        (expect.template operator()<std::tuple_element_t<I, PlanetSystems>>(I % 2 == 0 ? nullptr : &threadPool), ...);
+    }(std::make_index_sequence<std::tuple_size_v<PlanetSystems>>{});
+}
+
+//Bitwise same positions and velocities for the first planetCount planets, T and U may be of different variants
+template<typename T, typename U>
+void ExpectSameState(const T& planetSystem, const U& expected, std::size_t planetCount)
+{
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto index = static_cast<int>(i);
+        EXPECT_EQ(planetSystem.GetPosition(index).x, expected.GetPosition(index).x) << "planet " << i;
+        EXPECT_EQ(planetSystem.GetPosition(index).y, expected.GetPosition(index).y) << "planet " << i;
+        EXPECT_EQ(planetSystem.GetVelocity(index).x, expected.GetVelocity(index).x) << "planet " << i;
+        EXPECT_EQ(planetSystem.GetVelocity(index).y, expected.GetVelocity(index).y) << "planet " << i;
+    }
+}
+
+}
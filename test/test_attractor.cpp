@@ -0,0 +1,219 @@
+#include <gtest/gtest.h>
+
+#include "planet.h"
+#include "planet_system_test.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+constexpr std::size_t planetCount = 1'001;
+
+//A binary at a tenth of a meter on each side of worldCenter and a light third star moving across
+const std::array<planets::Attractor, 3> ternary{ {
+    { { planets::worldCenter.x - 0.1f, planets::worldCenter.y }, {}, 0.5f },
+    { { planets::worldCenter.x + 0.1f, planets::worldCenter.y }, {}, 0.4f },
+    { { planets::worldCenter.x, planets::worldCenter.y + 0.6f }, { 0.05f, -0.02f }, 0.1f },
+} };
+
+//One leapfrog step of every planet in double, the attractors pulling from the middle of the step
+template<typename T>
+void ExpectLeapfrogMatchesReference(planets::ThreadPool* threadPool)
+{
+    constexpr float dt = 0.01f;
+    T planetSystem(planetCount, threadPool, 5);
+    planetSystem.SetIntegrator(planets::Integrator::Leapfrog);
+    planetSystem.SetAttractors(ternary);
+    std::vector<std::array<double, 4>> expected;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        const auto velocity = planetSystem.GetVelocity(static_cast<int>(i));
+        double x = position.x + 0.5 * dt * velocity.x;
+        double y = position.y + 0.5 * dt * velocity.y;
+        double vx = velocity.x;
+        double vy = velocity.y;
+        for (const auto& attractor : ternary)
+        {
+            const auto dx = attractor.position.x + 0.5 * dt * attractor.velocity.x - x;
+            const auto dy = attractor.position.y + 0.5 * dt * attractor.velocity.y - y;
+            const auto r = std::sqrt(dx * dx + dy * dy);
+            vx += dt * planets::G * attractor.mass * dx / (r * r * r);
+            vy += dt * planets::G * attractor.mass * dy / (r * r * r);
+        }
+        x += 0.5 * dt * vx;
+        y += 0.5 * dt * vy;
+        expected.push_back({ x, y, vx, vy });
+    }
+    planetSystem.Update(dt);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        const auto velocity = planetSystem.GetVelocity(static_cast<int>(i));
+        const auto& [x, y, vx, vy] = expected[i];
+        const auto speed = std::hypot(vx, vy);
+        ASSERT_NEAR(position.x, x, 1e-5) << "planet " << i;
+        ASSERT_NEAR(position.y, y, 1e-5) << "planet " << i;
+        ASSERT_NEAR(velocity.x, vx, speed * 1e-4 + 1e-6) << "planet " << i;
+        ASSERT_NEAR(velocity.y, vy, speed * 1e-4 + 1e-6) << "planet " << i;
+    }
+}
+}
+
+TEST(Attractor, DefaultIsTheStar)
+{
+    const planets::PlanetSystem8 planetSystem(planetCount, nullptr, 5);
+    const auto attractors = planetSystem.GetAttractors();
+    ASSERT_EQ(attractors.size(), 1u);
+    EXPECT_FLOAT_EQ(attractors[0].position.x, planets::worldCenter.x);
+    EXPECT_FLOAT_EQ(attractors[0].position.y, planets::worldCenter.y);
+    EXPECT_FLOAT_EQ(attractors[0].mass, 1.0f);
+}
+
+TEST(Attractor, SplitStarMatchesStar)
+{
+    //Two halves of the star in one place take the loop over the attractors, the star alone does not
+    const std::array<planets::Attractor, 2> halves{ {
+        { { planets::worldCenter.x, planets::worldCenter.y }, {}, 0.5f },
+        { { planets::worldCenter.x, planets::worldCenter.y }, {}, 0.5f },
+    } };
+    for (const auto integrator : { planets::Integrator::Euler, planets::Integrator::Leapfrog, planets::Integrator::VelocityVerlet, planets::Integrator::Yoshida4 })
+    {
+        planets::PlanetSystem8 star(planetCount, nullptr, 5);
+        planets::PlanetSystem8 split(planetCount, nullptr, 5);
+        star.SetIntegrator(integrator);
+        split.SetIntegrator(integrator);
+        split.SetAttractors(halves);
+        for (int i = 0; i < 10; i++)
+        {
+            star.Update(0.01f);
+            split.Update(0.01f);
+        }
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            const auto delta = star.GetPosition(static_cast<int>(i)) - split.GetPosition(static_cast<int>(i));
+            ASSERT_LT(delta.SquareMagnitude(), 1e-10f) << "planet " << i << " integrator " << static_cast<int>(integrator);
+        }
+    }
+}
+
+TEST(Attractor, LeapfrogMatchesReference)
+{
+    planets::ThreadPool threadPool(4);
+    planets::test::ForEachPlanetSystem(threadPool, []<typename T>(planets::ThreadPool* pool) { ExpectLeapfrogMatchesReference<T>(pool); });
+}
+
+TEST(Attractor, MovingAttractorSteps)
+{
+    constexpr float dt = 0.01f;
+    constexpr int steps = 8;
+    for (const auto integrator : { planets::Integrator::Euler, planets::Integrator::VelocityVerlet })
+    {
+        planets::PlanetSystem8 stepped(planetCount, nullptr, 5);
+        planets::PlanetSystem8 batched(planetCount, nullptr, 5);
+        stepped.SetIntegrator(integrator);
+        batched.SetIntegrator(integrator);
+        stepped.SetAttractors(ternary);
+        batched.SetAttractors(ternary);
+        for (int i = 0; i < steps; i++)
+        {
+            stepped.Update(dt);
+        }
+        batched.Update(dt, steps);
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            const auto delta = stepped.GetPosition(static_cast<int>(i)) - batched.GetPosition(static_cast<int>(i));
+            ASSERT_LT(delta.SquareMagnitude(), 1e-10f) << "planet " << i << " integrator " << static_cast<int>(integrator);
+        }
+        const auto moved = batched.GetAttractors()[2];
+        EXPECT_NEAR(moved.position.x, ternary[2].position.x + ternary[2].velocity.x * dt * steps, 1e-5f);
+        EXPECT_NEAR(moved.position.y, ternary[2].position.y + ternary[2].velocity.y * dt * steps, 1e-5f);
+        EXPECT_NEAR(stepped.GetAttractors()[2].position.x, moved.position.x, 1e-5f);
+        EXPECT_FLOAT_EQ(batched.GetAttractors()[0].position.x, ternary[0].position.x);
+    }
+
+    //Kick, drift, kick with the closing kick, kept for the next step, pulled from where the attractors end the step.
+    //The third star is a hundred times faster, so a pull from the middle of the step shows in the velocities.
+    auto fast = ternary;
+    fast[2].velocity = fast[2].velocity * 100.0f;
+    planets::PlanetSystem8 verlet(planetCount, nullptr, 5);
+    verlet.SetIntegrator(planets::Integrator::VelocityVerlet);
+    verlet.SetAttractors(fast);
+    const auto acceleration = [&](double x, double y, double time)
+    {
+        std::array<double, 2> pull{};
+        for (const auto& attractor : fast)
+        {
+            const auto dx = attractor.position.x + time * attractor.velocity.x - x;
+            const auto dy = attractor.position.y + time * attractor.velocity.y - y;
+            const auto r = std::sqrt(dx * dx + dy * dy);
+            pull[0] += planets::G * attractor.mass * dx / (r * r * r);
+            pull[1] += planets::G * attractor.mass * dy / (r * r * r);
+        }
+        return pull;
+    };
+    std::vector<std::array<double, 4>> expected;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto position = verlet.GetPosition(static_cast<int>(i));
+        const auto velocity = verlet.GetVelocity(static_cast<int>(i));
+        double x = position.x, y = position.y, vx = velocity.x, vy = velocity.y;
+        auto pull = acceleration(x, y, 0.0);
+        for (int step = 1; step <= 2; step++)
+        {
+            vx += 0.5 * dt * pull[0];
+            vy += 0.5 * dt * pull[1];
+            x += dt * vx;
+            y += dt * vy;
+            pull = acceleration(x, y, dt * step);
+            vx += 0.5 * dt * pull[0];
+            vy += 0.5 * dt * pull[1];
+        }
+        expected.push_back({ x, y, vx, vy });
+    }
+    verlet.Update(dt);
+    verlet.Update(dt);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto position = verlet.GetPosition(static_cast<int>(i));
+        const auto velocity = verlet.GetVelocity(static_cast<int>(i));
+        const auto& [x, y, vx, vy] = expected[i];
+        const auto speed = std::hypot(vx, vy);
+        ASSERT_NEAR(position.x, x, 1e-5) << "planet " << i;
+        ASSERT_NEAR(position.y, y, 1e-5) << "planet " << i;
+        ASSERT_NEAR(velocity.x, vx, speed * 1e-4 + 1e-6) << "planet " << i;
+        ASSERT_NEAR(velocity.y, vy, speed * 1e-4 + 1e-6) << "planet " << i;
+    }
+}
+
+TEST(Attractor, BinaryConservesEnergy)
+{
+    //Standing still, so the energy against both stars is conserved
+    const std::array<planets::Attractor, 2> binary{ ternary[0], ternary[1] };
+    planets::PlanetSystem8 planetSystem(planetCount, nullptr, 5);
+    planetSystem.SetIntegrator(planets::Integrator::Yoshida4);
+    planetSystem.SetAttractors(binary);
+    const auto initialEnergy = planetSystem.GetEnergy();
+    for (int i = 0; i < 50; i++)
+    {
+        planetSystem.Update(0.002f);
+    }
+    EXPECT_LT(std::abs(planetSystem.GetEnergy() - initialEnergy), std::abs(initialEnergy) * 1e-3);
+}
+
+TEST(Attractor, NoneFliesStraight)
+{
+    constexpr float dt = 0.01f;
+    planets::PlanetSystem4 planetSystem(planetCount, nullptr, 5);
+    planetSystem.SetAttractors({});
+    const auto position = planetSystem.GetPosition(3);
+    const auto velocity = planetSystem.GetVelocity(3);
+    planetSystem.Update(dt, 4);
+    EXPECT_NEAR(planetSystem.GetPosition(3).x, position.x + velocity.x * dt * 4.0f, 1e-5f);
+    EXPECT_NEAR(planetSystem.GetPosition(3).y, position.y + velocity.y * dt * 4.0f, 1e-5f);
+    EXPECT_FLOAT_EQ(planetSystem.GetVelocity(3).x, velocity.x);
+    EXPECT_FLOAT_EQ(planetSystem.GetVelocity(3).y, velocity.y);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "block_timestep.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <vector>
+
+namespace
+{
+//Leapfrog of a single planet with a fixed small substep
+void IntegrateReference(planets::Vec2f& position, planets::Vec2f& velocity, float dt, int substepCount)
+{
+    const auto substep = dt / static_cast<float>(substepCount);
+    for (int i = 0; i < substepCount; i++)
+    {
+        position += velocity * (0.5f * substep);
+        velocity += planets::CalculateGravity(position - planets::worldCenter) * substep;
+        position += velocity * (0.5f * substep);
+    }
+}
+
+template<int N>
+void ExpectMatchesReference(planets::ThreadPool* threadPool)
+{
+    constexpr std::size_t planetCount = 501;
+    constexpr float dt = 1.0f / 30.0f;
+    //Crosses a few sorts
+    constexpr int updateCount = 3 * planets::BlockTimestepSystem<N>::sortInterval + 5;
+    planets::BlockTimestepSystem<N> planetSystem(planetCount, planets::BlockTimestepSystem<N>::defaultAccuracy, threadPool);
+    std::vector<planets::Vec2f> positions(planetCount), velocities(planetCount);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        positions[i] = planetSystem.GetPosition(static_cast<int>(i));
+        velocities[i] = planetSystem.GetVelocity(static_cast<int>(i));
+    }
+    for (int update = 0; update < updateCount; update++)
+    {
+        planetSystem.Update(dt);
+    }
+    double maxError = 0.0;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        for (int update = 0; update < updateCount; update++)
+        {
+            IntegrateReference(positions[i], velocities[i], dt, 256);
+        }
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        const auto delta = position - positions[i];
+        const auto radius = (positions[i] - planets::worldCenter).Magnitude();
+        maxError = std::max(maxError, static_cast<double>(delta.Magnitude() / radius));
+    }
+    EXPECT_LT(maxError, 1e-2);
+
+    //Against every planet at the finest level the blocks ended up using
+    int finestLevel = 0;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        finestLevel = std::max(finestLevel, planetSystem.GetLevel(static_cast<int>(i)));
+    }
+    const auto uniformEvaluations = (std::uint64_t{ 1 } << finestLevel) * ((planetCount + N - 1) / N * N) * updateCount;
+    EXPECT_GT(finestLevel, 0);
+    EXPECT_LT(planetSystem.GetForceEvaluationCount(), uniformEvaluations / 2);
+}
+}
+
+TEST(BlockTimestep, MatchesReference)
+{
+    ExpectMatchesReference<4>(nullptr);
+    ExpectMatchesReference<8>(nullptr);
+    planets::ThreadPool threadPool(3);
+    ExpectMatchesReference<16>(&threadPool);
+}
+
+TEST(BlockTimestep, LevelsFollowRadius)
+{
+    constexpr std::size_t planetCount = 2'000;
+    planets::BlockTimestepSystem8 planetSystem(planetCount);
+    planetSystem.Update(1.0f / 30.0f);
+    //Sorted by level, so most blocks hold planets of one level and the inner ones substep more
+    double innerLevels = 0.0, outerLevels = 0.0;
+    int innerCount = 0, outerCount = 0;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto radius = (planetSystem.GetPosition(static_cast<int>(i)) - planets::worldCenter).Magnitude();
+        const auto level = planetSystem.GetLevel(static_cast<int>(i));
+        if (radius < 2.0f)
+        {
+            innerLevels += level;
+            innerCount++;
+        }
+        else if (radius > 5.0f)
+        {
+            outerLevels += level;
+            outerCount++;
+        }
+    }
+    ASSERT_GT(innerCount, 0);
+    ASSERT_GT(outerCount, 0);
+    EXPECT_GT(innerLevels / innerCount, outerLevels / outerCount + 1.0);
+    EXPECT_EQ(planetSystem.GetPositions().GetPlanetCount(), planetCount);
+}
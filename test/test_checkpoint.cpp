@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include "checkpoint.h"
+#include "planet.h"
+#include "planet_system_test.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+std::filesystem::path TemporaryPath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+
+template<typename T>
+void ExpectResumes(planets::ThreadPool* threadPool)
+{
+    constexpr std::size_t planetCount = 10'001;
+    const auto path = TemporaryPath("planets_test_resume.bin");
+    T original(planetCount, threadPool, 5);
+    original.SetIntegrator(planets::Integrator::Yoshida4);
+    original.Update(0.01f, 10);
+    ASSERT_TRUE(original.SaveCheckpoint(path));
+
+    auto resumed = T::LoadCheckpoint(path, threadPool);
+    ASSERT_TRUE(resumed);
+    EXPECT_TRUE(resumed->IsMapped());
+    EXPECT_EQ(resumed->GetIntegrator(), planets::Integrator::Yoshida4);
+    EXPECT_EQ(resumed->GetSeed(), 5u);
+    EXPECT_DOUBLE_EQ(resumed->GetTime(), original.GetTime());
+    planets::test::ExpectSameState(*resumed, original, planetCount);
+
+    //The run goes on as if it had never stopped, and the private pages leave the file as it was
+    original.Update(0.01f, 10);
+    resumed->Update(0.01f, 10);
+    planets::test::ExpectSameState(*resumed, original, planetCount);
+    const auto again = T::LoadCheckpoint(path);
+    ASSERT_TRUE(again);
+    EXPECT_NE(again->GetPosition(0).x, resumed->GetPosition(0).x);
+
+    //Copies own their blocks
+    const auto copy = *resumed;
+    EXPECT_FALSE(copy.IsMapped());
+    planets::test::ExpectSameState(copy, *resumed, planetCount);
+    std::filesystem::remove(path);
+}
+}
+
+TEST(Checkpoint, Resume)
+{
+    planets::ThreadPool threadPool(3);
+    planets::test::ForEachPlanetSystem(threadPool, []<typename T>(planets::ThreadPool* pool) { ExpectResumes<T>(pool); });
+}
+
+TEST(Checkpoint, OtherUnroll)
+{
+    //127 blocks of 8 lanes, padded to 128 for two blocks per group: the blocks are copied
+    constexpr std::size_t planetCount = 1'009;
+    const auto path = TemporaryPath("planets_test_unroll.bin");
+    const planets::BasicPlanetSystem<8, planets::SimdBackend, 1> original(planetCount, nullptr, 3);
+    ASSERT_TRUE(original.SaveCheckpoint(path));
+    const auto resumed = planets::PlanetSystem8::LoadCheckpoint(path);
+    ASSERT_TRUE(resumed);
+    EXPECT_FALSE(resumed->IsMapped());
+    planets::test::ExpectSameState(*resumed, original, planetCount);
+    std::filesystem::remove(path);
+}
+
+TEST(Checkpoint, Attractors)
+{
+    //A binary with one moving star resumes with both stars where they were
+    constexpr std::size_t planetCount = 1'001;
+    const auto path = TemporaryPath("planets_test_attractors.bin");
+    const std::array<planets::Attractor, 2> binary{ {
+        { { planets::worldCenter.x - 0.1f, planets::worldCenter.y }, {}, 0.6f },
+        { { planets::worldCenter.x + 0.1f, planets::worldCenter.y }, { 0.0f, 0.05f }, 0.4f },
+    } };
+    planets::PlanetSystem8 original(planetCount, nullptr, 5);
+    original.SetAttractors(binary);
+    original.Update(0.01f, 10);
+    ASSERT_TRUE(original.SaveCheckpoint(path));
+
+    auto resumed = planets::PlanetSystem8::LoadCheckpoint(path);
+    ASSERT_TRUE(resumed);
+    const auto attractors = resumed->GetAttractors();
+    ASSERT_EQ(attractors.size(), 2u);
+    for (std::size_t i = 0; i < attractors.size(); i++)
+    {
+        EXPECT_EQ(attractors[i].position.x, original.GetAttractors()[i].position.x);
+        EXPECT_EQ(attractors[i].position.y, original.GetAttractors()[i].position.y);
+        EXPECT_EQ(attractors[i].velocity.y, binary[i].velocity.y);
+        EXPECT_EQ(attractors[i].mass, binary[i].mass);
+    }
+    original.Update(0.01f, 10);
+    resumed->Update(0.01f, 10);
+    planets::test::ExpectSameState(*resumed, original, planetCount);
+    std::filesystem::remove(path);
+}
+
+TEST(Checkpoint, Merges)
+{
+    //Merged planets keep their masses and the radius, so the merges after the resume match the uninterrupted run
+    constexpr std::size_t planetCount = 3'001;
+    const auto path = TemporaryPath("planets_test_merges.bin");
+    planets::PlanetSystem8 original(planetCount, nullptr, 9);
+    original.SetCollisionRadius(0.03f);
+    original.Update(0.01f);
+    ASSERT_LT(original.GetPlanetCount(), planetCount);
+    ASSERT_TRUE(original.SaveCheckpoint(path));
+
+    auto resumed = planets::PlanetSystem8::LoadCheckpoint(path);
+    ASSERT_TRUE(resumed);
+    EXPECT_EQ(resumed->GetCollisionRadius(), 0.03f);
+    ASSERT_EQ(resumed->GetPlanetCount(), original.GetPlanetCount());
+    for (int i = 0; i < 5; i++)
+    {
+        original.Update(0.01f);
+        resumed->Update(0.01f);
+    }
+    ASSERT_EQ(resumed->GetPlanetCount(), original.GetPlanetCount());
+    for (std::size_t i = 0; i < original.GetPlanetCount(); i++)
+    {
+        EXPECT_EQ(resumed->GetMass(static_cast<int>(i)), original.GetMass(static_cast<int>(i)));
+    }
+    planets::test::ExpectSameState(*resumed, original, original.GetPlanetCount());
+    std::filesystem::remove(path);
+}
+
+TEST(Checkpoint, Rejects)
+{
+    const auto path = TemporaryPath("planets_test_rejects.bin");
+    std::filesystem::remove(path);
+    EXPECT_FALSE(planets::PlanetSystem8::LoadCheckpoint(path));
+
+    const planets::PlanetSystem8 original(1'000, nullptr, 3);
+    ASSERT_TRUE(original.SaveCheckpoint(path));
+    EXPECT_FALSE(planets::PlanetSystem16::LoadCheckpoint(path));
+    EXPECT_FALSE(planets::DoublePlanetSystem8::LoadCheckpoint(path));
+    EXPECT_TRUE(planets::PlanetSystem8::LoadCheckpoint(path));
+
+    //Cut in the middle of the velocities
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 64);
+    EXPECT_FALSE(planets::OpenCheckpoint(path));
+
+    std::ofstream(path, std::ios::binary) << "not a checkpoint, only a few bytes long";
+    EXPECT_FALSE(planets::OpenCheckpoint(path));
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "circle_mesh.h"
+#include "planet.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <vector>
+
+template<typename T>
+void ExpectCircles(int planetCount, planets::ThreadPool* threadPool, int resolution = 12)
+{
+    constexpr float radius = 3.0f;
+    constexpr float scale = 100.0f;
+    const T planetSystem(planetCount);
+    //Its bits are a denormal float, which the arithmetic of -ffast-math would flush
+    const sf::Color color{ 1, 2, 3, 0 };
+    const planets::CircleMesh circleMesh(resolution, radius, color);
+    ASSERT_EQ(circleMesh.GetVertexCountPerPlanet(), 3u * static_cast<std::size_t>(resolution));
+    //Whole vertices are written, whatever was there before
+    const sf::Vertex stale{ {}, sf::Color::Black, { 0.25f, 0.75f } };
+    std::vector<sf::Vertex> vertices(planetCount * circleMesh.GetVertexCountPerPlanet(), stale);
+    circleMesh.Emit(planetSystem.GetPositions(), scale, vertices, threadPool);
+    for (const auto& vertex : vertices)
+    {
+        ASSERT_EQ(vertex.color, color);
+        ASSERT_EQ(vertex.texCoords, sf::Vector2f{});
+    }
+    for (int i = 0; i < planetCount; i++)
+    {
+        const auto center = planetSystem.GetPosition(i) * scale;
+        for (int j = 0; j < resolution; j++)
+        {
+            const auto* triangle = vertices.data() + i * 3 * resolution + j * 3;
+            EXPECT_NEAR(triangle[0].position.x, center.x, 1e-3f);
+            EXPECT_NEAR(triangle[0].position.y, center.y, 1e-3f);
+            for (int k = 1; k < 3; k++)
+            {
+                const auto dx = triangle[k].position.x - center.x;
+                const auto dy = triangle[k].position.y - center.y;
+                EXPECT_NEAR(std::sqrt(dx * dx + dy * dy), radius, 1e-3f);
+            }
+            //Consecutive triangles share their rim point
+            const auto* next = vertices.data() + i * 3 * resolution + ((j + 1) % resolution) * 3;
+            EXPECT_NEAR(triangle[2].position.x, next[1].position.x, 1e-3f);
+            EXPECT_NEAR(triangle[2].position.y, next[1].position.y, 1e-3f);
+        }
+    }
+}
+
+TEST(CircleMesh, Emit)
+{
+    //Tails that are not a multiple of the view lanes nor of the emission lanes
+    ExpectCircles<planets::PlanetSystem>(37, nullptr);
+    ExpectCircles<planets::PlanetSystem8>(37, nullptr);
+    planets::ThreadPool threadPool(3);
+    ExpectCircles<planets::PlanetSystem16>(5'003, &threadPool);
+    //A circle that is not a whole number of emission rows
+    ExpectCircles<planets::PlanetSystem8>(37, nullptr, 7);
+}
+
+TEST(CircleMesh, EmitVisible)
+{
+    constexpr int planetCount = 5'003;
+    constexpr float radius = 3.0f;
+    constexpr float scale = 100.0f;
+    //A corner of the half ring the planets start on, left of and below worldCenter, so most planets are culled
+    const sf::FloatRect bounds{ 200.0f, 250.0f, 300.0f, 200.0f };
+    planets::ThreadPool threadPool(3);
+    const planets::PlanetSystem8 planetSystem(planetCount, nullptr, 3);
+    const planets::CircleMesh circleMesh(12, radius);
+    std::vector<sf::Vertex> vertices(planetCount * circleMesh.GetVertexCountPerPlanet());
+    const auto visibleCount = circleMesh.EmitVisible(planetSystem.GetPositions(), scale, bounds, vertices, &threadPool);
+
+    std::size_t expectedCount = 0;
+    for (int i = 0; i < planetCount; i++)
+    {
+        const auto center = planetSystem.GetPosition(i) * scale;
+        if (center.x < bounds.left - radius || center.x > bounds.left + bounds.width + radius ||
+            center.y < bounds.top - radius || center.y > bounds.top + bounds.height + radius)
+        {
+            continue;
+        }
+        ASSERT_LT(expectedCount, visibleCount);
+        const auto& emittedCenter = vertices[expectedCount * circleMesh.GetVertexCountPerPlanet()].position;
+        EXPECT_NEAR(emittedCenter.x, center.x, 1e-3f);
+        EXPECT_NEAR(emittedCenter.y, center.y, 1e-3f);
+        expectedCount++;
+    }
+    EXPECT_EQ(visibleCount, expectedCount);
+    EXPECT_GT(visibleCount, 0u);
+    EXPECT_LT(visibleCount, static_cast<std::size_t>(planetCount) / 2);
+}
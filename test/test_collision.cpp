@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "collision.h"
+#include "planet.h"
+#include "planet_system_test.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace
+{
+//Nearest other planet closer than distance, ties to the lowest index, the reference for CollisionGrid
+std::vector<std::int32_t> FindNearestDirect(const std::vector<float>& blocks, std::size_t planetCount, std::size_t laneCount, float distance)
+{
+    const planets::PositionView positions(blocks.data(), planetCount, laneCount);
+    std::vector<std::int32_t> nearest(planetCount, -1);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        auto nearestSqrDistance = distance * distance;
+        for (std::size_t j = 0; j < planetCount; j++)
+        {
+            const auto dx = positions[j].x - positions[i].x;
+            const auto dy = positions[j].y - positions[i].y;
+            const auto sqrDistance = dx * dx + dy * dy;
+            if (j != i && (sqrDistance < nearestSqrDistance || (sqrDistance == nearestSqrDistance && nearest[i] < 0)))
+            {
+                nearestSqrDistance = sqrDistance;
+                nearest[i] = static_cast<std::int32_t>(j);
+            }
+        }
+    }
+    return nearest;
+}
+
+template<typename T>
+void ExpectMergesConserve(planets::ThreadPool* threadPool)
+{
+    constexpr std::size_t planetCount = 3'001;
+    constexpr float radius = 0.03f;
+    T planetSystem(planetCount, threadPool, 9);
+    planetSystem.SetCollisionRadius(radius);
+    const auto totals = [&]
+    {
+        std::array<double, 5> sums{};
+        for (std::size_t i = 0; i < planetSystem.GetPlanetCount(); i++)
+        {
+            const auto index = static_cast<int>(i);
+            const double mass = planetSystem.GetMass(index);
+            sums[0] += mass;
+            sums[1] += mass * planetSystem.GetPosition(index).x;
+            sums[2] += mass * planetSystem.GetPosition(index).y;
+            sums[3] += mass * planetSystem.GetVelocity(index).x;
+            sums[4] += mass * planetSystem.GetVelocity(index).y;
+        }
+        return sums;
+    };
+    const auto before = totals();
+    //Without dt nothing moves, only the merges change the planets
+    while (true)
+    {
+        const auto count = planetSystem.GetPlanetCount();
+        planetSystem.Update(0.0f);
+        if (planetSystem.GetPlanetCount() == count)
+        {
+            break;
+        }
+    }
+    const auto after = totals();
+    EXPECT_LT(planetSystem.GetPlanetCount(), planetCount);
+    EXPECT_EQ(planetSystem.GetPositions().GetPlanetCount(), planetSystem.GetPlanetCount());
+    for (std::size_t i = 0; i < before.size(); i++)
+    {
+        EXPECT_NEAR(after[i], before[i], std::abs(before[i]) * 1e-5 + 1e-9) << "total " << i;
+    }
+    //Nothing left touching
+    for (std::size_t i = 0; i < planetSystem.GetPlanetCount(); i++)
+    {
+        for (std::size_t j = i + 1; j < planetSystem.GetPlanetCount(); j++)
+        {
+            const auto delta = planetSystem.GetPosition(static_cast<int>(j)) - planetSystem.GetPosition(static_cast<int>(i));
+            ASSERT_GT(delta.SquareMagnitude(), 4.0f * radius * radius * 0.9999f);
+        }
+    }
+    //The planets left keep orbiting
+    const auto count = planetSystem.GetPlanetCount();
+    planetSystem.Update(0.01f);
+    EXPECT_LE(planetSystem.GetPlanetCount(), count);
+    EXPECT_TRUE(std::isfinite(planetSystem.GetEnergy()));
+}
+}
+
+TEST(Collision, NearestMatchesDirect)
+{
+    //Clumps of planets so most cells hold several, plus exact duplicates and planets far out
+    constexpr std::size_t planetCount = 2'003;
+    constexpr std::size_t laneCount = 8;
+    const std::size_t blockCount = (planetCount + laneCount - 1) / laneCount;
+    std::vector<float> blocks(blockCount * 2 * laneCount, 0.0f);
+    std::mt19937 rng(3);
+    std::normal_distribution<float> clump(0.0f, 0.05f);
+    std::uniform_int_distribution<int> clumpIndex(0, 40);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto center = static_cast<float>(clumpIndex(rng));
+        auto& x = blocks[i / laneCount * 2 * laneCount + i % laneCount];
+        auto& y = blocks[i / laneCount * 2 * laneCount + laneCount + i % laneCount];
+        x = center * 0.3f + clump(rng);
+        y = center * -0.2f + clump(rng);
+        if (i % 97 == 0)
+        {
+            x = y = 1.0e9f;
+        }
+    }
+    //Planet 0 on top of planet 2
+    blocks[0] = blocks[2];
+    blocks[laneCount] = blocks[laneCount + 2];
+
+    constexpr float distance = 0.02f;
+    const auto expected = FindNearestDirect(blocks, planetCount, laneCount, distance);
+    const planets::PositionView positions(blocks.data(), planetCount, laneCount);
+    planets::ThreadPool threadPool(4);
+    for (auto* pool : { static_cast<planets::ThreadPool*>(nullptr), &threadPool })
+    {
+        planets::CollisionGrid grid;
+        const auto contactCount = grid.FindNearest(positions, distance, pool);
+        const auto nearest = grid.GetNearest();
+        ASSERT_EQ(nearest.size(), planetCount);
+        std::size_t expectedContacts = 0;
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            EXPECT_EQ(nearest[i], expected[i]) << "planet " << i;
+            expectedContacts += expected[i] >= 0;
+        }
+        EXPECT_EQ(contactCount, expectedContacts);
+        EXPECT_GT(contactCount, 0u);
+    }
+    EXPECT_EQ(expected[0], 2);
+}
+
+TEST(Collision, Merge)
+{
+    planets::ThreadPool threadPool(4);
+    planets::test::ForEachPlanetSystem(threadPool, []<typename T>(planets::ThreadPool* pool) { ExpectMergesConserve<T>(pool); });
+
+    //Off by default
+    planets::PlanetSystem8 planetSystem(3'001, nullptr, 9);
+    planetSystem.Update(0.0f);
+    EXPECT_EQ(planetSystem.GetPlanetCount(), 3'001u);
+    EXPECT_FLOAT_EQ(planetSystem.GetMass(0), planets::planetMass);
+}
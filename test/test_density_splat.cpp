@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "density_splat.h"
+#include "planet.h"
+#include "thread_pool.h"
+
+#include <numeric>
+#include <vector>
+
+template<typename T>
+void ExpectDensity(int planetCount, const sf::FloatRect& bounds, planets::ThreadPool* threadPool)
+{
+    constexpr unsigned width = 64;
+    constexpr unsigned height = 48;
+    constexpr float scale = 100.0f;
+    const T planetSystem(planetCount);
+    planets::DensitySplat densitySplat(width, height);
+    densitySplat.Accumulate(planetSystem.GetPositions(), scale, bounds, threadPool);
+
+    std::vector<std::uint32_t> expectedCounts(width * height, 0);
+    for (int i = 0; i < planetCount; i++)
+    {
+        const auto position = planetSystem.GetPosition(i) * scale;
+        const auto x = (position.x - bounds.left) * static_cast<float>(width) / bounds.width;
+        const auto y = (position.y - bounds.top) * static_cast<float>(height) / bounds.height;
+        if (x < 0.0f || x >= static_cast<float>(width) || y < 0.0f || y >= static_cast<float>(height))
+        {
+            continue;
+        }
+        expectedCounts[static_cast<std::size_t>(y) * width + static_cast<std::size_t>(x)]++;
+    }
+    const auto& counts = densitySplat.GetCounts();
+    ASSERT_EQ(counts.size(), expectedCounts.size());
+    //Planets right on a pixel edge may round to the neighbour, the totals must still match
+    EXPECT_EQ(std::accumulate(counts.begin(), counts.end(), 0u), std::accumulate(expectedCounts.begin(), expectedCounts.end(), 0u));
+    std::size_t mismatches = 0;
+    for (std::size_t pixel = 0; pixel < counts.size(); pixel++)
+    {
+        mismatches += counts[pixel] != expectedCounts[pixel];
+    }
+    EXPECT_LE(mismatches, 2u);
+}
+
+TEST(DensitySplat, Accumulate)
+{
+    const auto center = planets::worldCenter * 100.0f;
+    const auto extent = planets::outerRaidus * 100.0f;
+    //Whole ring, then a corner of it so most planets fall outside
+    const sf::FloatRect ring{ center.x - extent, center.y - extent, 2.0f * extent, 2.0f * extent };
+    const sf::FloatRect corner{ 500.0f, 250.0f, 300.0f, 200.0f };
+    ExpectDensity<planets::PlanetSystem>(37, ring, nullptr);
+    ExpectDensity<planets::PlanetSystem8>(5'003, corner, nullptr);
+    planets::ThreadPool threadPool(3);
+    ExpectDensity<planets::PlanetSystem16>(5'003, ring, &threadPool);
+    ExpectDensity<planets::PlanetSystem4>(5'003, corner, &threadPool);
+}
+
+TEST(DensitySplat, Shade)
+{
+    constexpr unsigned width = 16;
+    constexpr unsigned height = 8;
+    const planets::PlanetSystem8 planetSystem(1'000);
+    planets::DensitySplat densitySplat(width, height);
+    const auto center = planets::worldCenter * 100.0f;
+    const auto extent = planets::outerRaidus * 100.0f;
+    densitySplat.Accumulate(planetSystem.GetPositions(), 100.0f, { center.x - extent, center.y - extent, 2.0f * extent, 2.0f * extent });
+    densitySplat.Shade(sf::Color::Blue);
+    const auto& counts = densitySplat.GetCounts();
+    const auto* pixels = densitySplat.GetPixels();
+    for (std::size_t pixel = 0; pixel < counts.size(); pixel++)
+    {
+        EXPECT_EQ(pixels[pixel * 4 + 2], 255);
+        //Empty pixels stay transparent, the others get more opaque with their count
+        EXPECT_EQ(pixels[pixel * 4 + 3] == 0, counts[pixel] == 0);
+        for (std::size_t other = 0; other < counts.size(); other++)
+        {
+            if (counts[other] > counts[pixel])
+            {
+                EXPECT_GE(pixels[other * 4 + 3], pixels[pixel * 4 + 3]);
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+#include "dispatch.h"
+
+#include <cmath>
+#include <vector>
+
+TEST(Dispatch, ParseIsa)
+{
+    EXPECT_EQ(planets::ParseIsa("sse"), planets::Isa::Sse);
+    EXPECT_EQ(planets::ParseIsa("avx2"), planets::Isa::Avx2);
+    EXPECT_EQ(planets::ParseIsa("avx512"), planets::Isa::Avx512);
+    EXPECT_FALSE(planets::ParseIsa("neon").has_value());
+    for (const auto isa : { planets::Isa::Sse, planets::Isa::Avx2, planets::Isa::Avx512 })
+    {
+        EXPECT_EQ(planets::ParseIsa(planets::GetIsaName(isa)), isa);
+    }
+}
+
+TEST(Dispatch, SelectIsaOverride)
+{
+    const auto detected = planets::DetectIsa();
+    char program[] = "planets";
+    char lower[] = "--isa=sse";
+    char* lowerArgs[] = { program, lower };
+    EXPECT_EQ(planets::SelectIsa(2, lowerArgs), planets::Isa::Sse);
+
+    char higher[] = "--isa=avx512";
+    char* higherArgs[] = { program, higher };
+    EXPECT_EQ(planets::SelectIsa(2, higherArgs), detected);
+}
+
+TEST(Dispatch, SupportedKernelsUpdate)
+{
+    constexpr std::size_t planetCount = 37;
+    const auto detected = planets::DetectIsa();
+    for (const auto isa : { planets::Isa::Sse, planets::Isa::Avx2, planets::Isa::Avx512 })
+    {
+        if (isa > detected)
+        {
+            continue;
+        }
+        for (const int width : { 1, 4, 8, 16 })
+        {
+            const auto planetSystem = planets::CreatePlanetSystem(isa, width, planetCount);
+            ASSERT_NE(planetSystem, nullptr);
+            for (int step = 0; step < 10; step++)
+            {
+                planetSystem->Update(0.01f);
+            }
+            for (int i = 0; i < static_cast<int>(planetCount); i++)
+            {
+                const auto position = planetSystem->GetPosition(i);
+                EXPECT_LT(std::abs(position.x), 100.0f);
+                EXPECT_LT(std::abs(position.y), 100.0f);
+            }
+        }
+    }
+    EXPECT_EQ(planets::CreatePlanetSystem(planets::Isa::Sse, 3, planetCount), nullptr);
+}
+
+TEST(Dispatch, BulkPositions)
+{
+    constexpr std::size_t planetCount = 37;
+    constexpr float scale = 100.0f;
+    const auto isa = planets::DetectIsa();
+    for (const int width : { 1, 4, 8, 16 })
+    {
+        const auto planetSystem = planets::CreatePlanetSystem(isa, width, planetCount);
+        planetSystem->Update(0.01f);
+        const auto view = planetSystem->GetPositions();
+        EXPECT_EQ(view.GetPlanetCount(), planetCount);
+        EXPECT_EQ(view.GetLaneCount(), static_cast<std::size_t>(width));
+        std::vector<sf::Vector2f> positions(planetCount);
+        planetSystem->WritePositions(positions, scale);
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            const auto position = planetSystem->GetPosition(static_cast<int>(i));
+            EXPECT_EQ(view[i], position);
+            EXPECT_EQ(view.Xs(i / width)[i % width], position.x);
+            EXPECT_FLOAT_EQ(positions[i].x, position.x * scale);
+            EXPECT_FLOAT_EQ(positions[i].y, position.y * scale);
+        }
+    }
+}
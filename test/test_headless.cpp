@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+
+#include "headless.h"
+
+#include <array>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+
+TEST(Headless, ParseOptions)
+{
+    std::ostringstream errors;
+    std::array windowed{ const_cast<char*>("planets"), const_cast<char*>("--planets=100") };
+    EXPECT_FALSE(planets::ParseHeadlessOptions(static_cast<int>(windowed.size()), windowed.data(), planets::Isa::Avx2, errors));
+
+    std::array arguments{ const_cast<char*>("planets"), const_cast<char*>("--headless"), const_cast<char*>("--planets=2048"),
+        const_cast<char*>("--backend=4"), const_cast<char*>("--steps=50"), const_cast<char*>("--dt=0.01"),
+        const_cast<char*>("--threads=2"), const_cast<char*>("--isa=sse"), const_cast<char*>("--seed=42"), const_cast<char*>("--collisions") };
+    const auto options = planets::ParseHeadlessOptions(static_cast<int>(arguments.size()), arguments.data(), planets::Isa::Avx2, errors);
+    ASSERT_TRUE(options);
+    EXPECT_EQ(options->planetCount, 2048u);
+    EXPECT_EQ(options->width, 4);
+    EXPECT_EQ(options->steps, 50);
+    EXPECT_FLOAT_EQ(options->dt, 0.01f);
+    EXPECT_EQ(options->threadCount, 2u);
+    EXPECT_EQ(options->seed, 42u);
+    EXPECT_TRUE(options->collisions);
+    EXPECT_TRUE(errors.str().empty());
+
+    std::array invalid{ const_cast<char*>("planets"), const_cast<char*>("--headless"), const_cast<char*>("--backend=3"),
+        const_cast<char*>("--steps=ten"), const_cast<char*>("--dt=-1") };
+    const auto defaults = planets::ParseHeadlessOptions(static_cast<int>(invalid.size()), invalid.data(), planets::Isa::Avx2, errors);
+    ASSERT_TRUE(defaults);
+    EXPECT_EQ(defaults->width, planets::GetLaneWidth(planets::Isa::Avx2));
+    EXPECT_EQ(defaults->steps, planets::HeadlessOptions{}.steps);
+    EXPECT_FLOAT_EQ(defaults->dt, planets::HeadlessOptions{}.dt);
+    EXPECT_FALSE(defaults->seed);
+    EXPECT_FALSE(defaults->collisions);
+    EXPECT_NE(errors.str().find("--backend=3"), std::string::npos);
+    EXPECT_NE(errors.str().find("--steps=ten"), std::string::npos);
+    EXPECT_NE(errors.str().find("--dt=-1"), std::string::npos);
+    EXPECT_TRUE(defaults->invalidOptions);
+
+    //A valid count with a bad format must not benchmark the default planet count
+    std::ostringstream formatErrors;
+    std::array badFormat{ const_cast<char*>("planets"), const_cast<char*>("--headless"), const_cast<char*>("--planets=1e6") };
+    const auto badPlanets = planets::ParseHeadlessOptions(static_cast<int>(badFormat.size()), badFormat.data(), planets::Isa::Avx2, formatErrors);
+    ASSERT_TRUE(badPlanets);
+    EXPECT_TRUE(badPlanets->invalidOptions);
+    EXPECT_NE(formatErrors.str().find("--planets=1e6"), std::string::npos);
+
+    //Misspelled options are reported, not run with the defaults
+    std::ostringstream unknownErrors;
+    std::array unknown{ const_cast<char*>("planets"), const_cast<char*>("--step=10"), const_cast<char*>("--headless"),
+        const_cast<char*>("--colisions"), const_cast<char*>("--steps=10") };
+    const auto misspelled = planets::ParseHeadlessOptions(static_cast<int>(unknown.size()), unknown.data(), planets::Isa::Avx2, unknownErrors);
+    ASSERT_TRUE(misspelled);
+    EXPECT_TRUE(misspelled->invalidOptions);
+    EXPECT_EQ(misspelled->steps, 10);
+    EXPECT_NE(unknownErrors.str().find("--step=10"), std::string::npos);
+    EXPECT_NE(unknownErrors.str().find("--colisions"), std::string::npos);
+    EXPECT_FALSE(options->invalidOptions);
+}
+
+TEST(Headless, Percentile)
+{
+    std::vector<double> samples{ 5.0, 1.0, 4.0, 2.0, 3.0, 10.0, 9.0, 8.0, 7.0, 6.0 };
+    EXPECT_DOUBLE_EQ(planets::Percentile(samples, 50.0), 5.0);
+    EXPECT_DOUBLE_EQ(planets::Percentile(samples, 90.0), 9.0);
+    EXPECT_DOUBLE_EQ(planets::Percentile(samples, 99.0), 10.0);
+    EXPECT_DOUBLE_EQ(planets::Percentile(samples, 100.0), 10.0);
+    EXPECT_DOUBLE_EQ(planets::Percentile(samples, 0.0), 1.0);
+    EXPECT_DOUBLE_EQ(planets::Percentile({}, 50.0), 0.0);
+}
+
+TEST(Headless, Run)
+{
+    planets::HeadlessOptions options;
+    options.planetCount = 1'000;
+    options.width = 8;
+    options.steps = 5;
+    options.warmupSteps = 1;
+    options.threadCount = 2;
+    std::ostringstream output;
+    EXPECT_EQ(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+    for (const auto* stage : { "update", "emit", "frame" })
+    {
+        EXPECT_NE(output.str().find(stage), std::string::npos);
+    }
+    options.width = 3;
+    EXPECT_NE(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+
+    //The initial positions and every step, warmup included
+    options.width = 8;
+    options.record = std::filesystem::temp_directory_path() / "planets_test_headless_trajectory.bin";
+    EXPECT_EQ(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+    EXPECT_NE(output.str().find("record"), std::string::npos);
+    EXPECT_NE(output.str().find("Recorded 7 frames"), std::string::npos);
+    std::filesystem::remove(options.record);
+    options.record.clear();
+
+    options.collisions = true;
+    EXPECT_EQ(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+    EXPECT_NE(output.str().find("planets left after merging"), std::string::npos);
+    options.collisions = false;
+
+    //Saved by one run and picked up by the next, with the width of the file
+    options.checkpoint = std::filesystem::temp_directory_path() / "planets_test_headless.bin";
+    options.width = 4;
+    EXPECT_EQ(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+    options.resume = options.checkpoint;
+    options.width = 3;
+    EXPECT_EQ(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+    EXPECT_NE(output.str().find("width 4"), std::string::npos);
+    std::filesystem::remove(options.checkpoint);
+    EXPECT_NE(planets::RunHeadless(options, planets::Isa::Sse, output), 0);
+}
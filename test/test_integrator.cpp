@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include "planet.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+template<typename T>
+double RelativeEnergyDrift(planets::Integrator integrator, float dt, int steps)
+{
+    T planetSystem(1'000, nullptr, 1);
+    planetSystem.SetIntegrator(integrator);
+    const auto initialEnergy = planetSystem.GetEnergy();
+    for (int i = 0; i < steps; i++)
+    {
+        planetSystem.Update(dt);
+    }
+    return std::abs(planetSystem.GetEnergy() - initialEnergy) / std::abs(initialEnergy);
+}
+
+template<typename T>
+void ExpectOrder()
+{
+    //One simulated second, close to the period of the innermost orbits
+    constexpr float dt = 1.0f / 100.0f;
+    constexpr int steps = 100;
+    const auto euler = RelativeEnergyDrift<T>(planets::Integrator::Euler, dt, steps);
+    const auto leapfrog = RelativeEnergyDrift<T>(planets::Integrator::Leapfrog, dt, steps);
+    const auto verlet = RelativeEnergyDrift<T>(planets::Integrator::VelocityVerlet, dt, steps);
+    const auto yoshida = RelativeEnergyDrift<T>(planets::Integrator::Yoshida4, dt, steps);
+    EXPECT_LT(leapfrog, euler / 10.0);
+    EXPECT_LT(verlet, euler / 5.0);
+    EXPECT_LT(yoshida, leapfrog / 10.0);
+    //Four times the step still beats Euler
+    EXPECT_LT(RelativeEnergyDrift<T>(planets::Integrator::Yoshida4, 4.0f * dt, steps / 4), euler);
+}
+
+//Largest relative error of CalculateGravity against double over radii spanning the initial disk
+template<planets::GravityAccuracy Accuracy, int N>
+double GravityError()
+{
+    double maxError = 0.0;
+    std::array<planets::Vec2f, N> deltas{};
+    for (int i = 0; i < 4096; i += N)
+    {
+        for (int lane = 0; lane < N; lane++)
+        {
+            const auto angle = 0.1f * static_cast<float>(i + lane);
+            const auto radius = 0.25f + 0.002f * static_cast<float>(i + lane);
+            deltas[lane] = planets::Vec2f{ radius, 0.0f }.Rotate(angle);
+        }
+        std::array<planets::Vec2f, N> gravities{};
+        if constexpr (N == 1)
+        {
+            gravities[0] = planets::CalculateGravity<Accuracy>(deltas[0]);
+        }
+        else
+        {
+            const auto gravity = planets::CalculateGravity<Accuracy>(planets::NVec2f<N>(deltas.data()));
+            for (int lane = 0; lane < N; lane++)
+            {
+                gravities[lane] = { gravity.Xs()[lane], gravity.Ys()[lane] };
+            }
+        }
+        for (int lane = 0; lane < N; lane++)
+        {
+            const auto x = static_cast<double>(deltas[lane].x);
+            const auto y = static_cast<double>(deltas[lane].y);
+            const auto sqrRadius = x * x + y * y;
+            const auto expected = -static_cast<double>(planets::G) / (sqrRadius * std::sqrt(sqrRadius));
+            maxError = std::max(maxError, std::abs(static_cast<double>(gravities[lane].x) - expected * x) / (std::abs(expected) * std::sqrt(sqrRadius)));
+            maxError = std::max(maxError, std::abs(static_cast<double>(gravities[lane].y) - expected * y) / (std::abs(expected) * std::sqrt(sqrRadius)));
+        }
+    }
+    return maxError;
+}
+
+template<int N>
+void ExpectGravityTiers()
+{
+    //The estimate is good to 1.5 * 2^-12, tripled by the cube
+    EXPECT_LT((GravityError<planets::GravityAccuracy::Estimate, N>()), 1.5e-3);
+    EXPECT_LT((GravityError<planets::GravityAccuracy::Refined, N>()), 2e-6);
+    EXPECT_LT((GravityError<planets::GravityAccuracy::Exact, N>()), 1e-6);
+}
+
+//Update(dt, steps) only reorders the loops, every lane goes through the same operations
+template<typename T>
+void ExpectMultiStepMatches(planets::ThreadPool* threadPool)
+{
+    constexpr std::size_t planetCount = 1'001;
+    constexpr float dt = 1.0f / 120.0f;
+    for (const auto integrator : { planets::Integrator::Euler, planets::Integrator::Leapfrog,
+        planets::Integrator::VelocityVerlet, planets::Integrator::Yoshida4 })
+    {
+        T multiStep(planetCount, threadPool);
+        multiStep.SetIntegrator(integrator);
+        auto singleStep = multiStep;
+        multiStep.Update(dt, 7);
+        multiStep.Update(dt, 1);
+        for (int i = 0; i < 8; i++)
+        {
+            singleStep.Update(dt);
+        }
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            const auto position = multiStep.GetPosition(static_cast<int>(i));
+            const auto expected = singleStep.GetPosition(static_cast<int>(i));
+            EXPECT_EQ(position.x, expected.x);
+            EXPECT_EQ(position.y, expected.y);
+        }
+    }
+}
+}
+
+TEST(Integrator, EnergyDrift)
+{
+    ExpectOrder<planets::PlanetSystem>();
+    ExpectOrder<planets::PlanetSystem4>();
+    ExpectOrder<planets::PlanetSystem8>();
+    ExpectOrder<planets::PlanetSystem16>();
+    ExpectOrder<planets::DoublePlanetSystem4>();
+    ExpectOrder<planets::DoublePlanetSystem8>();
+}
+
+TEST(Integrator, DoublePrecision)
+{
+    //With fine steps the float error is rounding, which the double lanes remove
+    constexpr float dt = 1.0f / 400.0f;
+    constexpr int steps = 400;
+    const auto single = RelativeEnergyDrift<planets::PlanetSystem8>(planets::Integrator::Yoshida4, dt, steps);
+    const auto double4 = RelativeEnergyDrift<planets::DoublePlanetSystem4>(planets::Integrator::Yoshida4, dt, steps);
+    const auto double8 = RelativeEnergyDrift<planets::DoublePlanetSystem8>(planets::Integrator::Yoshida4, dt, steps);
+    EXPECT_LT(double4, single / 100.0);
+    EXPECT_LT(double8, single / 100.0);
+
+    planets::DoublePlanetSystem8 planetSystem(1'001);
+    planetSystem.Update(dt, 10);
+    const auto positions = planetSystem.GetPositions();
+    for (std::size_t i = 0; i < 1'001; i++)
+    {
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        EXPECT_EQ(positions[i].x, position.x);
+        EXPECT_EQ(positions[i].y, position.y);
+    }
+}
+
+TEST(Gravity, AccuracyTiers)
+{
+    ExpectGravityTiers<1>();
+    ExpectGravityTiers<4>();
+    ExpectGravityTiers<8>();
+    ExpectGravityTiers<16>();
+}
+
+TEST(Integrator, VerletAfterSwitch)
+{
+    //The cached accelerations must follow the positions reached with another integrator
+    planets::PlanetSystem8 switched(1'000);
+    const auto initialEnergy = switched.GetEnergy();
+    switched.SetIntegrator(planets::Integrator::Yoshida4);
+    for (int i = 0; i < 50; i++)
+    {
+        switched.Update(0.01f);
+    }
+    switched.SetIntegrator(planets::Integrator::VelocityVerlet);
+    for (int i = 0; i < 50; i++)
+    {
+        switched.Update(0.01f);
+    }
+    EXPECT_LT(std::abs(switched.GetEnergy() - initialEnergy) / std::abs(initialEnergy), 1e-3);
+}
+
+TEST(Integrator, MultiStep)
+{
+    ExpectMultiStepMatches<planets::PlanetSystem>(nullptr);
+    ExpectMultiStepMatches<planets::PlanetSystem4>(nullptr);
+    planets::ThreadPool threadPool(3);
+    ExpectMultiStepMatches<planets::PlanetSystem8>(&threadPool);
+    ExpectMultiStepMatches<planets::PlanetSystem16>(&threadPool);
+    ExpectMultiStepMatches<planets::DoublePlanetSystem4>(nullptr);
+    ExpectMultiStepMatches<planets::DoublePlanetSystem8>(&threadPool);
+}
+
+TEST(Integrator, Names)
+{
+    for (const auto integrator : { planets::Integrator::Euler, planets::Integrator::Leapfrog,
+        planets::Integrator::VelocityVerlet, planets::Integrator::Yoshida4 })
+    {
+        EXPECT_EQ(planets::ParseIntegrator(planets::GetIntegratorName(integrator)), integrator);
+    }
+    EXPECT_FALSE(planets::ParseIntegrator("rk4"));
+}
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include "kepler.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <vector>
+
+namespace
+{
+//Leapfrog in double with a substep far under the float precision of the solver
+struct ReferencePlanet
+{
+    double x, y, vx, vy;
+
+    void Integrate(double time)
+    {
+        constexpr double substep = 1e-5;
+        const auto substepCount = static_cast<int>(std::ceil(std::abs(time) / substep));
+        const auto h = time / substepCount;
+        for (int i = 0; i < substepCount; i++)
+        {
+            x += vx * (0.5 * h);
+            y += vy * (0.5 * h);
+            const auto dx = x - planets::worldCenter.x;
+            const auto dy = y - planets::worldCenter.y;
+            const auto sqrRadius = dx * dx + dy * dy;
+            const auto factor = -planets::G / (sqrRadius * std::sqrt(sqrRadius)) * h;
+            vx += dx * factor;
+            vy += dy * factor;
+            x += vx * (0.5 * h);
+            y += vy * (0.5 * h);
+        }
+    }
+
+    //Of the exact orbit, infinite for the unbound ones
+    [[nodiscard]] double GetPeriod() const
+    {
+        const auto energy = 0.5 * (vx * vx + vy * vy) - planets::G / std::hypot(x - planets::worldCenter.x, y - planets::worldCenter.y);
+        if (energy >= 0.0)
+        {
+            return std::numeric_limits<double>::infinity();
+        }
+        const auto semiMajorAxis = -planets::G / (2.0 * energy);
+        return 2.0 * std::numbers::pi * std::sqrt(semiMajorAxis * semiMajorAxis * semiMajorAxis / planets::G);
+    }
+};
+
+//Planets as the systems start them, at radii around the parabolic one of 2 and a few arbitrary velocities
+void MakePlanets(std::vector<planets::Vec2f>& positions, std::vector<planets::Vec2f>& velocities)
+{
+    const float radii[] = { 1.5f, 1.7f, 1.9f, 1.99f, 1.999f, 1.9999f, 2.0f, 2.0001f, 2.001f, 2.01f, 2.1f, 3.0f, 4.5f, 5.5f };
+    for (const auto radius : radii)
+    {
+        for (int i = 0; i < 5; i++)
+        {
+            const auto v = planets::Vec2f::up().Rotate(0.6f * static_cast<float>(i)) * radius;
+            positions.push_back(v + planets::worldCenter);
+            velocities.push_back(v.Perpendicular().Normalized() * std::sqrt(planets::CalculateAcceleration(radius) * radius));
+        }
+    }
+    //Inclined and retrograde ones
+    positions.push_back(planets::worldCenter + planets::Vec2f{ 2.5f, 0.5f });
+    velocities.push_back({ -1.0f, -5.0f });
+    positions.push_back(planets::worldCenter + planets::Vec2f{ -1.0f, 3.0f });
+    velocities.push_back({ 4.0f, 6.0f });
+    positions.push_back(planets::worldCenter + planets::Vec2f{ 0.0f, -4.0f });
+    velocities.push_back({ -8.0f, 1.0f });
+}
+
+
+//Backwards, a few orbits ahead, and jumps over thousands of orbits that a float phase n t could not resolve
+constexpr std::array<double, 8> referenceTimes{ 0.0, 0.05, 1.0, -1.0, 10.0, 1000.0, -1000.0, 1e5 };
+
+//Reference positions of MakePlanets at every referenceTimes, integrated once for all the widths. Far jumps are
+//integrated over what is left of the time after whole orbits, so only the short orbits get one there.
+const std::vector<std::vector<std::optional<ReferencePlanet>>>& GetReferences()
+{
+    static const auto references = []
+    {
+        std::vector<planets::Vec2f> positions, velocities;
+        MakePlanets(positions, velocities);
+        std::vector<std::vector<std::optional<ReferencePlanet>>> result;
+        for (const auto time : referenceTimes)
+        {
+            auto& planets = result.emplace_back(positions.size());
+            for (std::size_t i = 0; i < positions.size(); i++)
+            {
+                ReferencePlanet reference{ positions[i].x, positions[i].y, velocities[i].x, velocities[i].y };
+                const auto integrated = std::abs(time) <= 10.0 ? time : std::remainder(time, reference.GetPeriod());
+                if (std::abs(integrated) <= 10.0)
+                {
+                    reference.Integrate(integrated);
+                    planets[i] = reference;
+                }
+            }
+        }
+        return result;
+    }();
+    return references;
+}
+
+template<int N>
+void ExpectMatchesReference(planets::ThreadPool* threadPool)
+{
+    std::vector<planets::Vec2f> positions, velocities;
+    MakePlanets(positions, velocities);
+    planets::KeplerSystem<N> planetSystem(positions, velocities, threadPool);
+    const auto& references = GetReferences();
+    for (std::size_t t = 0; t < referenceTimes.size(); t++)
+    {
+        planetSystem.SetTime(referenceTimes[t]);
+        double maxError = 0.0;
+        std::size_t checkedCount = 0;
+        for (std::size_t i = 0; i < positions.size(); i++)
+        {
+            const auto& reference = references[t][i];
+            if (!reference)
+            {
+                continue;
+            }
+            const auto position = planetSystem.GetPosition(static_cast<int>(i));
+            const auto error = std::hypot(position.x - reference->x, position.y - reference->y);
+            const auto radius = std::hypot(reference->x - planets::worldCenter.x, reference->y - planets::worldCenter.y);
+            maxError = std::max(maxError, error / radius);
+            checkedCount++;
+        }
+        EXPECT_LT(maxError, 1e-5) << "at time " << referenceTimes[t];
+        EXPECT_GT(checkedCount, 10u) << "at time " << referenceTimes[t];
+    }
+}
+}
+
+TEST(Kepler, MatchesReference)
+{
+    ExpectMatchesReference<4>(nullptr);
+    ExpectMatchesReference<8>(nullptr);
+    planets::ThreadPool threadPool(3);
+    ExpectMatchesReference<16>(&threadPool);
+}
+
+TEST(Kepler, Scrubbing)
+{
+    constexpr std::size_t planetCount = 1'001;
+    planets::KeplerSystem8 planetSystem(planetCount);
+    std::vector<planets::Vec2f> start(planetCount);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        start[i] = planetSystem.GetPosition(static_cast<int>(i));
+    }
+    planetSystem.Update(1.0f / 60.0f);
+    planetSystem.SetTime(1000.0);
+    for (std::size_t i = 0; i < planetCount; i += 97)
+    {
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        const auto computed = planetSystem.ComputePosition(static_cast<int>(i), 1000.0);
+        EXPECT_EQ(computed.x, position.x);
+        EXPECT_EQ(computed.y, position.y);
+        EXPECT_TRUE(std::isfinite(position.x) && std::isfinite(position.y));
+    }
+    //Nothing accumulates, going back gives the start again
+    planetSystem.SetTime(0.0);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto position = planetSystem.GetPosition(static_cast<int>(i));
+        EXPECT_EQ(position.x, start[i].x);
+        EXPECT_EQ(position.y, start[i].y);
+    }
+    EXPECT_EQ(planetSystem.GetPositions().GetPlanetCount(), planetCount);
+}
@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "barnes_hut.h"
+#include "nbody.h"
+#include "thread_pool.h"
+
+#include <vector>
+
+namespace
+{
+std::vector<planets::Vec2f> DirectAccelerations(const planets::BarnesHutSystem& system, int planetCount)
+{
+    std::vector<planets::Vec2f> positions(planetCount);
+    for (int i = 0; i < planetCount; i++)
+    {
+        positions[i] = system.GetPosition(i);
+    }
+    return planets::ComputeDirectAccelerations(positions);
+}
+
+template<typename T>
+void ExpectScalarSum(const T& system, int planetCount)
+{
+    for (int i = 0; i < planetCount; i++)
+    {
+        const auto target = system.GetPosition(i);
+        planets::Vec2f reference{};
+        for (int j = 0; j < planetCount; j++)
+        {
+            const auto delta = system.GetPosition(j) - target;
+            const auto sqrDistance = delta.SquareMagnitude() + planets::gravitySoftening * planets::gravitySoftening;
+            reference += delta * (planets::G * planets::planetMass / (sqrDistance * std::sqrt(sqrDistance)));
+        }
+        const auto acceleration = system.GetMutualAcceleration(i);
+        const auto tolerance = 1e-3f * reference.Magnitude() + 1e-6f;
+        EXPECT_NEAR(acceleration.x, reference.x, tolerance);
+        EXPECT_NEAR(acceleration.y, reference.y, tolerance);
+    }
+}
+}
+
+TEST(DirectSum, MatchesScalarSum)
+{
+    //Not a multiple of the tile so the padding lanes are exercised
+    constexpr int planetCount = 203;
+    planets::DirectSumSystem4 system4(planetCount);
+    system4.ComputeMutualAccelerations();
+    ExpectScalarSum(system4, planetCount);
+
+    planets::DirectSumSystem8 system8(planetCount);
+    system8.ComputeMutualAccelerations();
+    ExpectScalarSum(system8, planetCount);
+
+    planets::ThreadPool threadPool(3);
+    planets::DirectSumSystem16 system16(planetCount, &threadPool);
+    system16.ComputeMutualAccelerations();
+    ExpectScalarSum(system16, planetCount);
+}
+
+TEST(BarnesHut, TreeMass)
+{
+    constexpr int planetCount = 5'000;
+    planets::BarnesHutSystem system(planetCount);
+    system.ComputeMutualAccelerations();
+    const auto& root = system.GetQuads().front();
+    float mass = 0.0f;
+    for (int lane = 0; lane < 4; lane++)
+    {
+        mass += root.masses[lane];
+    }
+    EXPECT_NEAR(mass, planetCount * planets::planetMass, 1e-5f);
+}
+
+TEST(BarnesHut, ZeroOpeningAngleIsExact)
+{
+    constexpr int planetCount = 1'000;
+    planets::BarnesHutSystem system(planetCount, 0.0f);
+    system.ComputeMutualAccelerations();
+    ExpectScalarSum(system, planetCount);
+}
+
+TEST(BarnesHut, OpeningAngleError)
+{
+    constexpr int planetCount = 4'000;
+    planets::ThreadPool threadPool(4);
+    planets::BarnesHutSystem system(planetCount, 0.5f, &threadPool);
+    system.ComputeMutualAccelerations();
+    const auto reference = DirectAccelerations(system, planetCount);
+    float errorSum = 0.0f, magnitudeSum = 0.0f;
+    for (int i = 0; i < planetCount; i++)
+    {
+        errorSum += (system.GetMutualAcceleration(i) - reference[i]).Magnitude();
+        magnitudeSum += reference[i].Magnitude();
+    }
+    EXPECT_LT(errorSum / magnitudeSum, 0.01f);
+}
+
+TEST(BarnesHut, PlanetIdsSurviveSorting)
+{
+    constexpr int planetCount = 40'000;
+    planets::BarnesHutSystem system(planetCount);
+    std::vector<planets::Vec2f> before(planetCount);
+    for (int i = 0; i < planetCount; i++)
+    {
+        before[i] = system.GetPosition(i);
+    }
+    system.ComputeMutualAccelerations();
+    for (int i = 0; i < planetCount; i++)
+    {
+        EXPECT_FLOAT_EQ(before[i].x, system.GetPosition(i).x);
+        EXPECT_FLOAT_EQ(before[i].y, system.GetPosition(i).y);
+    }
+}
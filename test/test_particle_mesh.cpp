@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+
+#include "fft.h"
+#include "nbody.h"
+#include "particle_mesh.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+TEST(Fft, MatchesDft)
+{
+    constexpr std::size_t size = 64;
+    std::vector<std::complex<float>> data(size);
+    for (std::size_t i = 0; i < size; i++)
+    {
+        data[i] = { std::sin(0.3f * static_cast<float>(i)), static_cast<float>(i % 7) - 3.0f };
+    }
+    auto transformed = data;
+    const planets::Fft fft(size);
+    fft.Forward(transformed.data());
+    for (std::size_t k = 0; k < size; k++)
+    {
+        std::complex<double> reference{};
+        for (std::size_t i = 0; i < size; i++)
+        {
+            const auto angle = -2.0 * std::numbers::pi * static_cast<double>(i * k) / static_cast<double>(size);
+            reference += std::complex<double>(data[i]) * std::polar(1.0, angle);
+        }
+        EXPECT_NEAR(transformed[k].real(), reference.real(), 1e-3);
+        EXPECT_NEAR(transformed[k].imag(), reference.imag(), 1e-3);
+    }
+    fft.Inverse(transformed.data());
+    for (std::size_t i = 0; i < size; i++)
+    {
+        EXPECT_NEAR(transformed[i].real() / size, data[i].real(), 1e-5);
+        EXPECT_NEAR(transformed[i].imag() / size, data[i].imag(), 1e-5);
+    }
+}
+
+TEST(ParticleMesh, MatchesDirectSum)
+{
+    //Sparse enough that most of the pull comes from farther than a few cells, the mesh smooths the close pairs
+    constexpr int planetCount = 256;
+    planets::ThreadPool threadPool(4);
+    planets::ParticleMeshSystem system(planetCount, 512, &threadPool);
+    system.ComputeMutualAccelerations();
+
+    std::vector<planets::Vec2f> positions(planetCount);
+    for (int i = 0; i < planetCount; i++)
+    {
+        positions[i] = system.GetPosition(i);
+    }
+    const auto reference = planets::ComputeDirectAccelerations(positions);
+    std::vector<float> relativeErrors(planetCount);
+    for (int i = 0; i < planetCount; i++)
+    {
+        relativeErrors[i] = (system.GetMutualAcceleration(i) - reference[i]).Magnitude() / reference[i].Magnitude();
+    }
+    std::ranges::nth_element(relativeErrors, relativeErrors.begin() + planetCount / 2);
+    EXPECT_LT(relativeErrors[planetCount / 2], 0.05f);
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+
+#include "barnes_hut.h"
+#include "block_timestep.h"
+#include "kepler.h"
+#include "nbody.h"
+#include "particle_mesh.h"
+#include "planet.h"
+#include "planet_system_test.h"
+#include "random.h"
+#include "thread_pool.h"
+
+#include <cmath>
+#include <cstdint>
+
+namespace
+{
+template<typename T>
+void ExpectSeeded(planets::ThreadPool& threadPool)
+{
+    constexpr std::size_t planetCount = 100'003;
+    const T serial(planetCount, nullptr, 7);
+    const T parallel(planetCount, &threadPool, 7);
+    planets::test::ExpectSameState(parallel, serial, planetCount);
+
+    const T other(planetCount, nullptr, 8);
+    int samePositions = 0;
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto index = static_cast<int>(i);
+        samePositions += other.GetPosition(index).x == serial.GetPosition(index).x;
+        //The initial disk, every planet perpendicular to worldCenter at speed sqrt(G)
+        const auto radius = (serial.GetPosition(index) - planets::worldCenter).Magnitude();
+        EXPECT_GE(radius, planets::innerRadius * (1.0f - 1e-5f));
+        EXPECT_LE(radius, planets::outerRaidus * (1.0f + 1e-5f));
+        EXPECT_NEAR(serial.GetVelocity(index).Magnitude(), std::sqrt(planets::G), 1e-4f);
+        EXPECT_NEAR(planets::Vec2f::Dot(serial.GetVelocity(index), serial.GetPosition(index) - planets::worldCenter), 0.0f, 1e-3f);
+    }
+    EXPECT_LT(samePositions, 10);
+}
+}
+
+TEST(CounterRng, Uniform)
+{
+    const planets::CounterRng rng(42);
+    const planets::CounterRng same(42);
+    const planets::CounterRng other(43);
+    double sum = 0.0;
+    int sameBits = 0;
+    constexpr std::uint32_t count = 100'000;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        EXPECT_EQ(rng.Bits(i), same.Bits(i));
+        sameBits += rng.Bits(i) == other.Bits(i);
+        const auto uniform = rng.Uniform(i);
+        EXPECT_GE(uniform, 0.0f);
+        EXPECT_LT(uniform, 1.0f);
+        sum += uniform;
+    }
+    EXPECT_LT(sameBits, 3);
+    EXPECT_NEAR(sum / count, 0.5, 0.005);
+
+    const auto lanes = rng.Uniforms<16>(1'000, 3);
+    for (int i = 0; i < 16; i++)
+    {
+        EXPECT_EQ(lanes[i], rng.Uniform(1'000 + 3 * static_cast<std::uint32_t>(i)));
+    }
+
+    //Counters past 2^32, drawn by the planets past 2^31, do not wrap onto the first ones
+    constexpr std::uint64_t wrap = std::uint64_t{ 1 } << 32;
+    int wrappedBits = 0;
+    for (std::uint32_t i = 0; i < count; i++)
+    {
+        wrappedBits += rng.Bits(wrap + i) == rng.Bits(i);
+    }
+    EXPECT_LT(wrappedBits, 3);
+    const auto wideLanes = rng.Uniforms<16>(wrap - 16, 2);
+    for (int i = 0; i < 16; i++)
+    {
+        EXPECT_EQ(wideLanes[i], rng.Uniform(wrap - 16 + 2 * static_cast<std::uint64_t>(i)));
+    }
+    planets::NVec2f<8> positions, wrappedPositions, velocities;
+    planets::GenerateOrbits(rng, 0, positions, velocities);
+    planets::GenerateOrbits(rng, std::size_t{ 1 } << 31, wrappedPositions, velocities);
+    for (int i = 0; i < 8; i++)
+    {
+        EXPECT_NE(wrappedPositions.Xs()[i], positions.Xs()[i]);
+    }
+}
+
+TEST(CounterRng, SeededPlanets)
+{
+    planets::ThreadPool threadPool(3);
+    //Each variant compares its own serial and parallel generation, so every one of them gets the pool
+    planets::test::ForEachPlanetSystem(threadPool, [&]<typename T>(planets::ThreadPool*) { ExpectSeeded<T>(threadPool); });
+
+    //Every width draws the same numbers, only the float rounding of the orbits differs
+    constexpr std::size_t planetCount = 1'001;
+    const planets::PlanetSystem scalar(planetCount, nullptr, 11);
+    const planets::PlanetSystem16 wide(planetCount, nullptr, 11);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto index = static_cast<int>(i);
+        EXPECT_NEAR(wide.GetPosition(index).x, scalar.GetPosition(index).x, 1e-5f);
+        EXPECT_NEAR(wide.GetPosition(index).y, scalar.GetPosition(index).y, 1e-5f);
+        EXPECT_NEAR(wide.GetVelocity(index).x, scalar.GetVelocity(index).x, 1e-4f);
+    }
+}
+
+TEST(CounterRng, SeededEngines)
+{
+    //Every engine generates its planets with GenerateOrbits, so a seed gives the same disk to all of them
+    constexpr std::size_t planetCount = 1'001;
+    const planets::PlanetSystem8 expected(planetCount, nullptr, 13);
+    const planets::DirectSumSystem<8> directSum(planetCount, nullptr, 13);
+    const planets::BarnesHutSystem barnesHut(planetCount, 0.5f, nullptr, 13);
+    const planets::ParticleMeshSystem particleMesh(planetCount, 64, nullptr, 13);
+    const planets::KeplerSystem8 kepler(planetCount, nullptr, 13);
+    const planets::BlockTimestepSystem8 blockTimestep(planetCount, planets::BlockTimestepSystem8::defaultAccuracy, nullptr, 13);
+    for (std::size_t i = 0; i < planetCount; i++)
+    {
+        const auto index = static_cast<int>(i);
+        const auto position = expected.GetPosition(index);
+        for (const auto other : { directSum.GetPosition(index), barnesHut.GetPosition(index), particleMesh.GetPosition(index),
+            kepler.GetPosition(index), blockTimestep.GetPosition(index) })
+        {
+            EXPECT_NEAR(other.x, position.x, 1e-5f) << "planet " << i;
+            EXPECT_NEAR(other.y, position.y, 1e-5f) << "planet " << i;
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "dispatch.h"
+#include "simulation_thread.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+void FillSnapshot(planets::PositionSnapshot& snapshot, std::uint64_t step)
+{
+    snapshot.data.assign(64, static_cast<float>(step));
+    snapshot.planetCount = 32;
+    snapshot.laneCount = 8;
+    snapshot.step = step;
+}
+}
+
+TEST(SnapshotBuffer, Acquire)
+{
+    planets::SnapshotBuffer buffer;
+    EXPECT_FALSE(buffer.Acquire());
+    for (std::uint64_t step = 1; step <= 3; step++)
+    {
+        FillSnapshot(buffer.GetBack(), step);
+        buffer.Publish();
+    }
+    //Only the latest one is seen
+    ASSERT_TRUE(buffer.Acquire());
+    EXPECT_EQ(buffer.GetFront().step, 3u);
+    EXPECT_FALSE(buffer.Acquire());
+    FillSnapshot(buffer.GetBack(), 4);
+    buffer.Publish();
+    ASSERT_TRUE(buffer.Acquire());
+    EXPECT_EQ(buffer.GetFront().step, 4u);
+    EXPECT_EQ(buffer.GetPrevious().step, 3u);
+}
+
+TEST(SnapshotBuffer, Concurrent)
+{
+    constexpr std::uint64_t stepCount = 20'000;
+    planets::SnapshotBuffer buffer;
+    std::thread writer([&buffer]
+    {
+        for (std::uint64_t step = 1; step <= stepCount; step++)
+        {
+            FillSnapshot(buffer.GetBack(), step);
+            buffer.Publish();
+        }
+    });
+    std::uint64_t lastStep = 0;
+    while (lastStep < stepCount)
+    {
+        if (!buffer.Acquire())
+        {
+            continue;
+        }
+        const auto& front = buffer.GetFront();
+        //A snapshot is never seen while the writer fills it
+        ASSERT_GT(front.step, lastStep);
+        ASSERT_TRUE(std::ranges::all_of(front.data, [&front](float value) { return value == static_cast<float>(front.step); }));
+        EXPECT_EQ(buffer.GetPrevious().step, lastStep);
+        lastStep = front.step;
+    }
+    writer.join();
+}
+
+TEST(SimulationThread, Interpolate)
+{
+    const std::vector<float> previous{ 0.0f, 1.0f, -2.0f };
+    const std::vector<float> current{ 2.0f, 1.0f, 2.0f };
+    std::vector<float> result(3);
+    planets::Interpolate(previous, current, 0.25f, result);
+    EXPECT_FLOAT_EQ(result[0], 0.5f);
+    EXPECT_FLOAT_EQ(result[1], 1.0f);
+    EXPECT_FLOAT_EQ(result[2], -1.0f);
+}
+
+TEST(SimulationThread, Steps)
+{
+    constexpr std::size_t planetCount = 1'000;
+    constexpr float fixedDt = 1.0f / 500.0f;
+    const auto planetSystem = planets::CreatePlanetSystem(planets::Isa::Sse, 4, planetCount);
+    const auto start = planetSystem->GetPosition(0);
+    {
+        planets::SimulationThread simulation(*planetSystem, fixedDt);
+        auto positions = simulation.GetPositions(std::chrono::steady_clock::now());
+        ASSERT_EQ(positions.GetPlanetCount(), planetCount);
+        EXPECT_EQ(positions[0], start);
+        while (simulation.GetStepCount() < 10)
+        {
+            std::this_thread::yield();
+        }
+        //Far enough ahead that no interpolation happens
+        positions = simulation.GetPositions(std::chrono::steady_clock::now() + std::chrono::seconds(1));
+        ASSERT_EQ(positions.GetPlanetCount(), planetCount);
+        EXPECT_NE(positions[0], start);
+    }
+    EXPECT_NE(planetSystem->GetPosition(0), start);
+}
@@ -0,0 +1,50 @@
+#include "gtest/gtest.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+TEST(ThreadPool, ParallelForVisitsEachIndexOnce)
+{
+    planets::ThreadPool threadPool(4);
+    std::vector<std::atomic<int>> visits(10'007);
+    for (int job = 0; job < 16; job++)
+    {
+        threadPool.ParallelFor(0, visits.size(), 64, [&visits](std::size_t begin, std::size_t end)
+        {
+            for (auto i = begin; i < end; i++)
+            {
+                visits[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (const auto& visit : visits)
+    {
+        EXPECT_EQ(visit.load(), 16);
+    }
+}
+
+TEST(ThreadPool, ParallelForChunkBounds)
+{
+    planets::ThreadPool threadPool(3);
+    std::atomic<std::size_t> total = 0;
+    threadPool.ParallelFor(5, 105, 10, [&total](std::size_t begin, std::size_t end)
+    {
+        EXPECT_EQ(begin % 10, 5u);
+        EXPECT_LE(end - begin, 10u);
+        total += end - begin;
+    });
+    EXPECT_EQ(total.load(), 100u);
+}
+
+TEST(ThreadPool, SingleThread)
+{
+    planets::ThreadPool threadPool(1);
+    EXPECT_EQ(threadPool.GetThreadCount(), 1u);
+    std::size_t total = 0;
+    threadPool.ParallelFor(0, 1000, 7, [&total](std::size_t begin, std::size_t end)
+    {
+        total += end - begin;
+    });
+    EXPECT_EQ(total, 1000u);
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include "planet.h"
+#include "trajectory.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+std::filesystem::path TemporaryPath(const char* name)
+{
+    return std::filesystem::temp_directory_path() / name;
+}
+}
+
+TEST(Trajectory, RecordAndReplay)
+{
+    constexpr std::size_t planetCount = 1'001;
+    constexpr int frameCount = 20;
+    constexpr double quantum = 1.0e-4;
+    const auto path = TemporaryPath("planets_test_trajectory.bin");
+    planets::PlanetSystem8 planetSystem(planetCount, nullptr, 3);
+    std::vector<std::vector<sf::Vector2f>> expected;
+    {
+        //A queue shorter than the run, so Record has to wait for the writer
+        const auto recorder = planets::TrajectoryRecorder::Create(path, quantum, 2);
+        ASSERT_TRUE(recorder);
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            planetSystem.Update(1.0f / 60.0f);
+            recorder->Record(planetSystem.GetPositions(), planetSystem.GetTime());
+            auto& positions = expected.emplace_back(planetCount);
+            for (std::size_t i = 0; i < planetCount; i++)
+            {
+                const auto position = planetSystem.GetPosition(static_cast<int>(i));
+                positions[i] = { position.x, position.y };
+            }
+        }
+        EXPECT_TRUE(recorder->Flush());
+        EXPECT_EQ(recorder->GetFrameCount(), static_cast<std::uint64_t>(frameCount));
+        //Well under the 8 bytes of two raw floats once the prediction has two frames
+        EXPECT_LT(recorder->GetWrittenBytes(), frameCount * planetCount * 4);
+    }
+
+    const auto reader = planets::TrajectoryReader::Open(path);
+    ASSERT_TRUE(reader);
+    EXPECT_DOUBLE_EQ(reader->GetQuantum(), quantum);
+    planets::TrajectoryFrame frame;
+    for (int index = 0; index < frameCount; index++)
+    {
+        ASSERT_TRUE(reader->Next(frame));
+        EXPECT_NEAR(frame.time, (index + 1) / 60.0, 1e-6);
+        ASSERT_EQ(frame.positions.size(), planetCount);
+        for (std::size_t i = 0; i < planetCount; i++)
+        {
+            //Half a quantum, and the float rounding of positions of a few meters
+            EXPECT_NEAR(frame.positions[i].x, expected[index][i].x, quantum * 0.5 + 1e-6);
+            EXPECT_NEAR(frame.positions[i].y, expected[index][i].y, quantum * 0.5 + 1e-6);
+        }
+    }
+    EXPECT_FALSE(reader->Next(frame));
+    std::filesystem::remove(path);
+}
+
+TEST(Trajectory, PlanetCountChanges)
+{
+    const auto path = TemporaryPath("planets_test_trajectory_count.bin");
+    const std::vector<float> wide{ 1.0f, 2.0f, 3.0f, 4.0f, -1.0f, -2.0f, -3.0f, -4.0f };
+    const std::vector<float> narrow{ 0.5f, -0.5f };
+    {
+        const auto recorder = planets::TrajectoryRecorder::Create(path, 1.0e-3);
+        ASSERT_TRUE(recorder);
+        //Three planets in a block of four, then a single one
+        recorder->Record({ wide.data(), 3, 4 }, 0.0);
+        recorder->Record({ wide.data(), 3, 4 }, 1.0);
+        recorder->Record({ narrow.data(), 1, 1 }, 2.0);
+    }
+    const auto reader = planets::TrajectoryReader::Open(path);
+    ASSERT_TRUE(reader);
+    planets::TrajectoryFrame frame;
+    for (int index = 0; index < 2; index++)
+    {
+        ASSERT_TRUE(reader->Next(frame));
+        ASSERT_EQ(frame.positions.size(), 3u);
+        EXPECT_NEAR(frame.positions[2].x, 3.0f, 1e-6);
+        EXPECT_NEAR(frame.positions[2].y, -3.0f, 1e-6);
+    }
+    ASSERT_TRUE(reader->Next(frame));
+    EXPECT_DOUBLE_EQ(frame.time, 2.0);
+    ASSERT_EQ(frame.positions.size(), 1u);
+    EXPECT_NEAR(frame.positions[0].x, 0.5f, 1e-6);
+    EXPECT_NEAR(frame.positions[0].y, -0.5f, 1e-6);
+    EXPECT_FALSE(reader->Next(frame));
+    std::filesystem::remove(path);
+}
+
+TEST(Trajectory, Rejects)
+{
+    EXPECT_FALSE(planets::TrajectoryReader::Open(TemporaryPath("planets_test_missing.bin")));
+    EXPECT_FALSE(planets::TrajectoryRecorder::Create(TemporaryPath("planets_test_trajectory.bin"), 0.0));
+
+    const auto path = TemporaryPath("planets_test_trajectory_bad.bin");
+    {
+        std::ofstream output(path, std::ios::binary);
+        output << "not a trajectory file at all";
+    }
+    EXPECT_FALSE(planets::TrajectoryReader::Open(path));
+
+    //A frame cut short ends the replay
+    {
+        const auto recorder = planets::TrajectoryRecorder::Create(path);
+        const std::vector<float> positions{ 1.0f, 2.0f };
+        recorder->Record({ positions.data(), 1, 1 }, 0.0);
+    }
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    const auto reader = planets::TrajectoryReader::Open(path);
+    ASSERT_TRUE(reader);
+    planets::TrajectoryFrame frame;
+    EXPECT_FALSE(reader->Next(frame));
+
+    //A frame header claiming more planets than the file holds is rejected before anything is allocated for them
+    for (const auto planetCount : { std::uint64_t{ 1 } << 40, std::uint64_t{ 1 } << 63, ~std::uint64_t{} })
+    {
+        {
+            const auto recorder = planets::TrajectoryRecorder::Create(path);
+            const std::vector<float> positions{ 1.0f, 2.0f };
+            recorder->Record({ positions.data(), 1, 1 }, 0.0);
+        }
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(sizeof(planets::TrajectoryHeader) + offsetof(planets::TrajectoryFrameHeader, planetCount));
+            file.write(reinterpret_cast<const char*>(&planetCount), sizeof(planetCount));
+            const auto payloadSize = planetCount * 2;
+            file.write(reinterpret_cast<const char*>(&payloadSize), sizeof(payloadSize));
+        }
+        const auto corrupt = planets::TrajectoryReader::Open(path);
+        ASSERT_TRUE(corrupt);
+        EXPECT_FALSE(corrupt->Next(frame)) << planetCount;
+    }
+    std::filesystem::remove(path);
+}
@@ -4,6 +4,7 @@
 
 #include "gtest/gtest.h"
 #include "vec.h"
+#include "vec_math.h"
 
 TEST(Vec2f, Const)
 {
@@ -130,7 +131,7 @@ TEST(FourVec2f, Constructor)
             {-1.0f, -3.5f},
             }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
 
     for(int i = 0; i < 4; i++)
     {
@@ -148,7 +149,7 @@ TEST(FourVec2f, Add)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
     constexpr std::array<planets::Vec2f, 4> vs2{{
                                                        {1.2f, 3.5f},
                                                        {-2.1f, 3.5f},
@@ -156,7 +157,7 @@ TEST(FourVec2f, Add)
                                                        {8.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs2 = planets::FourVec2f(vs2.data());
+    const auto four_vs2 = planets::FourVec2f(vs2.data());
 
     const auto result = four_vs+four_vs2;
     for(int i = 0; i < 4; i++)
@@ -175,7 +176,7 @@ TEST(FourVec2f, Sub)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
     constexpr std::array<planets::Vec2f, 4> vs2{{
                                                         {1.2f, 3.5f},
                                                         {-2.1f, 3.5f},
@@ -183,7 +184,7 @@ TEST(FourVec2f, Sub)
                                                         {8.0f, -3.5f},
                                                 }
     };
-    constexpr auto four_vs2 = planets::FourVec2f(vs2.data());
+    const auto four_vs2 = planets::FourVec2f(vs2.data());
 
     const auto result = four_vs-four_vs2;
     for(int i = 0; i < 4; i++)
@@ -203,7 +204,7 @@ TEST(FourVec2f, MulFloat)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
     constexpr std::array<float, 4> ns{{
                                                        1.2f,
                                                        -2.1f,
@@ -231,7 +232,7 @@ TEST(FourVec2f, DivFloat)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
     constexpr std::array<float, 4> ns{{
                                               1.2f,
                                               -2.1f,
@@ -258,7 +259,7 @@ TEST(FourVec2f, Dot)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
     constexpr std::array<planets::Vec2f, 4> vs2{{
                                                         {1.2f, 3.5f},
                                                         {-2.1f, 3.5f},
@@ -266,7 +267,7 @@ TEST(FourVec2f, Dot)
                                                         {8.0f, -3.5f},
                                                 }
     };
-    constexpr auto four_vs2 = planets::FourVec2f(vs2.data());
+    const auto four_vs2 = planets::FourVec2f(vs2.data());
 
     const auto result = planets::FourVec2f::Dot(four_vs, four_vs2);
     for(int i = 0; i < 4; i++)
@@ -285,11 +286,283 @@ TEST(FourVec2f, SquareMagnitude)
                                                        {-1.0f, -3.5f},
                                                }
     };
-    constexpr auto four_vs = planets::FourVec2f(vs.data());
+    const auto four_vs = planets::FourVec2f(vs.data());
 
     const auto result = four_vs.SquareMagnitude();
     for(int i = 0; i < 4; i++)
     {
         EXPECT_FLOAT_EQ(vs[i].SquareMagnitude(), result[i]);
     }
-}
\ No newline at end of file
+}
+TEST(FourVec2f, Neg)
+{
+    constexpr std::array<planets::Vec2f, 4> vs{{
+                                                       {1.0f, 3.5f},
+                                                       {1.0f, -3.5f},
+                                                       {-1.0f, 3.5f},
+                                                       {-1.0f, -3.5f},
+                                               }
+    };
+    const auto four_vs = planets::FourVec2f(vs.data());
+
+    const auto result = -four_vs;
+    for(int i = 0; i < 4; i++)
+    {
+        EXPECT_FLOAT_EQ(-vs[i].x, result.Xs()[i]);
+        EXPECT_FLOAT_EQ(-vs[i].y, result.Ys()[i]);
+    }
+}
+
+TEST(SixteenFloat, MaskedLoad)
+{
+    std::array<float, 16> numbers{};
+    for(int i = 0; i < 16; i++)
+    {
+        numbers[i] = static_cast<float>(i) * 1.5f;
+    }
+    for(int count = 0; count <= 16; count++)
+    {
+        const auto sixteen_f = planets::SixteenFloat(numbers.data(), count, -1.0f);
+        for(int i = 0; i < 16; i++)
+        {
+            EXPECT_FLOAT_EQ(sixteen_f[i], i < count ? numbers[i] : -1.0f);
+        }
+    }
+}
+
+TEST(SixteenFloat, Sqrt)
+{
+    std::array<float, 16> numbers{};
+    for(int i = 0; i < 16; i++)
+    {
+        numbers[i] = 1.0f + static_cast<float>(i) * 0.7f;
+    }
+    const auto sixteen_f = planets::SixteenFloat(numbers.data());
+    const auto result = sixteen_f.Sqrt();
+    const auto rsqrt = sixteen_f.ReciprocalSqrt();
+    for(int i = 0; i < 16; i++)
+    {
+        EXPECT_FLOAT_EQ(result[i], std::sqrt(numbers[i]));
+        EXPECT_NEAR(rsqrt[i], 1.0f/std::sqrt(numbers[i]), 0.001f);
+    }
+}
+
+TEST(SixteenVec2f, Arithmetic)
+{
+    std::array<planets::Vec2f, 16> vs{};
+    std::array<planets::Vec2f, 16> vs2{};
+    std::array<float, 16> ns{};
+    for(int i = 0; i < 16; i++)
+    {
+        vs[i] = {static_cast<float>(i) - 3.5f, 2.0f * static_cast<float>(i)};
+        vs2[i] = {1.25f, -static_cast<float>(i)};
+        ns[i] = static_cast<float>(i) + 0.5f;
+    }
+    const auto sixteen_vs = planets::SixteenVec2f(vs.data());
+    const auto sixteen_vs2 = planets::SixteenVec2f(vs2.data());
+    const auto sixteen_ns = planets::SixteenFloat(ns.data());
+
+    const auto add = sixteen_vs + sixteen_vs2;
+    const auto sub = sixteen_vs - sixteen_vs2;
+    const auto neg = -sixteen_vs;
+    const auto mul = sixteen_vs * sixteen_ns;
+    const auto div = sixteen_vs / sixteen_ns;
+    const auto dot = planets::SixteenVec2f::Dot(sixteen_vs, sixteen_vs2);
+    for(int i = 0; i < 16; i++)
+    {
+        EXPECT_FLOAT_EQ(vs[i].x+vs2[i].x, add.Xs()[i]);
+        EXPECT_FLOAT_EQ(vs[i].y+vs2[i].y, add.Ys()[i]);
+        EXPECT_FLOAT_EQ(vs[i].x-vs2[i].x, sub.Xs()[i]);
+        EXPECT_FLOAT_EQ(vs[i].y-vs2[i].y, sub.Ys()[i]);
+        EXPECT_FLOAT_EQ(-vs[i].x, neg.Xs()[i]);
+        EXPECT_FLOAT_EQ(-vs[i].y, neg.Ys()[i]);
+        EXPECT_FLOAT_EQ(vs[i].x*ns[i], mul.Xs()[i]);
+        EXPECT_FLOAT_EQ(vs[i].y*ns[i], mul.Ys()[i]);
+        EXPECT_FLOAT_EQ(vs[i].x/ns[i], div.Xs()[i]);
+        EXPECT_FLOAT_EQ(vs[i].y/ns[i], div.Ys()[i]);
+        EXPECT_FLOAT_EQ(planets::Vec2f::Dot(vs[i], vs2[i]), dot[i]);
+    }
+}
+
+TEST(FloatArray, InRangeMask)
+{
+    constexpr std::array<float, 16> values = { -2.0f, -1.0f, 0.0f, 0.5f, 1.0f, 1.5f, 2.0f, 3.0f,
+        -2.0f, -1.0f, 0.0f, 0.5f, 1.0f, 1.5f, 2.0f, 3.0f };
+    //Bounds are inclusive
+    constexpr std::uint32_t expected = 0b0001111000011110;
+    EXPECT_EQ(planets::FourFloat::InRangeMask(planets::FourFloat{ values.data() }, planets::FourFloat{ -1.0f }, planets::FourFloat{ 1.0f }),
+        expected & 0xFu);
+    EXPECT_EQ(planets::EightFloat::InRangeMask(planets::EightFloat{ values.data() }, planets::EightFloat{ -1.0f }, planets::EightFloat{ 1.0f }),
+        expected & 0xFFu);
+    EXPECT_EQ(planets::SixteenFloat::InRangeMask(planets::SixteenFloat{ values.data() }, planets::SixteenFloat{ -1.0f }, planets::SixteenFloat{ 1.0f }),
+        expected);
+}
+
+template<int N>
+void ExpectMath()
+{
+    std::array<float, N> values{};
+    for (int start = 0; start < 400; start += N)
+    {
+        for (int i = 0; i < N; i++)
+        {
+            values[i] = static_cast<float>(start + i - 200) * 0.173f;
+        }
+        const planets::FloatArray<N> xs{ values.data() };
+        //Kept in the range of Exp, and above zero for Log
+        const auto exps = planets::Exp(xs * 0.4f);
+        const auto logs = planets::Log(xs.Abs() * 100.0f + planets::FloatArray<N>{ 1e-3f });
+        //Against the scalar functions, on normal lanes for the exponent ones
+        const auto rounded = (xs * 0.5f).Round();
+        const auto positives = xs.Abs() + planets::FloatArray<N>{ 1e-3f };
+        const auto exponents = positives.Exponent();
+        const auto scaled = positives.ScaleByPowerOfTwo(planets::FloatArray<N>{ -3.0f });
+        //Within [-pi/2, pi/2]
+        const auto angles = xs * (1.0f / 23.0f);
+        planets::FloatArray<N> sins, coss;
+        planets::SinCos(angles, sins, coss);
+        for (int i = 0; i < N; i++)
+        {
+            EXPECT_NEAR(sins[i], std::sin(angles[i]), 2e-7f);
+            EXPECT_NEAR(coss[i], std::cos(angles[i]), 2e-7f);
+            EXPECT_EQ(rounded[i], std::nearbyint(values[i] * 0.5f));
+            EXPECT_EQ(exponents[i], static_cast<float>(std::ilogb(positives[i])));
+            EXPECT_EQ(scaled[i], positives[i] / 8.0f);
+            //Relative to the rounding of the argument, which the reduction by ln2 cannot undo
+            const auto expError = 2e-7f * std::max(4.0f, std::abs(values[i] * 0.4f));
+            EXPECT_NEAR(exps[i], std::exp(values[i] * 0.4f), expError * std::exp(values[i] * 0.4f));
+            EXPECT_NEAR(logs[i], std::log(std::abs(values[i]) * 100.0f + 1e-3f), 1e-6f);
+        }
+    }
+}
+
+TEST(FloatArray, Math)
+{
+    ExpectMath<4>();
+    ExpectMath<8>();
+    ExpectMath<16>();
+    //Widths without intrinsics take the generic lane loops
+    ExpectMath<2>();
+}
+
+template<int N>
+void ExpectDoubleArray()
+{
+    std::array<double, N> numbers{};
+    std::array<double, N> others{};
+    for (int i = 0; i < N; i++)
+    {
+        numbers[i] = 1.0 + static_cast<double>(i) * 0.7;
+        others[i] = static_cast<double>(i) - 2.5;
+    }
+    const planets::DoubleArray<N> xs{ numbers.data() };
+    const planets::DoubleArray<N> ys{ others.data() };
+    const auto sum = xs + ys;
+    const auto product = xs * ys;
+    const auto quotient = ys / xs;
+    const auto sqrt = xs.Sqrt();
+    const auto rsqrt = xs.ReciprocalSqrt();
+    const auto abs = ys.Abs();
+    const auto rounded = ys.Round();
+    const auto exponents = xs.Exponent();
+    const auto scaled = xs.ScaleByPowerOfTwo(planets::DoubleArray<N>{ 5.0 });
+    const auto min = planets::DoubleArray<N>::Min(xs, ys);
+    for (int i = 0; i < N; i++)
+    {
+        EXPECT_DOUBLE_EQ(sum[i], numbers[i] + others[i]);
+        EXPECT_DOUBLE_EQ(product[i], numbers[i] * others[i]);
+        EXPECT_DOUBLE_EQ(quotient[i], others[i] / numbers[i]);
+        EXPECT_DOUBLE_EQ(sqrt[i], std::sqrt(numbers[i]));
+        //Exact in double, unlike the float estimate
+        EXPECT_DOUBLE_EQ(rsqrt[i], 1.0 / std::sqrt(numbers[i]));
+        EXPECT_DOUBLE_EQ(abs[i], std::abs(others[i]));
+        EXPECT_DOUBLE_EQ(rounded[i], std::nearbyint(others[i]));
+        EXPECT_DOUBLE_EQ(exponents[i], static_cast<double>(std::ilogb(numbers[i])));
+        EXPECT_DOUBLE_EQ(scaled[i], numbers[i] * 32.0);
+        EXPECT_DOUBLE_EQ(min[i], std::min(numbers[i], others[i]));
+    }
+    for (int count = 0; count <= N; count++)
+    {
+        const planets::DoubleArray<N> masked{ numbers.data(), count, -1.0 };
+        for (int i = 0; i < N; i++)
+        {
+            EXPECT_DOUBLE_EQ(masked[i], i < count ? numbers[i] : -1.0);
+        }
+    }
+    const auto mask = planets::DoubleArray<N>::InRangeMask(ys, planets::DoubleArray<N>{ -1.5 }, planets::DoubleArray<N>{ 0.5 });
+    for (int i = 0; i < N; i++)
+    {
+        EXPECT_EQ((mask >> i) & 1u, static_cast<std::uint32_t>(-1.5 <= others[i] && others[i] <= 0.5));
+    }
+}
+
+template<typename T, int N>
+void ExpectStoreSelectOr()
+{
+    using Bits = std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+    std::array<T, N> as{}, bs{}, masks{};
+    for (int i = 0; i < N; i++)
+    {
+        as[i] = static_cast<T>(i + 1);
+        bs[i] = -static_cast<T>(i + 1);
+        masks[i] = i % 3 == 0 ? std::bit_cast<T>(~Bits{}) : T{};
+    }
+    //One past the lanes stays untouched
+    std::array<T, N + 1> stored{};
+    stored[N] = T{ 7 };
+    planets::SimdArray<T, N>::Select(planets::SimdArray<T, N>{ masks.data() }, planets::SimdArray<T, N>{ as.data() },
+        planets::SimdArray<T, N>{ bs.data() }).Store(stored.data());
+    for (int i = 0; i < N; i++)
+    {
+        EXPECT_EQ(stored[i], i % 3 == 0 ? as[i] : bs[i]) << "lane " << i << " of " << N;
+    }
+    EXPECT_EQ(stored[N], T{ 7 });
+    //Or with 0 keeps the lanes, or with a mask sets every bit
+    const auto ored = planets::SimdArray<T, N>{ as.data() } | planets::SimdArray<T, N>{ T{} };
+    const auto masked = planets::SimdArray<T, N>{ as.data() } | planets::SimdArray<T, N>{ masks.data() };
+    for (int i = 0; i < N; i++)
+    {
+        EXPECT_EQ(ored[i], as[i]);
+        EXPECT_EQ(std::bit_cast<Bits>(masked[i]), std::bit_cast<Bits>(i % 3 == 0 ? masks[i] : as[i]));
+    }
+}
+
+TEST(SimdArray, StoreSelectOr)
+{
+    ExpectStoreSelectOr<float, 4>();
+    ExpectStoreSelectOr<float, 8>();
+    ExpectStoreSelectOr<float, 16>();
+    ExpectStoreSelectOr<float, 2>();
+    ExpectStoreSelectOr<double, 4>();
+    ExpectStoreSelectOr<double, 8>();
+    ExpectStoreSelectOr<double, 2>();
+}
+
+TEST(DoubleArray, Arithmetic)
+{
+    ExpectDoubleArray<4>();
+    ExpectDoubleArray<8>();
+    ExpectDoubleArray<2>();
+}
+
+TEST(EightVec2d, Arithmetic)
+{
+    std::array<planets::Vec2f, 8> vs{};
+    for(int i = 0; i < 8; i++)
+    {
+        vs[i] = {static_cast<float>(i) - 3.5f, 2.0f * static_cast<float>(i) + 1.0f};
+    }
+    const auto eight_vs = planets::EightVec2d(vs.data());
+    const auto neg = -eight_vs;
+    const auto squareMagnitude = eight_vs.SquareMagnitude();
+    const auto normalized = eight_vs.Normalized();
+    for(int i = 0; i < 8; i++)
+    {
+        const auto x = static_cast<double>(vs[i].x);
+        const auto y = static_cast<double>(vs[i].y);
+        EXPECT_DOUBLE_EQ(-x, neg.Xs()[i]);
+        EXPECT_DOUBLE_EQ(-y, neg.Ys()[i]);
+        EXPECT_DOUBLE_EQ(x * x + y * y, squareMagnitude[i]);
+        EXPECT_DOUBLE_EQ(x / std::sqrt(x * x + y * y), normalized.Xs()[i]);
+    }
+}